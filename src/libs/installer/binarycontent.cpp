@@ -39,6 +39,43 @@
 #include "fileio.h"
 #include "fileutils.h"
 
+#include <string.h>
+
+namespace {
+
+/*
+    Searches backwards through \a size bytes of \a data for \a magicCookie. Returns the offset
+    of the last occurrence or -1 if there is none.
+*/
+qint64 searchBackwards(const uchar *data, qint64 size, quint64 magicCookie)
+{
+    const size_t markerSize = sizeof(quint64);
+    const uchar firstByte = *reinterpret_cast<const uchar *>(&magicCookie);
+
+    qint64 end = size - qint64(markerSize) + 1; // candidates start in [0, end)
+    while (end > 0) {
+        // find the previous candidate by its first byte only, then compare the whole marker
+#ifdef __GLIBC__
+        const void *candidate = memrchr(data, firstByte, size_t(end));
+        if (!candidate)
+            return -1;
+        const qint64 pos = static_cast<const uchar *>(candidate) - data;
+#else
+        qint64 pos = end - 1;
+        while (pos >= 0 && data[pos] != firstByte)
+            --pos;
+        if (pos < 0)
+            return -1;
+#endif
+        if (memcmp(data + pos, &magicCookie, markerSize) == 0)
+            return pos;
+        end = pos;
+    }
+    return -1;
+}
+
+} // anon namespace
+
 namespace QInstaller {
 
 /*!
@@ -72,34 +109,47 @@ qint64 BinaryContent::findMagicCookie(QFile *in, quint64 magicCookie)
     const size_t markerSize = sizeof(qint64);
     const qint64 maxSearch = qMin((1024LL * 1024LL), fileSize);
 
-    QByteArray data(maxSearch, Qt::Uninitialized);
     uchar *const mapped = in->map(fileSize - maxSearch, maxSearch);
-    if (!mapped) {
+    if (mapped) {
+        // Search the mapped region in place, map does not change QFile::pos(). Binaries that
+        // have nothing appended end with the cookie, so the first candidate usually matches.
+        const qint64 searched = searchBackwards(mapped, maxSearch, magicCookie);
+        in->unmap(mapped);
+        if (searched >= 0)
+            return (fileSize - maxSearch) + searched;
+    } else {
         // Fallback to read the file content in case we can't map it.
 
         // Note: Failing to map the file can happen for example while having a remote connection
         // established to the privileged server process and we do not support map over the socket.
-        const int pos = in->pos();
+        const qint64 pos = in->pos();
+        qint64 searched = -1;
         try {
-            in->seek(fileSize - maxSearch);
-            QInstaller::blockingRead(in, data.data(), maxSearch);
+            // check the end of the file first to avoid reading the whole search range
+            if (fileSize >= qint64(markerSize)) {
+                quint64 trailer = 0;
+                in->seek(fileSize - markerSize);
+                QInstaller::blockingRead(in, reinterpret_cast<char *>(&trailer), markerSize);
+                if (trailer == magicCookie)
+                    searched = maxSearch - markerSize;
+            }
+
+            if (searched < 0) {
+                QByteArray data(maxSearch, Qt::Uninitialized);
+                in->seek(fileSize - maxSearch);
+                QInstaller::blockingRead(in, data.data(), maxSearch);
+                searched = searchBackwards(reinterpret_cast<const uchar *>(data.constData()),
+                    maxSearch, magicCookie);
+            }
             in->seek(pos);
         } catch (const Error &error) {
             in->seek(pos);
             throw error;
         }
-    } else {
-        // map does not change QFile::pos()
-        data = QByteArray((const char*) mapped, maxSearch);
-        in->unmap(mapped);
-    }
-
-    qint64 searched = maxSearch - markerSize;
-    while (searched >= 0) {
-        if (memcmp(&magicCookie, (data.data() + searched), markerSize) == 0)
+        if (searched >= 0)
             return (fileSize - maxSearch) + searched;
-        --searched;
     }
+
     throw Error(QCoreApplication::translate("QInstaller", "No marker found, stopped after %1.")
         .arg(humanReadableSize(maxSearch)));
 
@@ -207,16 +257,7 @@ void BinaryContent::readBinaryContent(QFile *file, QList<OperationBlob> *operati
             throw Error(QCoreApplication::translate("BinaryContent",
                 "Could not seek to %1 to read the operation data.").arg(posOfOperationsBlock));
         }
-        // read the operations count
-        qint64 operationsCount = QInstaller::retrieveInt64(file);
-        // read the operations
-        for (int i = 0; i < operationsCount; ++i) {
-            const QString name = QInstaller::retrieveString(file);
-            const QString xml = QInstaller::retrieveString(file);
-            operations->append(OperationBlob(name, xml));
-        }
-        // operations count
-        Q_UNUSED(QInstaller::retrieveInt64(file)) // read it, but deliberately not used
+        readOperations(file, operations);
     }
 
     if (manager) {    // read the collection index and data
@@ -275,12 +316,7 @@ void BinaryContent::writeBinaryContent(QFile *out, const QList<OperationBlob> &o
     localManager.removeCollection("QResources");
 
     // operations
-    QInstaller::appendInt64(out, operations.count());
-    foreach (const OperationBlob &operation, operations) {
-        QInstaller::appendString(out, operation.name);
-        QInstaller::appendString(out, operation.xml);
-    }
-    QInstaller::appendInt64(out, operations.count());
+    writeOperations(out, operations);
     const Range<qint64> operationsSegment = Range<qint64>::fromStartAndEnd(pos, out->pos());
 
     // resource collections data and index
@@ -303,4 +339,95 @@ void BinaryContent::writeBinaryContent(QFile *out, const QList<OperationBlob> &o
     QInstaller::appendInt64(out, magicCookie);
 }
 
+/*!
+    Reads the performed operations starting at the current position of \a in and appends them to
+    \a operations. Throws Error on failure.
+
+    Both the binary operation journal and the legacy XML operation list written by older versions
+    of the framework are understood. Journal records are only split into name and binary record,
+    they are not parsed until the operation is instantiated.
+*/
+void BinaryContent::readOperations(QFileDevice *in, QList<OperationBlob> *operations)
+{
+    const qint64 marker = QInstaller::retrieveInt64(in);
+    if (marker != MagicOperationJournal) {
+        // legacy format, the marker is the operations count
+        for (qint64 i = 0; i < marker; ++i) {
+            const QString name = QInstaller::retrieveString(in);
+            const QString xml = QInstaller::retrieveString(in);
+            operations->append(OperationBlob(name, xml));
+        }
+        Q_UNUSED(QInstaller::retrieveInt64(in)) // read it, but deliberately not used
+        return;
+    }
+
+    const qint64 version = QInstaller::retrieveInt64(in);
+    if (version > OperationJournalVersion) {
+        throw Error(QCoreApplication::translate("BinaryContent", "Unsupported operation journal "
+            "version %1.").arg(version));
+    }
+
+    const qint64 operationsCount = QInstaller::retrieveInt64(in);
+    operations->reserve(operations->count() + operationsCount);
+    for (qint64 i = 0; i < operationsCount; ++i) {
+        const QString name = QInstaller::retrieveString(in);
+        const QByteArray data = QInstaller::retrieveByteArray(in);
+        operations->append(OperationBlob(name, data));
+    }
+    if (QInstaller::retrieveInt64(in) != operationsCount) {
+        throw Error(QCoreApplication::translate("BinaryContent", "Operation journal is "
+            "corrupt."));
+    }
+}
+
+/*!
+    Writes the performed operations \a operations to \a out. Throws Error on failure.
+
+    If all operations carry a binary record, the operations are written as binary operation journal:
+
+    \code
+    Journal marker (qint64)
+    Journal version (qint64)
+    Operation count (qint64)
+    Operation entry [1 ... n]
+    [Format]
+        Name (qint64, QString)
+        Binary record (qint64, QByteArray)
+    [Format]
+    Operation count (qint64)
+    \endcode
+
+    Otherwise the legacy XML operation list is written, so that operations read from binaries of
+    older versions of the framework are passed on unchanged.
+*/
+void BinaryContent::writeOperations(QFileDevice *out, const QList<OperationBlob> &operations)
+{
+    bool legacy = false;
+    foreach (const OperationBlob &operation, operations) {
+        if (operation.data.isEmpty()) {
+            legacy = true;
+            break;
+        }
+    }
+
+    if (legacy) {
+        QInstaller::appendInt64(out, operations.count());
+        foreach (const OperationBlob &operation, operations) {
+            QInstaller::appendString(out, operation.name);
+            QInstaller::appendString(out, operation.xml);
+        }
+        QInstaller::appendInt64(out, operations.count());
+        return;
+    }
+
+    QInstaller::appendInt64(out, MagicOperationJournal);
+    QInstaller::appendInt64(out, OperationJournalVersion);
+    QInstaller::appendInt64(out, operations.count());
+    foreach (const OperationBlob &operation, operations) {
+        QInstaller::appendString(out, operation.name);
+        QInstaller::appendByteArray(out, operation.data);
+    }
+    QInstaller::appendInt64(out, operations.count());
+}
+
 } // namespace QInstaller
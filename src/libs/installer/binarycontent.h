@@ -40,6 +40,7 @@
 
 QT_BEGIN_NAMESPACE
 class QFile;
+class QFileDevice;
 QT_END_NAMESPACE
 
 namespace QInstaller {
@@ -58,6 +59,11 @@ public:
     static const quint64 MagicCookie = 0xc2630a1c99d668f8LL;  // binary
     static const quint64 MagicCookieDat = 0xc2630a1c99d668f9LL; // data
 
+    // the marker and version starting the binary operation journal, negative to tell it apart
+    // from the operation count that starts the legacy XML operation list
+    static const qint64 MagicOperationJournal = -0x12023237LL;
+    static const qint64 OperationJournalVersion = 1;
+
     static qint64 findMagicCookie(QFile *file, quint64 magicCookie);
     static BinaryLayout binaryLayout(QFile *file, quint64 magicCookie);
 
@@ -72,6 +78,9 @@ public:
                                 const ResourceCollectionManager &manager,
                                 qint64 magicMarker,
                                 quint64 magicCookie);
+
+    static void readOperations(QFileDevice *in, QList<OperationBlob> *operations);
+    static void writeOperations(QFileDevice *out, const QList<OperationBlob> &operations);
 };
 
 } // namespace QInstaller
@@ -41,13 +41,24 @@
 #include <QFlags>
 #include <QUuid>
 
+#include <errno.h>
+#include <string.h>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
 namespace QInstaller {
 
 /*!
     \class QInstaller::OperationBlob
     \inmodule QtInstallerFramework
-    \brief The OperationBlob class is a textual representation of an operation that can be
+    \brief The OperationBlob class is a serialized representation of an operation that can be
         instantiated and executed by the Qt Installer Framework.
+
+    Blobs read from the operation journal carry the binary record written by
+    KDUpdater::UpdateOperation::toBinary() in \l data. Blobs read from binaries written by older
+    versions of the framework carry the XML representation in \l xml instead.
 */
 
 /*!
@@ -57,6 +68,13 @@ namespace QInstaller {
     \a x for the XML representation of the operation.
 */
 
+/*!
+    \fn OperationBlob::OperationBlob(const QString &n, const QByteArray &d)
+
+    Constructs the operation blob with the given arguments, while \a n stands for the name part and
+    \a d for the binary record of the operation.
+*/
+
 /*!
     \variable QInstaller::OperationBlob::name
     \brief The name of the operation.
@@ -67,6 +85,11 @@ namespace QInstaller {
     \brief The XML representation of the operation.
 */
 
+/*!
+    \variable QInstaller::OperationBlob::data
+    \brief The binary record of the operation.
+*/
+
 /*!
     \class QInstaller::Resource
     \inmodule QtInstallerFramework
@@ -99,6 +122,7 @@ Resource::Resource(const QString &path)
     : m_file(path)
     , m_name(QFileInfo(path).fileName().toUtf8())
     , m_segment(Range<qint64>::fromStartAndLength(0, m_file.size()))
+    , m_mappedData(0)
 {
 }
 
@@ -109,6 +133,7 @@ Resource::Resource(const QString &path, const QByteArray &name)
     : m_file(path)
     , m_name(name)
     , m_segment(Range<qint64>::fromStartAndLength(0, m_file.size()))
+    , m_mappedData(0)
 {
 }
 
@@ -119,6 +144,7 @@ Resource::Resource(const QString &path, const Range<qint64> &segment)
     : m_file(path)
     , m_name(QFileInfo(path).fileName().toUtf8())
     , m_segment(segment)
+    , m_mappedData(0)
 {
 }
 
@@ -170,9 +196,15 @@ bool Resource::open()
     }
 
     if (!QIODevice::open(QIODevice::ReadOnly)) {
+        m_file.close();
         setErrorString(tr("Could not open Resource '%1' read-only.").arg(QString::fromUtf8(m_name)));
         return false;
     }
+
+    // Map the segment, so reads become plain memory copies. If the file cannot be mapped, reads
+    // fall back to positional reads on the file.
+    if (m_segment.length() > 0)
+        m_mappedData = m_file.map(m_segment.start(), m_segment.length(), QFileDevice::NoOptions);
     return true;
 }
 /*!
@@ -180,6 +212,10 @@ bool Resource::open()
  */
 void Resource::close()
 {
+    if (m_mappedData) {
+        m_file.unmap(m_mappedData);
+        m_mappedData = 0;
+    }
     m_file.close();
     QIODevice::close();
 }
@@ -198,15 +234,31 @@ qint64 Resource::size() const
 qint64 Resource::readData(char* data, qint64 maxSize)
 {
     // check if there is anything left to read
-    maxSize = qMin<quint64>(maxSize, m_segment.length() - pos());
+    maxSize = qMin<qint64>(maxSize, m_segment.length() - pos());
     if (maxSize <= 0)
         return 0;
 
-    const qint64 p = m_file.pos();
-    m_file.seek(m_segment.start() + pos());
-    const qint64 amountRead = m_file.read(data, maxSize);
-    m_file.seek(p);
+    if (m_mappedData) {
+        memcpy(data, m_mappedData + pos(), size_t(maxSize));
+        return maxSize;
+    }
+
+#ifdef Q_OS_UNIX
+    // read at the absolute offset, avoids having to seek the underlying file back and forth
+    ssize_t amountRead;
+    do {
+        amountRead = ::pread(m_file.handle(), data, size_t(maxSize), m_segment.start() + pos());
+    } while (amountRead < 0 && errno == EINTR);
+    if (amountRead < 0)
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
     return amountRead;
+#else
+    if (!m_file.seek(m_segment.start() + pos())) {
+        setErrorString(m_file.errorString());
+        return -1;
+    }
+    return m_file.read(data, maxSize);
+#endif
 }
 
 /*!
@@ -230,19 +282,52 @@ qint64 Resource::writeData(const char* data, qint64 maxSize)
     \overload
 
     Copies the resource data of \a resource to a file called \a out. Throws Error on failure.
+
+    On Linux the data is copied inside the kernel if \a out is backed by a file descriptor. Otherwise
+    the data is written straight from the memory mapped resource, or through a large intermediate
+    buffer if the resource could not be mapped.
 */
 void Resource::copyData(Resource *resource, QFileDevice *out)
 {
-    qint64 left = resource->size();
-    char data[4096];
+    qint64 left = resource->size() - resource->pos();
+
+    const int outHandle = out->handle();
+    if (left > 0 && outHandle >= 0 && out->flush()) {
+        const qint64 outPos = out->pos();
+        const qint64 copied = QInstaller::kernelCopy(resource->m_file.handle(),
+            resource->m_segment.start() + resource->pos(), outHandle, left);
+        if (copied > 0) {
+            // the kernel advanced the descriptor offset, sync both devices
+            out->seek(outPos + copied);
+            resource->seek(resource->pos() + copied);
+            left -= copied;
+        }
+    }
+
+    if (resource->m_mappedData) {
+        while (left > 0) {
+            const qint64 len = qMin<qint64>(left, Q_INT64_C(0x40000000));
+            const qint64 bytesWritten = out->write(reinterpret_cast<const char *>(
+                resource->m_mappedData + resource->pos()), len);
+            if (bytesWritten != len) {
+                throw QInstaller::Error(tr("Write failed after %1 bytes: %2")
+                    .arg(QString::number(resource->size() - left), out->errorString()));
+            }
+            resource->seek(resource->pos() + len);
+            left -= len;
+        }
+        return;
+    }
+
+    QByteArray buffer(qMin<qint64>(left, 1024 * 1024), Qt::Uninitialized);
     while (left > 0) {
-        const qint64 len = qMin<qint64>(left, 4096);
-        const qint64 bytesRead = resource->read(data, len);
+        const qint64 len = qMin<qint64>(left, buffer.size());
+        const qint64 bytesRead = resource->read(buffer.data(), len);
         if (bytesRead != len) {
             throw QInstaller::Error(tr("Read failed after %1 bytes: %2")
                 .arg(QString::number(resource->size() - left), resource->errorString()));
         }
-        const qint64 bytesWritten = out->write(data, len);
+        const qint64 bytesWritten = out->write(buffer.constData(), len);
         if (bytesWritten != len) {
             throw QInstaller::Error(tr("Write failed after %1 bytes: %2")
                 .arg(QString::number(resource->size() - left), out->errorString()));
@@ -295,12 +380,17 @@ void ResourceCollection::setName(const QByteArray &name)
 
 /*!
     Appends \a resource to this collection. The collection takes ownership of \a resource.
+
+    The resource is indexed by the name it has at this point, so the name should not be changed
+    afterwards.
  */
 void ResourceCollection::appendResource(const QSharedPointer<Resource>& resource)
 {
     Q_ASSERT(resource);
     resource->setParent(0);
     m_resources.append(resource);
+    if (!m_resourcesByName.contains(resource->name()))
+        m_resourcesByName.insert(resource->name(), resource);
 }
 
 /*!
@@ -322,15 +412,12 @@ QList<QSharedPointer<Resource> > ResourceCollection::resources() const
 }
 
 /*!
-    Returns the resource associated with the name \a name.
+    Returns the resource associated with the name \a name. If there is more than one resource
+    with that name, the one appended first is returned.
 */
 QSharedPointer<Resource> ResourceCollection::resourceByName(const QByteArray &name) const
 {
-    foreach (const QSharedPointer<Resource>& i, m_resources) {
-        if (i->name() == name)
-            return i;
-    }
-    return QSharedPointer<Resource>();
+    return m_resourcesByName.value(name);
 }
 
 
@@ -40,6 +40,7 @@
 
 #include <QCoreApplication>
 #include <QtCore/private/qfsfileengine_p.h>
+#include <QHash>
 #include <QList>
 #include <QSharedPointer>
 
@@ -48,8 +49,11 @@ namespace QInstaller {
 struct OperationBlob {
     OperationBlob(const QString &n, const QString &x)
         : name(n), xml(x) {}
+    OperationBlob(const QString &n, const QByteArray &d)
+        : name(n), data(d) {}
     QString name;
     QString xml;
+    QByteArray data;
 };
 
 
@@ -90,6 +94,7 @@ private:
     QFSFileEngine m_file;
     QByteArray m_name;
     Range<qint64> m_segment;
+    uchar *m_mappedData;
 };
 
 
@@ -113,6 +118,7 @@ public:
 private:
     QByteArray m_name;
     QList<QSharedPointer<Resource> > m_resources;
+    QHash<QByteArray, QSharedPointer<Resource> > m_resourcesByName;
 };
 
 
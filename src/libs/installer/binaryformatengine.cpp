@@ -34,6 +34,8 @@
 
 #include "binaryformatengine.h"
 
+#include "errors.h"
+
 namespace {
 
 class StringListIterator : public QAbstractFileEngineIterator
@@ -85,7 +87,8 @@ namespace QInstaller {
 */
 BinaryFormatEngine::BinaryFormatEngine(const QHash<QByteArray, ResourceCollection> &collections,
         const QString &fileName)
-    : m_resource(0)
+    : m_collection(QByteArray())
+    , m_resource(0)
     , m_collections(collections)
 {
     setFileName(fileName);
@@ -101,18 +104,38 @@ void BinaryFormatEngine::setFileName(const QString &file)
 {
     m_fileNamePath = file;
 
+    QByteArray collectionName;
+    QByteArray resourceName;
+    splitFileName(m_fileNamePath, &collectionName, &resourceName);
+
+    m_collection = m_collections.value(collectionName, ResourceCollection(collectionName));
+    m_resource = m_collection.resourceByName(resourceName);
+}
+
+/*!
+    Splits \a fileName, which needs to be in the form of
+    \c {installer://collectionName/resourceName}, into \a collectionName and \a resourceName.
+    Trailing separators are ignored, as well as any path elements following the resource name.
+*/
+void BinaryFormatEngine::splitFileName(const QString &fileName, QByteArray *collectionName,
+    QByteArray *resourceName)
+{
     static const QChar sep = QLatin1Char('/');
     static const QString prefix = QLatin1String("installer://");
-    Q_ASSERT(m_fileNamePath.toLower().startsWith(prefix));
-
-    // cut the prefix
-    QString path = m_fileNamePath.mid(prefix.length());
-    while (path.endsWith(sep))
-        path.chop(1);
+    Q_ASSERT(fileName.startsWith(prefix, Qt::CaseInsensitive));
+
+    const int collectionStart = prefix.length();
+    const int collectionEnd = fileName.indexOf(sep, collectionStart);
+    if (collectionEnd < 0) {
+        *collectionName = fileName.mid(collectionStart).toUtf8();
+        resourceName->clear();
+        return;
+    }
+    *collectionName = fileName.mid(collectionStart, collectionEnd - collectionStart).toUtf8();
 
-    m_collection = m_collections.value(path.section(sep, 0, 0).toUtf8());
-    m_collection.setName(path.section(sep, 0, 0).toUtf8());
-    m_resource = m_collection.resourceByName(path.section(sep, 1, 1).toUtf8());
+    const int resourceEnd = fileName.indexOf(sep, collectionEnd + 1);
+    *resourceName = fileName.mid(collectionEnd + 1, resourceEnd < 0 ? -1
+        : resourceEnd - collectionEnd - 1).toUtf8();
 }
 
 /*!
@@ -195,24 +218,14 @@ bool BinaryFormatEngine::copy(const QString &newName)
     if (!target.open(QIODevice::WriteOnly))
         return false;
 
-    qint64 bytesLeft = size();
     if (!open(QIODevice::ReadOnly))
         return false;
 
-    char data[4096];
-    while(bytesLeft > 0) {
-        const qint64 len = qMin<qint64>(bytesLeft, 4096);
-        const qint64 bytesRead = read(data, len);
-        if (bytesRead != len) {
-            close();
-            return false;
-        }
-        const qint64 bytesWritten = target.write(data, len);
-        if (bytesWritten != len) {
-            close();
-            return false;
-        }
-        bytesLeft -= len;
+    try {
+        m_resource->copyData(&target);
+    } catch (const Error &) {
+        close();
+        return false;
     }
     close();
 
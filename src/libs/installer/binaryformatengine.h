@@ -50,6 +50,8 @@ public:
         const QString &fileName);
 
     void setFileName(const QString &file);
+    static void splitFileName(const QString &fileName, QByteArray *collectionName,
+        QByteArray *resourceName);
 
     bool copy(const QString &newName);
     bool close();
@@ -43,6 +43,9 @@ namespace QInstaller {
     \inmodule QtInstallerFramework
     \brief The BinaryFormatEngineHandler class provides a way to register resource collections and
         resource files.
+
+    File engines are created from any thread that accesses a file, while resources can be
+    registered by the thread downloading them. All functions are thread-safe.
 */
 
 /*!
@@ -53,8 +56,11 @@ namespace QInstaller {
 */
 QAbstractFileEngine *BinaryFormatEngineHandler::create(const QString &fileName) const
 {
-    return fileName.startsWith(QLatin1String("installer://"), Qt::CaseInsensitive )
-        ? new BinaryFormatEngine(m_resources, fileName) : 0;
+    if (!fileName.startsWith(QLatin1String("installer://"), Qt::CaseInsensitive ))
+        return 0;
+
+    QReadLocker _(&m_lock);
+    return new BinaryFormatEngine(m_resources, fileName);
 }
 
 /*!
@@ -62,6 +68,7 @@ QAbstractFileEngine *BinaryFormatEngineHandler::create(const QString &fileName)
 */
 void BinaryFormatEngineHandler::clear()
 {
+    QWriteLocker _(&m_lock);
     m_resources.clear();
 }
 
@@ -79,6 +86,7 @@ BinaryFormatEngineHandler *BinaryFormatEngineHandler::instance()
 */
 void BinaryFormatEngineHandler::registerResources(const QList<ResourceCollection> &collections)
 {
+    QWriteLocker _(&m_lock);
     foreach (const ResourceCollection &collection, collections) {
         if (ProductKeyCheck::instance()->isValidPackage(QString::fromUtf8(collection.name())))
             m_resources.insert(collection.name(), collection);
@@ -95,24 +103,18 @@ void BinaryFormatEngineHandler::registerResources(const QList<ResourceCollection
 void
 BinaryFormatEngineHandler::registerResource(const QString &fileName, const QString &resourcePath)
 {
-    static const QChar sep = QChar::fromLatin1('/');
-    static const QString prefix = QString::fromLatin1("installer://");
-    Q_ASSERT(fileName.toLower().startsWith(prefix));
-
-    // cut the prefix
-    QString path = fileName.mid(prefix.length());
-    while (path.endsWith(sep))
-        path.chop(1);
-
-    const QByteArray resourceName = path.section(sep, 1, 1).toUtf8();
-    const QByteArray collectionName = path.section(sep, 0, 0).toUtf8();
+    QByteArray collectionName;
+    QByteArray resourceName;
+    BinaryFormatEngine::splitFileName(fileName, &collectionName, &resourceName);
 
     if (!ProductKeyCheck::instance()->isValidPackage(QString::fromUtf8(collectionName)))
         return;
 
-    m_resources[collectionName].setName(collectionName);
-    m_resources[collectionName].appendResource(QSharedPointer<Resource>(new Resource(resourcePath,
-        resourceName)));
+    QWriteLocker _(&m_lock);
+    QHash<QByteArray, ResourceCollection>::iterator it = m_resources.find(collectionName);
+    if (it == m_resources.end())
+        it = m_resources.insert(collectionName, ResourceCollection(collectionName));
+    it->appendResource(QSharedPointer<Resource>(new Resource(resourcePath, resourceName)));
 }
 
 } // namespace QInstaller
@@ -38,6 +38,7 @@
 #include "binaryformat.h"
 
 #include <QtCore/private/qabstractfileengine_p.h>
+#include <QReadWriteLock>
 
 namespace QInstaller {
 
@@ -59,6 +60,7 @@ private:
     ~BinaryFormatEngineHandler() {}
 
 private:
+    mutable QReadWriteLock m_lock;
     QHash<QByteArray, ResourceCollection> m_resources;
 };
 
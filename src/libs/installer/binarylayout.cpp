@@ -46,11 +46,13 @@
         Plain data (QResource)
     [Format]
     ----------------------------------------------------------
+    Journal marker (qint64)
+    Journal version (qint64)
     Operation count (qint64)
     Operation entry [1 ... n]
     [Format]
         Name (qint64, QString)
-        XML (qint64, QString)
+        Binary record (qint64, QByteArray)
     [Format]
     Operation count (qint64)
     ----------------------------------------------------------
@@ -99,4 +101,8 @@
     Magic cookie (qint64)
 
     \endcode
+
+    Binaries written by older versions of the framework start the operations block with the
+    operation count and store every operation entry as name and XML (qint64, QString) instead.
+    BinaryContent::readOperations() reads both formats.
 */
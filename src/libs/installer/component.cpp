@@ -1171,25 +1171,19 @@ bool Component::isAutoDependOn(const QSet<QString> &componentsToInstall) const
 {
     // If there is no auto depend on value or the value is empty, we have nothing todo. The component does
     // not need to be installed as an auto dependency.
-    QStringList autoDependOnList = autoDependencies();
+    const QStringList autoDependOnList = autoDependencies();
     if (autoDependOnList.isEmpty())
         return false;
 
-    QSet<QString> components = componentsToInstall;
-    const QStringList installedPackages = d->m_core->localInstalledPackages().keys();
-    foreach (const QString &name, installedPackages)
-        components.insert(name);
-
-    foreach (const QString &component, components) {
-        autoDependOnList.removeAll(component);
-        if (autoDependOnList.isEmpty()) {
-            // If all components in the isAutoDependOn field are already installed or selected for
-            // installation, this component needs to be installed as well.
-            return true;
-        }
+    const LocalPackagesHash installedPackages = d->m_core->localInstalledPackages();
+    foreach (const QString &component, autoDependOnList) {
+        if (!componentsToInstall.contains(component) && !installedPackages.contains(component))
+            return false;
     }
 
-    return false;
+    // If all components in the isAutoDependOn field are already installed or selected for
+    // installation, this component needs to be installed as well.
+    return true;
 }
 
 bool Component::isDefault() const
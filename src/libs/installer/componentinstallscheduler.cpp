@@ -0,0 +1,338 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "componentinstallscheduler.h"
+
+#include "component.h"
+#include "downloadarchivesjob.h"
+#include "errors.h"
+#include "graph.h"
+#include "packagemanagercore.h"
+#include "packagemanagercore_p.h"
+
+#include <QtConcurrentRun>
+#include <QtCore/QThread>
+
+namespace QInstaller {
+
+/*!
+    \class QInstaller::ComponentInstallScheduler
+    \inmodule QtInstallerFramework
+    \brief The ComponentInstallScheduler class installs components that do not depend on each
+        other concurrently.
+
+    The scheduler builds a dependency graph of the components to install. A component gets started
+    as soon as all of its dependencies, and optionally its archives, are available. The operations
+    of a single component are still performed one after another, and every performed operation is
+    registered for rollback on the calling thread in the order it finished. Thus the operations of
+    a component are undone before the ones of the components it depends on.
+
+    Only operations reported by isConcurrentOperation() run next to others. Every other operation
+    waits until all running operations are done and blocks the scheduler while it runs.
+
+    Handling a result might spin a nested event loop, for example to ask the user about a failed
+    operation. Finished operations and handled archives are therefore remembered by a wake up
+    flag instead of relying on the scheduler's own event loop to receive them.
+*/
+
+static bool backupAndPerformOperation(Operation *operation)
+{
+    // allow the operation to backup stuff before performing the operation
+    PackageManagerCorePrivate::performOperation(operation, PackageManagerCorePrivate::Backup);
+    return PackageManagerCorePrivate::performOperation(operation, PackageManagerCorePrivate::Perform);
+}
+
+/*!
+    Creates a scheduler for installing \a components using \a corePrivate. The list is expected
+    to be in installation order, as returned by PackageManagerCore::orderedComponentsToInstall().
+*/
+ComponentInstallScheduler::ComponentInstallScheduler(PackageManagerCorePrivate *corePrivate,
+        const QList<Component*> &components)
+    : m_corePrivate(corePrivate)
+    , m_archivesJob(0)
+    , m_maxConcurrentComponents(qMax(1, QThread::idealThreadCount()))
+    , m_runningOperations(0)
+    , m_finishedTasks(0)
+    , m_exclusiveRunning(false)
+    , m_failed(false)
+    , m_wakeUpPending(false)
+{
+    QHash<Component*, int> indexes;
+    Graph<Component*> graph(components);
+    foreach (Component *component, components) {
+        indexes.insert(component, m_tasks.count());
+
+        Task task;
+        task.component = component;
+        m_tasks.append(task);
+
+        const QStringList dependencies = component->dependencies() + component->autoDependencies();
+        foreach (const QString &dependency, dependencies) {
+            Component *dependencyComponent = corePrivate->m_core->componentByName(dependency);
+            if (dependencyComponent && dependencyComponent != component
+                && components.contains(dependencyComponent)) {
+                    graph.addEdge(component, dependencyComponent);
+            }
+        }
+    }
+
+    int neededArchives = 0;
+    for (int i = 0; i < m_tasks.count(); ++i) {
+        Task &task = m_tasks[i];
+        neededArchives += task.component->downloadableArchives().count();
+        task.neededArchives = neededArchives;
+
+        foreach (Component *dependency, graph.edges(task.component)) {
+            const int dependencyIndex = indexes.value(dependency);
+            // a dependency listed after its dependee must be a cycle, ignore the edge then and
+            // fall back to the given order
+            if (dependencyIndex >= i)
+                continue;
+            ++task.pendingDependencies;
+            m_tasks[dependencyIndex].dependents.append(i);
+        }
+        if (task.pendingDependencies == 0)
+            m_readyTasks.append(i);
+    }
+}
+
+ComponentInstallScheduler::~ComponentInstallScheduler()
+{
+    for (int i = 0; i < m_tasks.count(); ++i)
+        delete m_tasks.at(i).watcher;
+}
+
+/*!
+    Makes the scheduler wait for the archives of a component to be handled by \a archivesJob
+    before it starts installing the component.
+*/
+void ComponentInstallScheduler::setArchivesJob(DownloadArchivesJob *archivesJob)
+{
+    m_archivesJob = archivesJob;
+    if (m_archivesJob) {
+        QObject::connect(m_archivesJob, &DownloadArchivesJob::archivesHandled, &m_loop,
+            [this]() { wakeUp(); });
+        QObject::connect(m_archivesJob, &KDJob::finished, &m_loop, [this]() { wakeUp(); });
+    }
+}
+
+/*!
+    Sets the maximum number of components that are installed at the same time to \a count.
+*/
+void ComponentInstallScheduler::setMaxConcurrentComponents(int count)
+{
+    m_maxConcurrentComponents = qMax(1, count);
+}
+
+/*!
+    Returns \c true if \a operation may be performed while operations of other components are
+    running.
+*/
+bool ComponentInstallScheduler::isConcurrentOperation(Operation *operation)
+{
+    if (operation->value(QLatin1String("admin")).toBool())
+        return false;
+
+    // Operations whose backup or undo depends on what is found at the target are left out on
+    // purpose: Mkdir only undoes the directories it created itself, Copy backs up whatever file
+    // exists at that moment, and CopyDirectory removes the directories it created. If two
+    // components touched the same target concurrently, the result of the undo would depend on
+    // timing. Extract only undoes the files it recorded as extracted.
+    const QString name = operation->name();
+    return name == QLatin1String("Extract") || name == QLatin1String("MinimumProgress");
+}
+
+/*!
+    Installs all components, registering each performed operation. Blocks until every component
+    has been installed, while still processing events. Throws if the installation failed or has
+    been canceled; in that case all running operations are waited for before.
+*/
+void ComponentInstallScheduler::run(double progressOperationSize, bool adminRightsGained)
+{
+    forever {
+        m_wakeUpPending = false;
+        bool started = false;
+        try {
+            collectFinishedOperations();
+            if (!m_failed && m_corePrivate->statusCanceledOrFailed())
+                throw Error(PackageManagerCorePrivate::tr("Installation canceled by user"));
+            if (!m_failed)
+                started = startOperations(progressOperationSize, adminRightsGained);
+        } catch (const Error &error) {
+            m_failed = true;
+            m_errorString = error.message();
+        }
+
+        if (m_runningOperations == 0) {
+            if (m_failed)
+                throw Error(m_errorString);
+            if (m_finishedTasks == m_tasks.count())
+                return;
+            if (started)
+                continue;   // components without operations have been completed
+
+            // nothing is running and nothing could be started, so we are waiting for archives
+            if (!m_archivesJob || m_archivesJob->isFinished()) {
+                if (m_archivesJob)
+                    m_corePrivate->finishArchivesDownload(m_archivesJob);
+                throw Error(PackageManagerCorePrivate::tr("Unresolvable component dependencies "
+                    "while installing."));
+            }
+        }
+
+        // a wake up might have been delivered by a nested event loop while handling results
+        if (!m_wakeUpPending)
+            m_loop.exec();
+    }
+}
+
+void ComponentInstallScheduler::wakeUp()
+{
+    m_wakeUpPending = true;
+    m_loop.quit();
+}
+
+bool ComponentInstallScheduler::isReady(const Task &task) const
+{
+    if (task.pendingDependencies > 0)
+        return false;
+    if (!m_archivesJob || m_archivesJob->isFinished())
+        return true;
+    return m_archivesJob->numberOfHandledArchives() >= task.neededArchives;
+}
+
+/*!
+    Starts the next operation of as many ready components as allowed. Returns \c true if at least
+    one operation has been started.
+*/
+bool ComponentInstallScheduler::startOperations(double progressOperationSize, bool adminRightsGained)
+{
+    bool started = false;
+    foreach (int index, m_readyTasks) {
+        if (m_exclusiveRunning || m_runningOperations >= m_maxConcurrentComponents)
+            break;
+
+        Task &task = m_tasks[index];
+        if (task.running || !isReady(task))
+            continue;
+
+        if (task.nextOperation == 0 && task.operations.isEmpty())
+            task.operations = m_corePrivate->beginComponentInstallation(task.component);
+
+        if (task.nextOperation == task.operations.count()) {
+            // components without any operation
+            completeTask(index);
+            return true;
+        }
+
+        const bool concurrent = isConcurrentOperation(task.operations.at(task.nextOperation));
+        if (!concurrent && m_runningOperations > 0)
+            break;  // let the running operations drain, keeps the installation order for the rest
+
+        startOperation(&task, progressOperationSize, adminRightsGained);
+        m_exclusiveRunning = !concurrent;
+        started = true;
+    }
+    return started;
+}
+
+void ComponentInstallScheduler::startOperation(Task *task, double progressOperationSize,
+    bool adminRightsGained)
+{
+    Operation *operation = task->operations.at(task->nextOperation);
+    task->becameAdmin = m_corePrivate->prepareOperation(operation, progressOperationSize,
+        adminRightsGained);
+    task->running = operation;
+
+    if (!task->watcher) {
+        task->watcher = new QFutureWatcher<bool>;
+        QObject::connect(task->watcher, &QFutureWatcherBase::finished, &m_loop, [this]() { wakeUp(); },
+            Qt::QueuedConnection);
+    }
+    task->watcher->setFuture(QtConcurrent::run(backupAndPerformOperation, operation));
+    ++m_runningOperations;
+}
+
+/*!
+    Registers the results of all finished operations. Failures are handled on the calling thread,
+    so the user might get asked whether to retry or ignore a failed operation. Once the
+    installation failed, the remaining results are only registered for rollback.
+*/
+void ComponentInstallScheduler::collectFinishedOperations()
+{
+    for (int i = 0; i < m_tasks.count(); ++i) {
+        Task &task = m_tasks[i];
+        if (!task.running || !task.watcher->isFinished())
+            continue;
+
+        Operation *operation = task.running;
+        const bool ok = task.watcher->result();
+        task.running = 0;
+        --m_runningOperations;
+        if (m_exclusiveRunning && m_runningOperations == 0)
+            m_exclusiveRunning = false;
+
+        if (m_failed) {
+            // do not ask the user again, just remember what needs to be undone
+            if (ok || operation->error() > Operation::InvalidArguments)
+                m_corePrivate->addPerformed(operation);
+            continue;
+        }
+
+        try {
+            m_corePrivate->finishOperation(task.component, operation, ok, task.becameAdmin);
+            if (++task.nextOperation == task.operations.count())
+                completeTask(i);
+        } catch (const Error &error) {
+            m_failed = true;
+            m_errorString = error.message();
+        }
+    }
+}
+
+void ComponentInstallScheduler::completeTask(int index)
+{
+    Task &task = m_tasks[index];
+    m_corePrivate->finishComponentInstallation(task.component);
+    m_readyTasks.removeOne(index);
+    ++m_finishedTasks;
+
+    foreach (int dependent, task.dependents) {
+        if (--m_tasks[dependent].pendingDependencies == 0)
+            m_readyTasks.append(dependent);
+    }
+    std::sort(m_readyTasks.begin(), m_readyTasks.end());
+}
+
+} // namespace QInstaller
@@ -0,0 +1,110 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef COMPONENTINSTALLSCHEDULER_H
+#define COMPONENTINSTALLSCHEDULER_H
+
+#include "qinstallerglobal.h"
+
+#include <QtCore/QEventLoop>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QList>
+
+namespace QInstaller {
+
+class Component;
+class DownloadArchivesJob;
+class PackageManagerCorePrivate;
+
+class ComponentInstallScheduler
+{
+    Q_DISABLE_COPY(ComponentInstallScheduler)
+
+public:
+    ComponentInstallScheduler(PackageManagerCorePrivate *corePrivate, const QList<Component*> &components);
+    ~ComponentInstallScheduler();
+
+    void setArchivesJob(DownloadArchivesJob *archivesJob);
+    void setMaxConcurrentComponents(int count);
+
+    void run(double progressOperationSize, bool adminRightsGained);
+
+    static bool isConcurrentOperation(Operation *operation);
+
+private:
+    struct Task
+    {
+        Task()
+            : component(0), nextOperation(0), pendingDependencies(0), neededArchives(0)
+            , running(0), becameAdmin(false), watcher(0)
+        {}
+
+        Component *component;
+        OperationList operations;
+        int nextOperation;
+        int pendingDependencies;
+        int neededArchives;
+        QList<int> dependents;
+
+        Operation *running;
+        bool becameAdmin;
+        QFutureWatcher<bool> *watcher;
+    };
+
+    bool isReady(const Task &task) const;
+    bool startOperations(double progressOperationSize, bool adminRightsGained);
+    void startOperation(Task *task, double progressOperationSize, bool adminRightsGained);
+    void collectFinishedOperations();
+    void completeTask(int index);
+    void wakeUp();
+
+private:
+    PackageManagerCorePrivate *const m_corePrivate;
+    QList<Task> m_tasks;
+    QList<int> m_readyTasks;
+    DownloadArchivesJob *m_archivesJob;
+    QEventLoop m_loop;
+
+    int m_maxConcurrentComponents;
+    int m_runningOperations;
+    int m_finishedTasks;
+    bool m_exclusiveRunning;
+    bool m_failed;
+    bool m_wakeUpPending;
+    QString m_errorString;
+};
+
+} // namespace QInstaller
+
+#endif // COMPONENTINSTALLSCHEDULER_H
@@ -86,6 +86,8 @@ static const QLatin1String scWizardStyle("WizardStyle");
 static const QLatin1String scTitleColor("TitleColor");
 static const QLatin1String scWizardDefaultWidth("WizardDefaultWidth");
 static const QLatin1String scWizardDefaultHeight("WizardDefaultHeight");
+static const QLatin1String scMaxConcurrentDownloads("MaxConcurrentDownloads");
+static const QLatin1String scMaxConcurrentDownloadsPerHost("MaxConcurrentDownloadsPerHost");
 static const QLatin1String scProductUUID("ProductUUID");
 static const QLatin1String scAllUsers("AllUsers");
 }
@@ -37,6 +37,7 @@
 #include "component.h"
 #include "messageboxhandler.h"
 #include "packagemanagercore.h"
+#include "settings.h"
 #include "utils.h"
 
 #include "kdupdaterfiledownloader.h"
@@ -48,6 +49,8 @@
 using namespace QInstaller;
 using namespace KDUpdater;
 
+static const int scProgressTimerInterval = 100; // ms
+
 
 /*!
     Creates a new DownloadArchivesJob with \a parent.
@@ -55,12 +58,16 @@ using namespace KDUpdater;
 DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
     : KDJob(core)
     , m_core(core)
-    , m_downloader(0)
     , m_archivesDownloaded(0)
     , m_archivesToDownloadCount(0)
+    , m_maxConcurrentDownloads(core->settings().maxConcurrentDownloads())
+    , m_maxConcurrentDownloadsPerHost(core->settings().maxConcurrentDownloadsPerHost())
+    , m_nextArchiveToRegister(0)
     , m_canceled(false)
-    , m_lastFileProgress(0)
-    , m_progressChangedTimerId(0)
+    , m_finished(false)
+    , m_paused(false)
+    , m_lastProgress(0)
+    , m_progressTimerId(0)
 {
     setCapabilities(Cancelable);
 }
@@ -70,8 +77,11 @@ DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
 */
 DownloadArchivesJob::~DownloadArchivesJob()
 {
-    if (m_downloader)
-        m_downloader->deleteLater();
+    foreach (FileDownloader *downloader, m_activeTransfers.keys()) {
+        downloader->disconnect(this);
+        downloader->cancelDownload();
+        downloader->deleteLater();
+    }
 }
 
 /*!
@@ -80,17 +90,63 @@ DownloadArchivesJob::~DownloadArchivesJob()
 */
 void DownloadArchivesJob::setArchivesToDownload(const QList<QPair<QString, QString> > &archives)
 {
-    m_archivesToDownload = archives;
+    m_queuedTransfers.clear();
+    for (int i = 0; i < archives.count(); ++i) {
+        Transfer transfer;
+        transfer.index = i;
+        transfer.archive = archives.at(i);
+        transfer.host = QUrl(archives.at(i).second).host().toLower();
+        m_queuedTransfers.append(transfer);
+    }
     m_archivesToDownloadCount = archives.count();
 }
 
+/*!
+    Sets the directory the archives are downloaded to to \a path. Each archive is stored in a
+    sub directory named after its component.
+*/
+void DownloadArchivesJob::setDownloadDirectory(const QString &path)
+{
+    m_downloadDirectory = path;
+}
+
+/*!
+    Sets the maximum number of archives downloaded in parallel to \a count.
+*/
+void DownloadArchivesJob::setMaxConcurrentDownloads(int count)
+{
+    m_maxConcurrentDownloads = qMax(1, count);
+}
+
+/*!
+    Sets the maximum number of archives downloaded in parallel from a single host to \a count.
+*/
+void DownloadArchivesJob::setMaxConcurrentDownloadsPerHost(int count)
+{
+    m_maxConcurrentDownloadsPerHost = qMax(1, count);
+}
+
 /*!
     \reimp
 */
 void DownloadArchivesJob::doStart()
 {
+    // the job can be started again after it finished or was canceled
+    m_canceled = false;
+    m_finished = false;
+    m_paused = false;
     m_archivesDownloaded = 0;
-    fetchNextArchiveHash();
+    m_nextArchiveToRegister = 0;
+    m_finishedArchives.clear();
+    m_lastProgress = 0;
+
+    if (m_queuedTransfers.isEmpty()) {
+        finish();
+        return;
+    }
+
+    m_progressTimerId = startTimer(scProgressTimerInterval);
+    startQueuedDownloads();
 }
 
 /*!
@@ -99,95 +155,142 @@ void DownloadArchivesJob::doStart()
 void DownloadArchivesJob::doCancel()
 {
     m_canceled = true;
-    if (m_downloader != 0)
-        m_downloader->cancelDownload();
+    foreach (FileDownloader *downloader, m_activeTransfers.keys())
+        downloader->cancelDownload();
+    if (m_activeTransfers.isEmpty())
+        finishWithError(tr("Canceled"), QUrl());
 }
 
-void DownloadArchivesJob::fetchNextArchiveHash()
+/*!
+    Pauses all running downloads and holds back the queued ones. The data received so far is kept,
+    resume() continues the downloads where they stopped, if the server supports it.
+*/
+void DownloadArchivesJob::pause()
 {
-    if (m_core->testChecksum()) {
-        if (m_canceled) {
-            finishWithError(tr("Canceled"));
-            return;
-        }
+    if (m_paused || m_finished)
+        return;
 
-        if (m_archivesToDownload.isEmpty()) {
-            emitFinished();
-            return;
+    m_paused = true;
+    foreach (FileDownloader *downloader, m_activeTransfers.keys())
+        downloader->pauseDownload();
+}
+
+/*!
+    Resumes the downloads paused by pause().
+*/
+void DownloadArchivesJob::resume()
+{
+    if (!m_paused)
+        return;
+
+    m_paused = false;
+    foreach (FileDownloader *downloader, m_activeTransfers.keys())
+        downloader->resumeDownload();
+    startQueuedDownloads();
+}
+
+/*!
+    Starts downloads from the queue until either the global or the per host limit of parallel
+    connections is reached.
+*/
+void DownloadArchivesJob::startQueuedDownloads()
+{
+    if (m_finished || (m_paused && !m_canceled))
+        return;
+
+    if (m_canceled) {
+        if (m_activeTransfers.isEmpty())
+            finishWithError(tr("Canceled"), QUrl());
+        return;
+    }
+
+    QList<Transfer>::iterator it = m_queuedTransfers.begin();
+    while (it != m_queuedTransfers.end() && m_activeTransfers.count() < m_maxConcurrentDownloads) {
+        if (m_activeTransfersPerHost.value(it->host) >= m_maxConcurrentDownloadsPerHost) {
+            ++it;
+            continue;
         }
+        const Transfer transfer = *it;
+        it = m_queuedTransfers.erase(it);
 
-        if (m_downloader)
-            m_downloader->deleteLater();
+        if (m_core->testChecksum())
+            fetchArchiveHash(transfer);
+        else
+            fetchArchive(transfer);
 
-        m_downloader = setupDownloader(QLatin1String(".sha1"));
-        if (!m_downloader) {
-            m_archivesToDownload.removeFirst();
-            QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
+        if (m_finished)
             return;
-        }
+        it = m_queuedTransfers.begin();  // the queue might have changed meanwhile
+    }
+}
 
-        connect(m_downloader, SIGNAL(downloadCompleted()), this, SLOT(finishedHashDownload()),
-            Qt::QueuedConnection);
-        m_downloader->download();
-    } else {
-        QMetaObject::invokeMethod(this, "fetchNextArchive", Qt::QueuedConnection);
+void DownloadArchivesJob::fetchArchiveHash(const Transfer &transfer)
+{
+    FileDownloader *downloader = setupDownloader(transfer.archive, QLatin1String(".sha1"));
+    if (!downloader) {
+        skipArchive(transfer);
+        return;
     }
+
+    m_activeTransfers.insert(downloader, transfer);
+    ++m_activeTransfersPerHost[transfer.host];
+
+    connect(downloader, SIGNAL(downloadCompleted()), this, SLOT(finishedHashDownload()),
+        Qt::QueuedConnection);
+    downloader->download();
 }
 
 void DownloadArchivesJob::finishedHashDownload()
 {
-    Q_ASSERT(m_downloader != 0);
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!downloader || !m_activeTransfers.contains(downloader))
+        return;
+
+    Transfer transfer = takeTransfer(downloader);
+    if (m_finished)
+        return;
 
-    QFile sha1HashFile(m_downloader->downloadedFileName());
+    QFile sha1HashFile(downloader->downloadedFileName());
     if (sha1HashFile.open(QFile::ReadOnly)) {
-        m_currentHash = sha1HashFile.readAll();
-        fetchNextArchive();
+        transfer.hash = sha1HashFile.readAll();
+        fetchArchive(transfer);
     } else {
-        finishWithError(tr("Downloading hash signature failed."));
+        finishWithError(tr("Downloading hash signature failed."), downloader->url());
     }
 }
 
 /*!
-    Fetches the next archive and registers it in the installer.
+    Fetches the archive described by \a transfer. It gets registered in the installer once it
+    and all archives queued before it have been downloaded.
 */
-void DownloadArchivesJob::fetchNextArchive()
+void DownloadArchivesJob::fetchArchive(const Transfer &transfer)
 {
-    if (m_canceled) {
-        finishWithError(tr("Canceled"));
-        return;
-    }
-
-    if (m_archivesToDownload.isEmpty()) {
-        emitFinished();
+    FileDownloader *downloader = setupDownloader(transfer.archive, QString(),
+        m_core->value(QLatin1String("UrlQueryString")));
+    if (!downloader) {
+        skipArchive(transfer);
         return;
     }
 
-    if (m_downloader != 0)
-        m_downloader->deleteLater();
-
-    m_downloader = setupDownloader(QString(), m_core->value(QLatin1String("UrlQueryString")));
-    if (!m_downloader) {
-        m_archivesToDownload.removeFirst();
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-        return;
-    }
+    m_activeTransfers.insert(downloader, transfer);
+    ++m_activeTransfersPerHost[transfer.host];
 
-    emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-    connect(m_downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
-    connect(m_downloader, SIGNAL(downloadCompleted()), this, SLOT(registerFile()), Qt::QueuedConnection);
+    connect(downloader, SIGNAL(downloadProgress(double)), this, SLOT(updateDownloadProgress(double)));
+    connect(downloader, SIGNAL(downloadCompleted()), this, SLOT(registerFile()), Qt::QueuedConnection);
 
-    m_downloader->download();
+    downloader->download();
 }
 
 /*!
-    Emits the global download progress during a single download in a lazy way (uses a timer to reduce to
-    much processChanged).
+    Remembers the progress of a single download. The aggregated progress of all downloads gets
+    emitted in a lazy way by a timer to reduce the amount of progressChanged signals.
 */
-void DownloadArchivesJob::emitDownloadProgress(double progress)
+void DownloadArchivesJob::updateDownloadProgress(double progress)
 {
-    m_lastFileProgress = progress;
-    if (!m_progressChangedTimerId)
-        m_progressChangedTimerId = startTimer(5);
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    QHash<FileDownloader*, Transfer>::iterator it = m_activeTransfers.find(downloader);
+    if (it != m_activeTransfers.end())
+        it->progress = progress;
 }
 
 /*!
@@ -195,24 +298,37 @@ void DownloadArchivesJob::emitDownloadProgress(double progress)
 */
 void DownloadArchivesJob::timerEvent(QTimerEvent *event)
 {
-    if (event->timerId() == m_progressChangedTimerId) {
-        killTimer(m_progressChangedTimerId);
-        m_progressChangedTimerId = 0;
-        emit progressChanged((double(m_archivesDownloaded) + m_lastFileProgress) / m_archivesToDownloadCount);
+    if (event->timerId() != m_progressTimerId || m_archivesToDownloadCount == 0)
+        return;
+
+    double progress = m_finishedArchives.count() + m_nextArchiveToRegister;
+    foreach (const Transfer &transfer, m_activeTransfers)
+        progress += transfer.progress;
+    progress /= m_archivesToDownloadCount;
+
+    if (!qFuzzyCompare(1 + progress, 1 + m_lastProgress)) {
+        m_lastProgress = progress;
+        emit progressChanged(progress);
     }
 }
 
 /*!
-    Registers the just downloaded file in the installer's file system.
+    Verifies the just downloaded file and queues it for registration in the installer's file
+    system.
 */
 void DownloadArchivesJob::registerFile()
 {
-    Q_ASSERT(m_downloader != 0);
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!downloader || !m_activeTransfers.contains(downloader))
+        return;
 
-    if (m_canceled)
+    const Transfer transfer = takeTransfer(downloader);
+    if (m_canceled || m_finished) {
+        startQueuedDownloads();
         return;
+    }
 
-    if (m_core->testChecksum() && m_currentHash != m_downloader->sha1Sum().toHex()) {
+    if (m_core->testChecksum() && transfer.hash != downloader->sha1Sum().toHex()) {
         //TODO: Maybe we should try to download the file again automatically
         const QMessageBox::Button res =
             MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
@@ -221,65 +337,165 @@ void DownloadArchivesJob::registerFile()
             QMessageBox::Retry | QMessageBox::Cancel, QMessageBox::Cancel);
 
         if (res == QMessageBox::Cancel) {
-            finishWithError(tr("Could not verify Hash"));
+            finishWithError(tr("Could not verify Hash"), downloader->url());
             return;
         }
-    } else {
-        ++m_archivesDownloaded;
-        if (m_progressChangedTimerId) {
-            killTimer(m_progressChangedTimerId);
-            m_progressChangedTimerId = 0;
-            emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-        }
-
-        const QPair<QString, QString> pair = m_archivesToDownload.takeFirst();
-        BinaryFormatEngineHandler::instance()->registerResource(pair.first,
-            m_downloader->downloadedFileName());
+        retryOrCancel(transfer, true);
+        return;
     }
-    fetchNextArchiveHash();
+
+    m_finishedArchives.insert(transfer.index, qMakePair(transfer.archive.first,
+        downloader->downloadedFileName()));
+    registerFinishedArchives();
+    startQueuedDownloads();
 }
 
 void DownloadArchivesJob::downloadCanceled()
 {
-    emitFinishedWithError(KDJob::Canceled, m_downloader->errorString());
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    const QString errorString = downloader ? downloader->errorString() : QString();
+    if (downloader && m_activeTransfers.contains(downloader))
+        takeTransfer(downloader);
+    finish(KDJob::Canceled, errorString);
 }
 
 void DownloadArchivesJob::downloadFailed(const QString &error)
 {
-    if (m_canceled)
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!downloader || !m_activeTransfers.contains(downloader))
         return;
 
+    const Transfer transfer = takeTransfer(downloader);
+    if (m_canceled || m_finished) {
+        startQueuedDownloads();
+        return;
+    }
+
     const QMessageBox::StandardButton b =
         MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
         QLatin1String("archiveDownloadError"), tr("Download Error"), tr("Could not download archive: %1 : %2")
-        .arg(m_archivesToDownload.first().second, error), QMessageBox::Retry | QMessageBox::Cancel);
+        .arg(transfer.archive.second, error), QMessageBox::Retry | QMessageBox::Cancel);
 
-    if (b == QMessageBox::Retry)
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-    else
-        downloadCanceled();
+    retryOrCancel(transfer, b == QMessageBox::Retry);
 }
 
-void DownloadArchivesJob::finishWithError(const QString &error)
+/*!
+    Removes the transfer handled by \a downloader from the list of active transfers and frees its
+    connection slot. The downloader itself gets deleted later.
+*/
+DownloadArchivesJob::Transfer DownloadArchivesJob::takeTransfer(FileDownloader *downloader)
+{
+    const Transfer transfer = m_activeTransfers.take(downloader);
+    if (--m_activeTransfersPerHost[transfer.host] <= 0)
+        m_activeTransfersPerHost.remove(transfer.host);
+    downloader->disconnect(this);
+    downloader->deleteLater();
+    return transfer;
+}
+
+/*!
+    Puts \a transfer back in front of the queue if \a retry is \c true, cancels the whole job
+    otherwise.
+*/
+void DownloadArchivesJob::retryOrCancel(const Transfer &transfer, bool retry)
+{
+    if (m_finished)
+        return;
+
+    if (retry) {
+        Transfer again = transfer;
+        again.hash.clear();
+        again.progress = 0;
+        m_queuedTransfers.prepend(again);
+        QMetaObject::invokeMethod(this, "startQueuedDownloads", Qt::QueuedConnection);
+    } else {
+        finish(KDJob::Canceled, tr("Canceled"));
+    }
+}
+
+/*!
+    Marks the archive described by \a transfer as done without registering any file for it.
+*/
+void DownloadArchivesJob::skipArchive(const Transfer &transfer)
+{
+    m_finishedArchives.insert(transfer.index, qMakePair(transfer.archive.first, QString()));
+    registerFinishedArchives();
+}
+
+/*!
+    Registers all finished archives in the installer's file system, keeping the order in which
+    the archives were passed to setArchivesToDownload(), and emits archivesHandled() with the number
+    of archives handled so far. Finishes the job once every archive has been handled.
+*/
+void DownloadArchivesJob::registerFinishedArchives()
+{
+    const int handledArchives = m_nextArchiveToRegister;
+    while (!m_finishedArchives.isEmpty() && m_finishedArchives.firstKey() == m_nextArchiveToRegister) {
+        const QPair<QString, QString> archive = m_finishedArchives.take(m_nextArchiveToRegister);
+        ++m_nextArchiveToRegister;
+        if (archive.second.isEmpty())
+            continue;
+
+        ++m_archivesDownloaded;
+        BinaryFormatEngineHandler::instance()->registerResource(archive.first, archive.second);
+    }
+
+    if (m_nextArchiveToRegister != handledArchives)
+        emit archivesHandled(m_nextArchiveToRegister);
+
+    if (m_nextArchiveToRegister == m_archivesToDownloadCount) {
+        emit progressChanged(1.0);
+        finish();
+    }
+}
+
+void DownloadArchivesJob::finishWithError(const QString &error, const QUrl &url)
 {
-    const FileDownloader *const dl = qobject_cast<const FileDownloader*> (sender());
     const QString msg = tr("Could not fetch archives: %1\nError while loading %2");
-    if (dl != 0)
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, dl->url().toString()));
+    finish(QInstaller::DownloadError, msg.arg(error, url.toString()));
+}
+
+/*!
+    Stops all running downloads and finishes the job with \a error and \a errorString. Subsequent
+    calls are ignored.
+*/
+void DownloadArchivesJob::finish(int error, const QString &errorString)
+{
+    if (m_finished)
+        return;
+    m_finished = true;
+
+    if (m_progressTimerId) {
+        killTimer(m_progressTimerId);
+        m_progressTimerId = 0;
+    }
+
+    foreach (FileDownloader *downloader, m_activeTransfers.keys()) {
+        downloader->disconnect(this);
+        downloader->cancelDownload();
+        downloader->deleteLater();
+    }
+    m_activeTransfers.clear();
+    m_activeTransfersPerHost.clear();
+    m_queuedTransfers.clear();
+
+    if (error == KDJob::NoError)
+        emitFinished();
     else
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, m_downloader->url().toString()));
+        emitFinishedWithError(error, errorString);
 }
 
-KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &suffix, const QString &queryString)
+KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QPair<QString, QString> &archive,
+    const QString &suffix, const QString &queryString)
 {
     KDUpdater::FileDownloader *downloader = 0;
-    const QFileInfo fi = QFileInfo(m_archivesToDownload.first().first);
+    const QFileInfo fi = QFileInfo(archive.first);
     const Component *const component = m_core->componentByName(QFileInfo(fi.path()).fileName());
     if (component) {
         QString fullQueryString;
         if (!queryString.isEmpty())
             fullQueryString = QLatin1String("?") + queryString;
-        const QUrl url(m_archivesToDownload.first().second + suffix + fullQueryString);
+        const QUrl url(archive.second + suffix + fullQueryString);
         const QString &scheme = url.scheme();
         downloader = FileDownloaderFactory::instance().create(scheme, this);
 
@@ -298,7 +514,7 @@ KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &s
             connect(downloader, SIGNAL(downloadStatus(QString)), this, SIGNAL(downloadStatusChanged(QString)));
 
             if (FileDownloaderFactory::isSupportedScheme(scheme)) {
-                downloader->setDownloadedFileName(component->localTempPath() + QLatin1Char('/')
+                downloader->setDownloadedFileName(m_downloadDirectory + QLatin1Char('/')
                     + component->name() + QLatin1Char('/') + fi.fileName() + suffix);
             }
 
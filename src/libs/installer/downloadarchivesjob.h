@@ -37,10 +37,13 @@
 
 #include <kdjob.h>
 
+#include <QtCore/QHash>
+#include <QtCore/QMap>
 #include <QtCore/QPair>
 
 QT_BEGIN_NAMESPACE
 class QTimerEvent;
+class QUrl;
 QT_END_NAMESPACE
 
 namespace KDUpdater {
@@ -61,12 +64,29 @@ public:
     ~DownloadArchivesJob();
 
     int numberOfDownloads() const { return m_archivesDownloaded; }
+    int numberOfHandledArchives() const { return m_nextArchiveToRegister; }
+    bool isFinished() const { return m_finished; }
+    bool isPaused() const { return m_paused; }
     void setArchivesToDownload(const QList<QPair<QString, QString> > &archives);
 
+    QString downloadDirectory() const { return m_downloadDirectory; }
+    void setDownloadDirectory(const QString &path);
+
+    int maxConcurrentDownloads() const { return m_maxConcurrentDownloads; }
+    void setMaxConcurrentDownloads(int count);
+
+    int maxConcurrentDownloadsPerHost() const { return m_maxConcurrentDownloadsPerHost; }
+    void setMaxConcurrentDownloadsPerHost(int count);
+
+public Q_SLOTS:
+    void pause();
+    void resume();
+
 Q_SIGNALS:
     void progressChanged(double progress);
     void outputTextChanged(const QString &progress);
     void downloadStatusChanged(const QString &status);
+    void archivesHandled(int count);
 
 protected:
     void doStart();
@@ -77,27 +97,56 @@ protected Q_SLOTS:
     void registerFile();
     void downloadCanceled();
     void downloadFailed(const QString &error);
-    void finishWithError(const QString &error);
-    void fetchNextArchive();
-    void fetchNextArchiveHash();
     void finishedHashDownload();
-    void emitDownloadProgress(double progress);
+    void updateDownloadProgress(double progress);
+    void startQueuedDownloads();
 
 private:
-    KDUpdater::FileDownloader *setupDownloader(const QString &suffix = QString(), const QString &queryString = QString());
+    struct Transfer
+    {
+        Transfer() : index(-1), progress(0) {}
+
+        int index;
+        QPair<QString, QString> archive;
+        QString host;
+        QByteArray hash;
+        double progress;
+    };
+
+    void fetchArchive(const Transfer &transfer);
+    void fetchArchiveHash(const Transfer &transfer);
+    Transfer takeTransfer(KDUpdater::FileDownloader *downloader);
+    void retryOrCancel(const Transfer &transfer, bool retry);
+    void skipArchive(const Transfer &transfer);
+    void registerFinishedArchives();
+    void finishWithError(const QString &error, const QUrl &url);
+    void finish(int error = KDJob::NoError, const QString &errorString = QString());
+    KDUpdater::FileDownloader *setupDownloader(const QPair<QString, QString> &archive,
+        const QString &suffix = QString(), const QString &queryString = QString());
 
 private:
     PackageManagerCore *m_core;
-    KDUpdater::FileDownloader *m_downloader;
 
     int m_archivesDownloaded;
     int m_archivesToDownloadCount;
-    QList<QPair<QString, QString> > m_archivesToDownload;
+    int m_maxConcurrentDownloads;
+    int m_maxConcurrentDownloadsPerHost;
+    QString m_downloadDirectory;
+
+    QList<Transfer> m_queuedTransfers;
+    QHash<KDUpdater::FileDownloader*, Transfer> m_activeTransfers;
+    QHash<QString, int> m_activeTransfersPerHost;
+
+    // Finished archives, keyed by their position in the download list. The downloaded file name is
+    // empty for archives that have been skipped. Archives are registered strictly in list order.
+    QMap<int, QPair<QString, QString> > m_finishedArchives;
+    int m_nextArchiveToRegister;
 
     bool m_canceled;
-    QByteArray m_currentHash;
-    double m_lastFileProgress;
-    int m_progressChangedTimerId;
+    bool m_finished;
+    bool m_paused;
+    double m_lastProgress;
+    int m_progressTimerId;
 };
 
 } // namespace QInstaller
@@ -54,6 +54,9 @@ AuthenticationRequiredException::AuthenticationRequiredException(Type type, cons
 
 Downloader::Downloader()
     : m_finished(0)
+    , m_maxConcurrentDownloads(DownloadFileTask::DefaultMaxConcurrentDownloads)
+    , m_bytesFinished(0)
+    , m_observer(QCryptographicHash::Sha1)
 {
     connect(&m_nam, SIGNAL(finished(QNetworkReply*)), SLOT(onFinished(QNetworkReply*)));
 }
@@ -72,6 +75,7 @@ void Downloader::download(QFutureInterface<FileTaskResult> &fi, const QList<File
     QNetworkProxyFactory *networkProxyFactory)
 {
     m_items = items;
+    m_queue = items;
     m_futureInterface = &fi;
 
     fi.reportStarted();
@@ -87,12 +91,8 @@ void Downloader::download(QFutureInterface<FileTaskResult> &fi, const QList<File
 
 void Downloader::doDownload()
 {
-    foreach (const FileTaskItem &item, m_items) {
-        if (!startDownload(item))
-            break;
-    }
-
-    if (m_items.isEmpty() || m_futureInterface->isCanceled()) {
+    startQueuedDownloads();
+    if (m_downloads.empty() || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
         emit finished();    // emit finished, so the event loop can shutdown
     }
@@ -169,17 +169,13 @@ void Downloader::onReadyRead()
             written += toWrite;
         }
 
-        data.observer->addSample(read);
-        data.observer->addBytesTransfered(read);
-        data.observer->addCheckSumData(buffer.data(), read);
+        data.bytesReceived += read;
+        data.hash.addData(buffer.data(), read);
+        m_observer.addSample(read);
+        m_observer.addBytesTransfered(read);
 
-        int progress = m_finished * 100;
-        for (const auto &pair : m_downloads)
-            progress += pair.second->observer->progressValue();
-        if (!reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid()) {
-            m_futureInterface->setProgressValueAndText(progress / m_items.count(),
-                data.observer->progressText());
-        }
+        if (!reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid())
+            reportProgress();
     }
 }
 
@@ -198,6 +194,7 @@ void Downloader::onFinished(QNetworkReply *reply)
 
                 FileTaskItem taskItem = data.taskItem;
                 taskItem.insert(TaskRole::SourceFile, url.toString());
+                m_bytesFinished += data.bytesReceived;
                 QNetworkReply *const redirectReply = startDownload(taskItem);
 
                 foreach (const QUrl &redirect, redirects)
@@ -218,25 +215,38 @@ void Downloader::onFinished(QNetworkReply *reply)
 
     const QByteArray ba = reply->readAll();
     if (!ba.isEmpty()) {
-        data.observer->addSample(ba.size());
-        data.observer->addBytesTransfered(ba.size());
-        data.observer->addCheckSumData(ba.data(), ba.size());
+        data.bytesReceived += ba.size();
+        data.hash.addData(ba);
+        m_observer.addSample(ba.size());
+        m_observer.addBytesTransfered(ba.size());
+    }
+
+    // remember the validators of the response, so the next request can be made conditional
+    const bool notModified =
+        (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304);
+    if (data.taskItem.value(TaskRole::ETag).isValid()) {
+        data.taskItem.insert(TaskRole::ETag, reply->rawHeader("ETag"));
+        data.taskItem.insert(TaskRole::LastModified, reply->rawHeader("Last-Modified"));
+        data.taskItem.insert(TaskRole::NotModified, notModified);
     }
 
     const QByteArray expectedCheckSum = data.taskItem.value(TaskRole::Checksum).toByteArray();
-    if (!expectedCheckSum.isEmpty()) {
-        if (expectedCheckSum != data.observer->checkSum().toHex()) {
+    if (!expectedCheckSum.isEmpty() && !notModified) {
+        if (expectedCheckSum != data.hash.result().toHex()) {
             m_futureInterface->reportException(TaskException(tr("Checksum mismatch detected '%1'.")
                 .arg(reply->url().toString())));
         }
     }
-    m_futureInterface->reportResult(FileTaskResult(filename, data.observer->checkSum(), data.taskItem));
+    m_futureInterface->reportResult(FileTaskResult(filename, data.hash.result(), data.taskItem));
 
+    m_bytesFinished += data.bytesReceived;
     m_downloads.erase(reply);
     m_redirects.remove(reply);
     reply->deleteLater();
 
     m_finished++;
+    if (!m_futureInterface->isCanceled())
+        startQueuedDownloads();
     if (m_downloads.empty() || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
         emit finished();    // emit finished, so the event loop can shutdown
@@ -279,9 +289,10 @@ void Downloader::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
     Q_UNUSED(bytesReceived)
     QNetworkReply *const reply = qobject_cast<QNetworkReply *>(sender());
-    if (reply) {
-        const Data &data = *m_downloads[reply];
-        data.observer->setBytesToTransfer(bytesTotal);
+    if (reply && m_downloads.find(reply) != m_downloads.cend()) {
+        m_downloads[reply]->bytesToReceive = bytesTotal;
+        if (!reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid())
+            reportProgress();
     }
 }
 
@@ -331,6 +342,40 @@ bool Downloader::testCanceled()
     return m_futureInterface->isCanceled();
 }
 
+/*
+    Starts queued downloads until the limit of concurrent downloads is reached. Keeping the number
+    of replies small lets QNetworkAccessManager reuse its connections instead of piling up replies
+    waiting for one. Returns \c false if a download could not be started.
+*/
+bool Downloader::startQueuedDownloads()
+{
+    while (!m_queue.isEmpty() && int(m_downloads.size()) < m_maxConcurrentDownloads) {
+        if (!startDownload(m_queue.takeFirst())) {
+            m_queue.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Reports the progress of all downloads, including the ones still queued. A single observer
+    calculates the transfer speed for all of them.
+*/
+void Downloader::reportProgress()
+{
+    int progress = m_finished * 100;
+    qint64 bytesToTransfer = m_bytesFinished;
+    for (const auto &pair : m_downloads) {
+        const Data &data = *pair.second;
+        progress += data.progressValue();
+        bytesToTransfer += qMax(data.bytesToReceive, data.bytesReceived);
+    }
+    m_observer.setBytesToTransfer(bytesToTransfer);
+    m_futureInterface->setProgressValueAndText(progress / m_items.count(),
+        m_observer.progressText());
+}
+
 QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
 {
     QUrl const source = item.source();
@@ -341,7 +386,21 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
         return 0;
     }
 
-    QNetworkReply *reply = m_nam.get(QNetworkRequest(source));
+    QNetworkRequest request(source);
+    if (item.value(TaskRole::ETag).isValid()) {
+        // revalidate with the server instead of getting a possibly stale copy from a proxy cache
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+            QNetworkRequest::AlwaysNetwork);
+
+        const QByteArray eTag = item.value(TaskRole::ETag).toByteArray();
+        if (!eTag.isEmpty())
+            request.setRawHeader("If-None-Match", eTag);
+        const QByteArray lastModified = item.value(TaskRole::LastModified).toByteArray();
+        if (!lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", lastModified);
+    }
+
+    QNetworkReply *reply = m_nam.get(request);
     std::unique_ptr<Data> data(new Data(item));
     m_downloads[reply] = std::move(data);
 
@@ -361,6 +420,7 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
 
 DownloadFileTask::DownloadFileTask(const QList<FileTaskItem> &items)
     : AbstractFileTask()
+    , m_maxConcurrentDownloads(DefaultMaxConcurrentDownloads)
 {
     setTaskItems(items);
 }
@@ -395,6 +455,20 @@ void DownloadFileTask::setProxyFactory(KDUpdater::FileDownloaderProxyFactory *fa
     m_proxyFactory.reset(factory);
 }
 
+int DownloadFileTask::maxConcurrentDownloads() const
+{
+    return m_maxConcurrentDownloads;
+}
+
+/*
+    Sets the maximum number of files downloaded at the same time to \a count. Further files are
+    queued and downloaded in the order they were added.
+*/
+void DownloadFileTask::setMaxConcurrentDownloads(int count)
+{
+    m_maxConcurrentDownloads = qMax(1, count);
+}
+
 void DownloadFileTask::doTask(QFutureInterface<FileTaskResult> &fi)
 {
     QEventLoop el;
@@ -408,6 +482,7 @@ void DownloadFileTask::doTask(QFutureInterface<FileTaskResult> &fi)
                 items[i].insert(TaskRole::Authenticator, QVariant::fromValue(m_authenticator));
         }
     }
+    downloader.setMaxConcurrentDownloads(m_maxConcurrentDownloads);
     downloader.download(fi, items, (m_proxyFactory.isNull() ? 0 : m_proxyFactory->clone()));
     el.exec();  // That's tricky here, we need to run our own event loop to keep QNAM working.
 }
@@ -46,7 +46,10 @@ namespace QInstaller {
 namespace TaskRole {
 enum
 {
-    Authenticator = TaskRole::TargetFile + 10
+    Authenticator = TaskRole::TargetFile + 10,
+    ETag,
+    LastModified,
+    NotModified
 };
 }
 
@@ -85,15 +88,20 @@ class INSTALLER_EXPORT DownloadFileTask : public AbstractFileTask
     Q_DISABLE_COPY(DownloadFileTask)
 
 public:
-    DownloadFileTask() {}
+    // matches the number of connections QNetworkAccessManager keeps open per host
+    enum { DefaultMaxConcurrentDownloads = 6 };
+
+    DownloadFileTask()
+        : m_maxConcurrentDownloads(DefaultMaxConcurrentDownloads) {}
     explicit DownloadFileTask(const FileTaskItem &item)
-        : AbstractFileTask(item) {}
+        : AbstractFileTask(item), m_maxConcurrentDownloads(DefaultMaxConcurrentDownloads) {}
     explicit DownloadFileTask(const QList<FileTaskItem> &items);
 
     explicit DownloadFileTask(const QString &source)
-        : AbstractFileTask(source) {}
+        : AbstractFileTask(source), m_maxConcurrentDownloads(DefaultMaxConcurrentDownloads) {}
     DownloadFileTask(const QString &source, const QString &target)
-        : AbstractFileTask(source, target) {}
+        : AbstractFileTask(source, target)
+        , m_maxConcurrentDownloads(DefaultMaxConcurrentDownloads) {}
 
     void addTaskItem(const FileTaskItem &items);
     void addTaskItems(const QList<FileTaskItem> &items);
@@ -104,11 +112,15 @@ public:
     void setAuthenticator(const QAuthenticator &authenticator);
     void setProxyFactory(KDUpdater::FileDownloaderProxyFactory *factory);
 
+    int maxConcurrentDownloads() const;
+    void setMaxConcurrentDownloads(int count);
+
     void doTask(QFutureInterface<FileTaskResult> &fi);
 
 private:
     friend class Downloader;
     QAuthenticator m_authenticator;
+    int m_maxConcurrentDownloads;
     QScopedPointer<KDUpdater::FileDownloaderProxyFactory> m_proxyFactory;
 };
 
@@ -58,18 +58,31 @@ struct Data
 
     Data()
         : file(Q_NULLPTR)
-        , observer(Q_NULLPTR)
+        , hash(QCryptographicHash::Sha1)
+        , bytesReceived(0)
+        , bytesToReceive(0)
     {}
 
     Data(const FileTaskItem &fti)
         : taskItem(fti)
         , file(Q_NULLPTR)
-        , observer(new FileTaskObserver(QCryptographicHash::Sha1))
+        , hash(QCryptographicHash::Sha1)
+        , bytesReceived(0)
+        , bytesToReceive(0)
     {}
 
+    int progressValue() const
+    {
+        if (bytesToReceive <= 0 || bytesReceived > bytesToReceive)
+            return 0;
+        return 100 * bytesReceived / bytesToReceive;
+    }
+
     FileTaskItem taskItem;
     std::unique_ptr<QFile> file;
-    std::unique_ptr<FileTaskObserver> observer;
+    QCryptographicHash hash;
+    qint64 bytesReceived;
+    qint64 bytesToReceive;
 };
 
 class Downloader : public QObject
@@ -83,6 +96,7 @@ public:
 
     void download(QFutureInterface<FileTaskResult> &fi, const QList<FileTaskItem> &items,
         QNetworkProxyFactory *networkProxyFactory);
+    void setMaxConcurrentDownloads(int count) { m_maxConcurrentDownloads = count; }
 
 signals:
     void finished();
@@ -100,14 +114,20 @@ private slots:
 
 private:
     bool testCanceled();
+    bool startQueuedDownloads();
     QNetworkReply *startDownload(const FileTaskItem &item);
+    void reportProgress();
 
 private:
     QFutureInterface<FileTaskResult> *m_futureInterface;
 
     int m_finished;
+    int m_maxConcurrentDownloads;
+    qint64 m_bytesFinished;
     QNetworkAccessManager m_nam;
     QList<FileTaskItem> m_items;
+    QList<FileTaskItem> m_queue;
+    FileTaskObserver m_observer;
     QMultiHash<QNetworkReply*, QUrl> m_redirects;
     std::unordered_map<QNetworkReply*, std::unique_ptr<Data>> m_downloads;
 };
@@ -64,7 +64,8 @@ bool ExtractArchiveOperation::performOperation()
     Receiver receiver;
     Callback callback;
 
-    connect(&callback, SIGNAL(currentFileChanged(QString)), this, SLOT(fileFinished(QString)));
+    connect(&callback, SIGNAL(currentFileChanged(QString)), this,
+        SIGNAL(outputTextChanged(QString)));
     connect(&callback, SIGNAL(progressChanged(double)), this, SIGNAL(progressChanged(double)));
 
     if (PackageManagerCore *core = this->value(QLatin1String("installer")).value<PackageManagerCore*>()) {
@@ -87,6 +88,14 @@ bool ExtractArchiveOperation::performOperation()
         receiver.runnableFinished(true, QString());
     }
 
+    // remember the files newest first, so that undo removes files before their directories
+    const QStringList &extractedFiles = callback.extractedFiles;
+    QStringList files;
+    files.reserve(extractedFiles.count());
+    for (int i = extractedFiles.count() - 1; i >= 0; --i)
+        files.append(extractedFiles.at(i));
+    setValue(QLatin1String("files"), files + value(QLatin1String("files")).toStringList());
+
     typedef QPair<QString, QString> StringPair;
     QVector<StringPair> backupFiles = callback.backupFiles;
 
@@ -133,14 +142,3 @@ Operation *ExtractArchiveOperation::clone() const
 {
     return new ExtractArchiveOperation();
 }
-
-/*!
-    This slot is direct connected to the caller so please don't call it from another thread in the same time.
-*/
-void ExtractArchiveOperation::fileFinished(const QString &filename)
-{
-    QStringList files = value(QLatin1String("files")).toStringList();
-    files.prepend(filename);
-    setValue(QLatin1String("files"), files);
-    emit outputTextChanged(filename);
-}
@@ -59,9 +59,6 @@ Q_SIGNALS:
     void outputTextChanged(const QString &progress);
     void progressChanged(double);
 
-private Q_SLOTS:
-    void fileFinished(const QString &progress);
-
 private:
     class Callback;
     class Runnable;
@@ -99,6 +99,7 @@ public:
     HRESULT state;
     bool createBackups;
     QVector<QPair<QString, QString> > backupFiles;
+    QStringList extractedFiles;
 
     Callback() : state(S_OK), createBackups(true) {}
 
@@ -129,7 +130,10 @@ public Q_SLOTS:
 protected:
     void setCurrentFile(const QString &filename)
     {
-        emit currentFileChanged(QDir::toNativeSeparators(filename));
+        // called serialized from the extracting thread, the list is read once extraction finished
+        const QString file = QDir::toNativeSeparators(filename);
+        extractedFiles.append(file);
+        emit currentFileChanged(file);
     }
 
     static QString generateBackupName(const QString &fn)
@@ -189,7 +193,7 @@ public:
         }
 
         try {
-            Lib7z::extractArchive(&archive, targetDir, callback);
+            Lib7z::extractArchive(&archive, targetDir, callback, QThread::idealThreadCount());
             emit finished(true, QString());
         } catch (const Lib7z::SevenZipException& e) {
             emit finished(false, tr("Error while extracting '%1': %2").arg(archivePath, e.message()));
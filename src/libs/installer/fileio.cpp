@@ -39,8 +39,133 @@
 
 #include <QCoreApplication>
 #include <QByteArray>
+#include <QFile>
 #include <QFileDevice>
 #include <QString>
+#include <QtConcurrentRun>
+
+#include <errno.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Copies smaller than this are not worth the overhead of writing from a second thread.
+const qint64 scDoubleBufferThreshold = 16 * 1024 * 1024;
+
+qint64 copyBlockSize(qint64 size)
+{
+    // grow the buffer with the amount of data, from 64 KiB up to 4 MiB
+    qint64 blockSize = 64 * 1024;
+    while (blockSize < 4 * 1024 * 1024 && blockSize * 16 < size)
+        blockSize *= 2;
+    return blockSize;
+}
+
+QString writeBlock(QFileDevice *out, const char *data, qint64 size)
+{
+    try {
+        QInstaller::blockingWrite(out, data, size);
+    } catch (const QInstaller::Error &error) {
+        return error.message();
+    }
+    return QString();
+}
+
+// Returns whether \a handle is a descriptor of the regular file opened by \a device in this
+// process. File engines that forward to another process (e.g. the remote file engine of an
+// elevated installation) can report a handle that is only valid in the other process.
+bool isLocalHandle(int handle, const QFileDevice *device)
+{
+    if (handle < 0)
+        return false;
+#ifdef Q_OS_LINUX
+    struct stat handleInfo;
+    struct stat fileInfo;
+    if (::fstat(handle, &handleInfo) != 0 || !S_ISREG(handleInfo.st_mode))
+        return false;
+    if (::stat(QFile::encodeName(device->fileName()).constData(), &fileInfo) != 0)
+        return false;
+    return handleInfo.st_dev == fileInfo.st_dev && handleInfo.st_ino == fileInfo.st_ino;
+#else
+    Q_UNUSED(device)
+    return true;
+#endif
+}
+
+qint64 copyInKernel(QFileDevice *in, QFileDevice *out, qint64 size)
+{
+    if (in->isSequential())
+        return 0;
+
+    const int inHandle = in->handle();
+    const int outHandle = out->handle();
+    if (!isLocalHandle(inHandle, in) || !isLocalHandle(outHandle, out) || !out->flush())
+        return 0;
+
+    const qint64 inPos = in->pos();
+    const qint64 outPos = out->pos();
+    const qint64 copied = QInstaller::kernelCopy(inHandle, inPos, outHandle, size);
+    if (copied > 0) {
+        // the kernel advanced the descriptor offsets, sync both devices
+        in->seek(inPos + copied);
+        out->seek(outPos + copied);
+    }
+    return copied;
+}
+
+void bufferedCopy(QFileDevice *in, QFileDevice *out, qint64 size)
+{
+    const qint64 blockSize = copyBlockSize(size);
+    QByteArray ba(blockSize, Qt::Uninitialized);
+    qint64 actual = qMin(blockSize, size);
+    while (actual > 0) {
+        QInstaller::blockingRead(in, ba.data(), actual);
+        QInstaller::blockingWrite(out, ba.constData(), actual);
+        size -= actual;
+        actual = qMin(blockSize, size);
+    }
+}
+
+void doubleBufferedCopy(QFileDevice *in, QFileDevice *out, qint64 size)
+{
+    // read the next block while the previous one gets written from a pool thread
+    const qint64 blockSize = copyBlockSize(size);
+    QByteArray buffers[2] = { QByteArray(blockSize, Qt::Uninitialized),
+        QByteArray(blockSize, Qt::Uninitialized) };
+
+    int current = 0;
+    QFuture<QString> pendingWrite;
+    try {
+        while (size > 0) {
+            const qint64 actual = qMin(blockSize, size);
+            QInstaller::blockingRead(in, buffers[current].data(), actual);
+
+            pendingWrite.waitForFinished();
+            if (!pendingWrite.isCanceled() && !pendingWrite.result().isEmpty())
+                throw QInstaller::Error(pendingWrite.result());
+
+            pendingWrite = QtConcurrent::run(writeBlock, out, buffers[current].constData(),
+                actual);
+            size -= actual;
+            current = 1 - current;
+        }
+    } catch (...) {
+        pendingWrite.waitForFinished();
+        throw;
+    }
+
+    pendingWrite.waitForFinished();
+    if (!pendingWrite.isCanceled() && !pendingWrite.result().isEmpty())
+        throw QInstaller::Error(pendingWrite.result());
+}
+
+} // anon namespace
 
 qint64 QInstaller::retrieveInt64(QFileDevice *in)
 {
@@ -148,25 +273,74 @@ qint64 QInstaller::blockingRead(QFileDevice *in, char *buffer, qint64 size)
     return size;
 }
 
-qint64 QInstaller::blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size)
+qint64 QInstaller::blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size,
+    CopyMethod method)
 {
-    static const qint64 blockSize = 4096;
-    QByteArray ba(blockSize, '\0');
-    qint64 actual = qMin(blockSize, size);
-    while (actual > 0) {
-        try {
-            QInstaller::blockingRead(in, ba.data(), actual);
-            QInstaller::blockingWrite(out, ba.constData(), actual);
-            size -= actual;
-            actual = qMin(blockSize, size);
-        } catch (const Error &error) {
-            throw Error(QCoreApplication::translate("QInstaller", "Copy failed. Error: %1")
-                .arg(error.message()));
-        }
+    try {
+        if (method == AutoCopy || method == KernelCopy)
+            size -= copyInKernel(in, out, size);
+
+        // The double buffered copy writes from a pool thread. Only plain local files allow that,
+        // the remote file engine talks to the server through a socket owned by this thread.
+        const bool doubleBuffered = method == DoubleBufferedCopy
+            || (method == AutoCopy && size >= scDoubleBufferThreshold);
+        if (doubleBuffered && isLocalHandle(in->handle(), in) && isLocalHandle(out->handle(), out))
+            doubleBufferedCopy(in, out, size);
+        else
+            bufferedCopy(in, out, size);
+        size = 0;
+    } catch (const Error &error) {
+        throw Error(QCoreApplication::translate("QInstaller", "Copy failed. Error: %1")
+            .arg(error.message()));
     }
     return size;
 }
 
+qint64 QInstaller::kernelCopy(int inHandle, qint64 inOffset, int outHandle, qint64 size)
+{
+#ifdef Q_OS_LINUX
+    // Prefer copy_file_range(), which lets the file system share the data (reflink) or copy it on
+    // the server side. sendfile() is the fallback for older kernels and cross file system copies.
+# ifdef SYS_copy_file_range
+    bool useCopyFileRange = true;
+# else
+    bool useCopyFileRange = false;
+# endif
+    qint64 copied = 0;
+    while (copied < size) {
+        const size_t chunkSize = size_t(qMin<qint64>(size - copied, Q_INT64_C(0x40000000)));
+        ssize_t result = -1;
+# ifdef SYS_copy_file_range
+        if (useCopyFileRange) {
+            loff_t offset = inOffset + copied;
+            result = ::syscall(SYS_copy_file_range, inHandle, &offset, outHandle,
+                static_cast<loff_t *>(0), chunkSize, 0u);
+            if (result < 0 && errno != EINTR) {
+                useCopyFileRange = false;
+                continue;
+            }
+        }
+# endif
+        if (!useCopyFileRange) {
+            off_t offset = inOffset + copied;
+            result = ::sendfile(outHandle, inHandle, &offset, chunkSize);
+        }
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        copied += result;
+    }
+    return copied;
+#else
+    Q_UNUSED(inHandle)
+    Q_UNUSED(inOffset)
+    Q_UNUSED(outHandle)
+    Q_UNUSED(size)
+    return 0;
+#endif
+}
+
 qint64 QInstaller::blockingWrite(QFileDevice *out, const QByteArray &data)
 {
     return QInstaller::blockingWrite(out, data.constData(), data.size());
@@ -48,6 +48,13 @@ class Range;
 
 namespace QInstaller {
 
+enum CopyMethod {
+    AutoCopy,
+    BufferedCopy,
+    DoubleBufferedCopy,
+    KernelCopy
+};
+
 qint64 INSTALLER_EXPORT retrieveInt64(QFileDevice *in);
 void INSTALLER_EXPORT appendInt64(QFileDevice *out, qint64 n);
 
@@ -68,7 +75,9 @@ void INSTALLER_EXPORT openForWrite(QFileDevice *dev);
 void INSTALLER_EXPORT openForAppend(QFileDevice *dev);
 
 qint64 INSTALLER_EXPORT blockingRead(QFileDevice *in, char *buffer, qint64 size);
-qint64 INSTALLER_EXPORT blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size);
+qint64 INSTALLER_EXPORT blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size,
+    CopyMethod method = AutoCopy);
+qint64 INSTALLER_EXPORT kernelCopy(int inHandle, qint64 inOffset, int outHandle, qint64 size);
 
 qint64 INSTALLER_EXPORT blockingWrite(QFileDevice *out, const QByteArray &data);
 qint64 INSTALLER_EXPORT blockingWrite(QFileDevice *out, const char *data, qint64 size);
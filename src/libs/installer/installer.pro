@@ -120,6 +120,7 @@ HEADERS += packagemanagercore.h \
     installercalculator.h \
     uninstallercalculator.h \
     componentchecker.h \
+    componentinstallscheduler.h \
     proxycredentialsdialog.h \
     serverauthenticationdialog.h \
     keepaliveobject.h \
@@ -196,6 +197,7 @@ SOURCES += packagemanagercore.cpp \
     installercalculator.cpp \
     uninstallercalculator.cpp \
     componentchecker.cpp \
+    componentinstallscheduler.cpp \
     proxycredentialsdialog.cpp \
     serverauthenticationdialog.cpp \
     keepaliveobject.cpp \
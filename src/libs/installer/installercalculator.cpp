@@ -39,10 +39,14 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 namespace QInstaller {
 
 InstallerCalculator::InstallerCalculator(const QList<Component *> &allComponents)
     : m_allComponents(allComponents)
+    , m_componentIndex(PackageManagerCore::componentIndex(allComponents))
+    , m_autoDependOnIndexCreated(false)
 {
 }
 
@@ -103,6 +107,42 @@ void InstallerCalculator::realAppendToInstallComponents(Component *component)
     if (!component->isInstalled() || component->updateRequested()) {
         m_orderedComponentsToInstall.append(component);
         m_toInstallComponentIds.insert(component->name());
+
+        // wake up the auto dependent components that were only waiting for this one
+        foreach (int index, m_autoDependOnWaiting.take(component->name())) {
+            if (--m_missingAutoDependOn[index] == 0)
+                m_autoDependOnReady.append(index);
+        }
+    }
+}
+
+void InstallerCalculator::createAutoDependOnIndex()
+{
+    // index the auto dependencies of all components by the names they are still waiting for,
+    // names installed or scheduled for installation already do not need to be waited for
+    m_autoDependOnIndexCreated = true;
+    if (m_allComponents.isEmpty())
+        return;
+
+    // the installed packages do not change during the calculation, read them only once
+    QSet<QString> installedPackages;
+    if (PackageManagerCore *core = m_allComponents.first()->packageManagerCore())
+        installedPackages = core->localInstalledPackages().keys().toSet();
+
+    m_missingAutoDependOn.fill(0, m_allComponents.count());
+    for (int i = 0; i < m_allComponents.count(); ++i) {
+        const QSet<QString> autoDependOn = m_allComponents.at(i)->autoDependencies().toSet();
+        if (autoDependOn.isEmpty())
+            continue;
+
+        foreach (const QString &name, autoDependOn) {
+            if (installedPackages.contains(name) || m_toInstallComponentIds.contains(name))
+                continue;
+            m_autoDependOnWaiting[name].append(i);
+            ++m_missingAutoDependOn[i];
+        }
+        if (m_missingAutoDependOn.at(i) == 0)
+            m_autoDependOnReady.append(i);
     }
 }
 
@@ -139,19 +179,26 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
             return false;
     }
 
+    if (!m_autoDependOnIndexCreated)
+        createAutoDependOnIndex();
+
+    // All regular dependencies are resolved. Now we are looking for auto depend on components
+    // whose auto dependencies are all installed or scheduled for installation by now.
+    QList<int> readyAutoDependOn;
+    readyAutoDependOn.swap(m_autoDependOnReady);
+    std::sort(readyAutoDependOn.begin(), readyAutoDependOn.end());
+
     QList<Component *> foundAutoDependOnList;
-    // All regular dependencies are resolved. Now we are looking for auto depend on components.
-    foreach (Component *component, m_allComponents) {
+    foreach (int index, readyAutoDependOn) {
+        Component *component = m_allComponents.at(index);
         // If a components is already installed or is scheduled for installation, no need to check
         // for auto depend installation.
         if ((!component->isInstalled() || component->updateRequested())
             && !m_toInstallComponentIds.contains(component->name())) {
-                // If we figure out a component requests auto installation, keep it to resolve
-                // their dependencies as well.
-                if (component->isAutoDependOn(m_toInstallComponentIds)) {
-                    foundAutoDependOnList.append(component);
-                    insertInstallReason(component, InstallerCalculator::Automatic);
-                }
+                // The component requests auto installation, keep it to resolve its dependencies
+                // as well.
+                foundAutoDependOnList.append(component);
+                insertInstallReason(component, InstallerCalculator::Automatic);
         }
     }
 
@@ -168,7 +215,7 @@ bool InstallerCalculator::appendComponentToInstall(Component *component)
         // PackageManagerCore::componentByName returns 0 if dependencyComponentName contains a
         // version which is not available
         Component *dependencyComponent =
-            PackageManagerCore::componentByName(dependencyComponentName, m_allComponents);
+            PackageManagerCore::componentByName(dependencyComponentName, m_componentIndex);
         if (!dependencyComponent) {
             const QString errorMessage = QCoreApplication::translate("InstallerCalculator",
                 "Cannot find missing dependency '%1' for '%2'.").arg(dependencyComponentName,
@@ -40,6 +40,7 @@
 #include <QList>
 #include <QSet>
 #include <QString>
+#include <QVector>
 
 namespace QInstaller {
 
@@ -73,8 +74,10 @@ private:
     void realAppendToInstallComponents(Component *component);
     bool appendComponentToInstall(Component *components);
     QString recursionError(Component *component);
+    void createAutoDependOnIndex();
 
     QList<Component*> m_allComponents;
+    QHash<QString, QList<Component *> > m_componentIndex;
     QHash<Component*, QSet<Component*> > m_visitedComponents;
     QSet<QString> m_toInstallComponentIds; //for faster lookups
     QString m_componentsToInstallError;
@@ -83,6 +86,11 @@ private:
     //we can't use this reason hash as component id hash, because some reasons are ready before
     //the component is added
     QHash<QString, QPair<InstallReasonType, QString> > m_toInstallComponentIdReasonHash;
+    //auto dependency resolution variables, indexes refer to m_allComponents
+    bool m_autoDependOnIndexCreated;
+    QHash<QString, QList<int> > m_autoDependOnWaiting;
+    QVector<int> m_missingAutoDependOn;
+    QList<int> m_autoDependOnReady;
 };
 
 }
@@ -43,7 +43,9 @@
 #include "Common/MyInitGuid.h"
 
 #include "7zip/Archive/IArchive.h"
+#include "7zip/UI/Common/EnumDirItems.h"
 #include "7zip/UI/Common/OpenArchive.h"
+#include "7zip/UI/Common/SetProperties.h"
 #include "7zip/UI/Common/Update.h"
 
 #include "Windows/FileIO.h"
@@ -51,11 +53,13 @@
 #include "Windows/PropVariantConversions.h"
 
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QIODevice>
 #include <QtCore/QMutexLocker>
 #include <QPointer>
-#include <QTemporaryFile>
+#include <QSet>
+#include <QThreadPool>
 #include <QReadWriteLock>
 
 #ifdef _MSC_VER
@@ -99,6 +103,8 @@ bool CreateHardLinkWrapper(const QString &dest, const QString &file)
 #include <sys/stat.h>
 #endif
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 
 #include <cassert>
@@ -203,16 +209,6 @@ static QString UString2QString(const UString& str)
     return QString::fromStdWString(static_cast<const wchar_t*>(str));
 }
 
-static QString generateTempFileName()
-{
-    QTemporaryFile tmp;
-    if (!tmp.open()) {
-        throw SevenZipException(QCoreApplication::translate("QInstaller",
-            "Could not create temporary file"));
-    }
-    return QDir::toNativeSeparators(tmp.fileName());
-}
-
 /*
 static QStringList UStringVector2QStringList(const UStringVector& vec)
 {
@@ -465,6 +461,87 @@ public:
 private:
     QPointer<QIODevice> m_device;
 };
+
+/*
+    Lets 7z write an archive directly into a file device. 7z seeks back to patch the start
+    header once all items are written, so all positions are relative to the position the device
+    had when the stream was created.
+*/
+class QFileDeviceOutStream : public IOutStream, public CMyUnknownImp
+{
+public:
+    MY_UNKNOWN_IMP
+
+    explicit QFileDeviceOutStream(QFileDevice* device)
+        : IOutStream(), CMyUnknownImp(), m_device(device), m_offset(device->pos())
+    {
+        assert(m_device);
+        assert(!m_device->isSequential());
+    }
+
+    QString errorString() const
+    {
+        return m_errorString;
+    }
+
+    /* reimp */ STDMETHOD(Write)(const void* data, UInt32 size, UInt32* processedSize)
+    {
+        assert(m_device);
+        assert(m_device->isWritable());
+        const qint64 written = m_device->write(reinterpret_cast<const char*>(data), size);
+        if (processedSize)
+            *processedSize = qMax(written, qint64(0));
+        if (written < 0) {
+            m_errorString = m_device->errorString();
+            return E_FAIL;
+        }
+        return S_OK;
+    }
+
+    /* reimp */ STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64* newPosition)
+    {
+        assert(m_device);
+        qint64 np = 0;
+        switch(seekOrigin) {
+        case STREAM_SEEK_SET:
+            np = m_offset + offset;
+            break;
+        case STREAM_SEEK_CUR:
+            np = m_device->pos() + offset;
+            break;
+        case STREAM_SEEK_END:
+            np = m_device->size() + offset;
+            break;
+        default:
+            return STG_E_INVALIDFUNCTION;
+        }
+
+        if (np < m_offset)
+            return STG_E_INVALIDFUNCTION;
+        if (!m_device->seek(np)) {
+            m_errorString = m_device->errorString();
+            return E_FAIL;
+        }
+        if (newPosition)
+            *newPosition = np - m_offset;
+        return S_OK;
+    }
+
+    /* reimp */ STDMETHOD(SetSize)(UInt64 newSize)
+    {
+        assert(m_device);
+        if (!m_device->resize(m_offset + newSize)) {
+            m_errorString = m_device->errorString();
+            return E_FAIL;
+        }
+        return S_OK;
+    }
+
+private:
+    QPointer<QFileDevice> m_device;
+    const qint64 m_offset;
+    QString m_errorString;
+};
 }
 
 File::File()
@@ -514,6 +591,50 @@ bool File::operator==(const File& other) const
         || other.permissions == static_cast< QFile::Permissions >(-1));
 }
 
+static const qint64 scInvalidTime = std::numeric_limits<qint64>::min();
+
+ArchiveEntry::ArchiveEntry()
+    : m_attributes(0)
+    , m_archive(-1)
+    , m_index(0)
+    , m_modificationTime(scInvalidTime)
+    , m_uncompressedSize(0)
+    , m_compressedSize(0)
+{
+}
+
+QString ArchiveEntry::path() const
+{
+    if (m_directory.isEmpty())
+        return m_fileName;
+    return m_directory + QLatin1Char('/') + m_fileName;
+}
+
+QFile::Permissions ArchiveEntry::permissions() const
+{
+    return QFile::Permissions(m_attributes & PermissionsMask);
+}
+
+QDateTime ArchiveEntry::modificationTime() const
+{
+    if (m_modificationTime == scInvalidTime)
+        return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(m_modificationTime);
+}
+
+File ArchiveEntry::toFile() const
+{
+    File file;
+    file.path = path();
+    file.isDirectory = isDirectory();
+    file.permissions = permissions();
+    file.mtime = modificationTime();
+    file.uncompressedSize = m_uncompressedSize;
+    file.compressedSize = m_compressedSize;
+    file.archiveIndex = archiveIndex();
+    return file;
+}
+
 QByteArray Lib7z::formatKeyValuePairs(const QVariantList& l)
 {
     assert(l.size() % 2 == 0);
@@ -629,115 +750,372 @@ QVector<File> ListArchiveJob::index() const
     return d->files;
 }
 
-class OpenArchiveInfo
+namespace {
+/*
+    Loads the codecs once per process. All Lib7z functions share the registry, it is only read
+    after it has been set up.
+*/
+class CodecRegistry
 {
+public:
+    CodecRegistry()
+        : m_loaded(false)
+        , m_sevenZipFormatIndex(-1)
+    {
+        m_loaded = m_codecs.Load() == S_OK
+            && m_codecs.FindFormatForArchiveType(L"", m_formatIndices);
+        if (m_loaded)
+            m_sevenZipFormatIndex = m_codecs.FindFormatForArchiveType(L"7z");
+    }
+
+    CCodecs *codecs()
+    {
+        if (!m_loaded)
+            throw SevenZipException(QCoreApplication::translate("Lib7z", "Could not load codecs"));
+        return &m_codecs;
+    }
+
+    const CIntVector &formatIndices() const { return m_formatIndices; }
+    int sevenZipFormatIndex() const { return m_sevenZipFormatIndex; }
+
 private:
-    OpenArchiveInfo(QFileDevice* device)
-        : codecs(new CCodecs)
+    CCodecs m_codecs;
+    CIntVector m_formatIndices;
+    bool m_loaded;
+    int m_sevenZipFormatIndex;
+};
+Q_GLOBAL_STATIC(CodecRegistry, codecRegistry)
+
+/*
+    Identifies an archive file by its path, size, modification time and the first bytes of the
+    file, so that a changed file is not served from the cache. The start of a 7z archive holds the
+    position and the CRC of its header, which differ as soon as the content does, even if the file
+    was replaced within the resolution of the modification time.
+*/
+struct ArchiveKey
+{
+    enum { HeaderSize = 32 };
+
+    ArchiveKey() : size(-1) {}
+
+    static ArchiveKey fromDevice(QFileDevice *device)
     {
-        if (codecs->Load() != S_OK) {
-            throw SevenZipException(QCoreApplication::translate("OpenArchiveInfo",
-                "Could not load codecs"));
-        }
-        if (!codecs->FindFormatForArchiveType(L"", formatIndices)) {
-            throw SevenZipException(QCoreApplication::translate("OpenArchiveInfo",
-                "Could not retrieve default format"));
+        ArchiveKey key;
+        const QFileInfo fi(device->fileName());
+        if (device->fileName().isEmpty() || !fi.isNativePath() || !fi.isFile())
+            return key;
+
+        const qint64 pos = device->pos();
+        if (!device->seek(0))
+            return key;
+        key.header = device->read(HeaderSize);
+        device->seek(pos);
+
+        key.path = fi.absoluteFilePath();
+        key.size = fi.size();
+        key.lastModified = fi.lastModified();
+        return key;
+    }
+
+    bool isValid() const { return !path.isEmpty(); }
+
+    bool operator==(const ArchiveKey &other) const
+    {
+        return size == other.size && lastModified == other.lastModified && path == other.path
+            && header == other.header;
+    }
+
+    QString path;
+    qint64 size;
+    QDateTime lastModified;
+    QByteArray header;
+};
+
+uint qHash(const ArchiveKey &key)
+{
+    return qHash(key.path) ^ uint(key.size);
+}
+}
+
+/*
+    An opened archive. Archives identified by an ArchiveKey read from their own file, so that the
+    opened archive can be used again by a later call with a different device for the same file.
+*/
+class OpenArchiveInfo
+{
+    Q_DISABLE_COPY(OpenArchiveInfo)
+
+public:
+    OpenArchiveInfo(QFileDevice *device, const ArchiveKey &archiveKey)
+        : key(archiveKey)
+    {
+        age.start();
+        QIODevice *source = device;
+        if (key.isValid()) {
+            file.reset(new QFile(key.path));
+            if (!file->open(QIODevice::ReadOnly)) {
+                throw SevenZipException(QCoreApplication::translate("OpenArchiveInfo",
+                    "Could not open archive"));
+            }
+            source = file.data();
         }
-        stream = new QIODeviceInStream(device);
-        if (archiveLink.Open2(codecs.data(), formatIndices, false, stream, UString(), 0) != S_OK) {
-            throw SevenZipException(QCoreApplication::translate("OpenArchiveInfo",
-                "Could not open archive"));
+
+        CodecRegistry *const registry = codecRegistry();
+        stream = new QIODeviceInStream(source);
+        if (archiveLink.Open2(registry->codecs(), registry->formatIndices(), false, stream,
+            UString(), 0) != S_OK) {
+                throw SevenZipException(QCoreApplication::translate("OpenArchiveInfo",
+                    "Could not open archive"));
         }
         if (archiveLink.Arcs.Size() == 0)
             throw SevenZipException(QCoreApplication::translate("OpenArchiveInfo", "No CArc found"));
-
-        m_cleaner = new OpenArchiveInfoCleaner();
-        m_cleaner->moveToThread(device->thread());
-        QObject::connect(device, SIGNAL(destroyed(QObject*)), m_cleaner, SLOT(deviceDestroyed(QObject*)));
     }
 
+    const ArchiveKey key;
+    CArchiveLink archiveLink;
+    QElapsedTimer age;
+
+private:
+    QScopedPointer<QFile> file;
+    CMyComPtr<IInStream> stream;
+};
+
+namespace {
+/*
+    Keeps recently used archives open, so that listing, size calculation and extraction of the same
+    file parse the archive headers only once. An opened archive is used by one thread at a time:
+    it is taken out of the cache while in use and put back afterwards. The cache is split into
+    shards by key, to not serialize unrelated archives on a single mutex. Archives are opened and
+    closed outside of the locks.
+
+    A cached archive keeps its file open, which prevents it from being deleted or replaced on
+    Windows. The extraction, usually the last use of an archive, therefore closes it, and archives
+    are closed on the first use of the cache after MaxArchiveAge, counted from when they were
+    opened. An archive that is probed or listed but never extracted stays open until then.
+*/
+class OpenArchiveCache
+{
 public:
-    ~OpenArchiveInfo()
+    enum {
+        ShardCount = 8,
+        MaxArchivesPerShard = 2,
+        MaxArchiveAge = 10000 // ms
+    };
+
+    OpenArchiveCache()
     {
-        m_cleaner->deleteLater();
+        // the cached archives must go before the codecs they were created by
+        codecRegistry();
     }
 
-    static OpenArchiveInfo* value(QFileDevice* device)
+    ~OpenArchiveCache()
     {
-        QMutexLocker _(&m_mutex);
-        if (!instances.contains(device))
-            instances.insert(device, new OpenArchiveInfo(device));
-        return instances.value(device);
+        for (int i = 0; i < ShardCount; ++i)
+            qDeleteAll(m_shards[i].archives);
     }
 
-    static OpenArchiveInfo* take(QFileDevice *device)
+    OpenArchiveInfo *take(const ArchiveKey &key)
     {
-        QMutexLocker _(&m_mutex);
-        if (instances.contains(device))
-            return instances.take(device);
+        closeExpired();
+
+        Shard &shard = m_shards[qHash(key) % ShardCount];
+        QMutexLocker _(&shard.mutex);
+        for (int i = 0; i < shard.archives.count(); ++i) {
+            if (shard.archives.at(i)->key == key)
+                return shard.archives.takeAt(i);
+        }
         return 0;
     }
 
-    CArchiveLink archiveLink;
+    void put(OpenArchiveInfo *archive)
+    {
+        OpenArchiveInfo *evicted = 0;
+        {
+            Shard &shard = m_shards[qHash(archive->key) % ShardCount];
+            QMutexLocker _(&shard.mutex);
+            shard.archives.prepend(archive);
+            if (shard.archives.count() > MaxArchivesPerShard)
+                evicted = shard.archives.takeLast();
+        }
+        delete evicted;
+
+        closeExpired();
+    }
 
 private:
-    CIntVector formatIndices;
-    CMyComPtr<IInStream> stream;
-    QScopedPointer<CCodecs> codecs;
-    OpenArchiveInfoCleaner *m_cleaner;
+    void closeExpired()
+    {
+        QList<OpenArchiveInfo *> expired;
+        for (int i = 0; i < ShardCount; ++i) {
+            Shard &shard = m_shards[i];
+            QMutexLocker _(&shard.mutex);
+            for (int j = shard.archives.count() - 1; j >= 0; --j) {
+                if (shard.archives.at(j)->age.hasExpired(MaxArchiveAge))
+                    expired.append(shard.archives.takeAt(j));
+            }
+        }
+        qDeleteAll(expired);
+    }
 
-    static QMutex m_mutex;
-    static QHash< QIODevice*, OpenArchiveInfo* > instances;
+    struct Shard
+    {
+        QMutex mutex;
+        QList<OpenArchiveInfo *> archives; // most recently used first
+    };
+    Shard m_shards[ShardCount];
 };
+Q_GLOBAL_STATIC(OpenArchiveCache, openArchiveCache)
+
+/*
+    Provides exclusive access to the opened \a device for the lifetime of the object. Archives
+    that are plain files come from and go back to the cache, others are opened on every call.
+*/
+class OpenArchive
+{
+    Q_DISABLE_COPY(OpenArchive)
+
+public:
+    explicit OpenArchive(QFileDevice *device)
+        : m_archive(0)
+        , m_keepOpen(true)
+    {
+        open(device, ArchiveKey::fromDevice(device));
+    }
+
+    // Uses the \a key read from \a device already.
+    OpenArchive(QFileDevice *device, const ArchiveKey &key)
+        : m_archive(0)
+        , m_keepOpen(true)
+    {
+        open(device, key);
+    }
 
-QMutex OpenArchiveInfo::m_mutex;
-QHash< QIODevice*, OpenArchiveInfo* > OpenArchiveInfo::instances;
+    ~OpenArchive()
+    {
+        if (m_keepOpen && m_archive->key.isValid() && !openArchiveCache.isDestroyed())
+            openArchiveCache()->put(m_archive);
+        else
+            delete m_archive;
+    }
+
+    const OpenArchiveInfo *operator->() const { return m_archive; }
+
+    // Closes the archive instead of putting it back into the cache. Used after the extraction,
+    // which usually is the last use of an archive, to not keep the file locked.
+    void close() { m_keepOpen = false; }
+
+private:
+    void open(QFileDevice *device, const ArchiveKey &key)
+    {
+        if (key.isValid())
+            m_archive = openArchiveCache()->take(key);
+        if (!m_archive)
+            m_archive = new OpenArchiveInfo(device, key);
+    }
+
+private:
+    OpenArchiveInfo *m_archive;
+    bool m_keepOpen;
+};
+}
 
-void OpenArchiveInfoCleaner::deviceDestroyed(QObject* dev)
+namespace Lib7z {
+/*
+    Reads the requested properties of all items of an opened archive into a single ArchiveEntry
+    and passes it to the visitor. The folder parts of the paths are interned, so visitors keeping
+    the entries store every folder name only once.
+*/
+class ArchiveLister
 {
-    QFileDevice* device = static_cast<QFileDevice*>(dev);
-    Q_ASSERT(device);
-    delete OpenArchiveInfo::take(device);
+public:
+    ArchiveLister(ArchiveVisitor *visitor, ListProperties properties)
+        : m_visitor(visitor)
+        , m_properties(properties)
+    {}
+
+    bool list(const CArc &arc, int archiveIndex)
+    {
+        IInArchive* const arch = arc.Archive;
+        UInt32 numItems = 0;
+        if (arch->GetNumberOfItems(&numItems) != S_OK) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z",
+                "Could not retrieve number of items in archive"));
+        }
+
+        ArchiveEntry entry;
+        entry.m_archive = archiveIndex;
+        for (UInt32 item = 0; item < numItems; ++item) {
+            entry.m_index = item;
+            if (m_properties & ListPaths)
+                setPath(&entry, arc, item);
+
+            bool isDirectory = false;
+            IsArchiveItemFolder(arch, item, isDirectory);
+            entry.m_attributes = isDirectory ? ArchiveEntry::DirectoryAttribute : 0;
+            if (m_properties & ListPermissions)
+                entry.m_attributes |= quint32(getPermissions(arch, item));
+            if (m_properties & ListModificationTimes) {
+                const QDateTime mtime = getDateTimeProperty(arch, item, kpidMTime, QDateTime());
+                entry.m_modificationTime = mtime.isValid() ? mtime.toMSecsSinceEpoch()
+                    : scInvalidTime;
+            }
+            if (m_properties & ListSizes)
+                entry.m_uncompressedSize = getUInt64Property(arch, item, kpidSize, 0);
+            if (m_properties & ListCompressedSizes)
+                entry.m_compressedSize = getUInt64Property(arch, item, kpidPackSize, 0);
+
+            if (!m_visitor->visit(entry))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    void setPath(ArchiveEntry *entry, const CArc &arc, UInt32 item)
+    {
+        UString s;
+        if (arc.GetItemPath(item, s) != S_OK) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z",
+                "Could not retrieve path of archive item %1").arg(item));
+        }
+
+        const QString path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        entry->m_fileName = path.mid(slash + 1);
+        if (slash < 0) {
+            entry->m_directory.clear();
+            return;
+        }
+
+        const QStringRef directory = path.leftRef(slash);
+        if (directory == entry->m_directory)
+            return; // most items follow the previous one in the same folder
+
+        const QString key = directory.toString();
+        QSet<QString>::const_iterator it = m_directories.constFind(key);
+        if (it == m_directories.constEnd())
+            it = m_directories.insert(key);
+        entry->m_directory = *it;
+    }
+
+    ArchiveVisitor *const m_visitor;
+    const ListProperties m_properties;
+    QSet<QString> m_directories;
+};
 }
 
-QVector<File> Lib7z::listArchive(QFileDevice* archive)
+void Lib7z::listArchive(QFileDevice* archive, ArchiveVisitor* visitor, ListProperties properties)
 {
     assert(archive);
+    assert(visitor);
     try {
-        const OpenArchiveInfo* const openArchive = OpenArchiveInfo::value(archive);
-
-        QVector<File> flat;
+        OpenArchive openArchive(archive);
 
+        ArchiveLister lister(visitor, properties);
         for (int i = 0; i < openArchive->archiveLink.Arcs.Size(); ++i) {
-            const CArc& arc = openArchive->archiveLink.Arcs[i];
-            IInArchive* const arch = arc.Archive;
-
-            UInt32 numItems = 0;
-            if (arch->GetNumberOfItems(&numItems) != S_OK) {
-                throw SevenZipException(QCoreApplication::translate("Lib7z",
-                    "Could not retrieve number of items in archive"));
-            }
-            flat.reserve(flat.size() + numItems);
-            for (uint item = 0; item < numItems; ++item) {
-                UString s;
-                if (arc.GetItemPath(item, s) != S_OK) {
-                    throw SevenZipException(QCoreApplication::translate("Lib7z",
-                        "Could not retrieve path of archive item %1").arg(item));
-                }
-                File f;
-                f.archiveIndex.setX(i);
-                f.archiveIndex.setY(item);
-                f.path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
-                IsArchiveItemFolder(arch, item, f.isDirectory);
-                f.permissions = getPermissions(arch, item);
-                f.mtime = getDateTimeProperty(arch, item, kpidMTime, QDateTime());
-                f.uncompressedSize = getUInt64Property(arch, item, kpidSize, 0);
-                f.compressedSize = getUInt64Property(arch, item, kpidPackSize, 0);
-                flat.push_back(f);
-                qApp->processEvents();
-            }
+            if (!lister.list(openArchive->archiveLink.Arcs[i], i))
+                break;
         }
-        return flat;
     } catch (const SevenZipException& e) {
         throw e;
     } catch (const char *err) {
@@ -746,7 +1124,51 @@ QVector<File> Lib7z::listArchive(QFileDevice* archive)
         throw SevenZipException(QCoreApplication::translate("Lib7z",
             "Unknown exception caught (%1)").arg(QString::fromLatin1(Q_FUNC_INFO)));
     }
-    return QVector<File>(); // never reached
+}
+
+namespace {
+class FileCollector : public ArchiveVisitor
+{
+public:
+    bool visit(const ArchiveEntry &entry)
+    {
+        files.append(entry.toFile());
+        return true;
+    }
+
+    QVector<File> files;
+};
+
+class StatisticsCollector : public ArchiveVisitor
+{
+public:
+    bool visit(const ArchiveEntry &entry)
+    {
+        if (entry.isDirectory())
+            ++statistics.directoryCount;
+        else
+            ++statistics.fileCount;
+        statistics.uncompressedSize += entry.uncompressedSize();
+        statistics.compressedSize += entry.compressedSize();
+        return true;
+    }
+
+    ArchiveStatistics statistics;
+};
+}
+
+QVector<File> Lib7z::listArchive(QFileDevice* archive)
+{
+    FileCollector collector;
+    listArchive(archive, &collector, ListAllProperties);
+    return collector.files;
+}
+
+ArchiveStatistics Lib7z::archiveStatistics(QFileDevice* archive)
+{
+    StatisticsCollector collector;
+    listArchive(archive, &collector, ListSizes | ListCompressedSizes);
+    return collector.statistics;
 }
 
 void ListArchiveJob::doStart()
@@ -765,6 +1187,43 @@ void ListArchiveJob::doStart()
     emitResult();
 }
 
+namespace {
+/*
+    Shared by the callbacks of concurrently running extractions of one archive. Serializes the calls
+    into the user provided ExtractCallback and sums up the progress of all extractions.
+*/
+struct ExtractSynchronization
+{
+    explicit ExtractSynchronization(int count)
+        : totals(count, 0)
+        , completed(count, 0)
+    {}
+
+    QMutex mutex;
+    QVector<UInt64> totals;
+    QVector<UInt64> completed;
+};
+
+class SynchronizationLocker
+{
+public:
+    explicit SynchronizationLocker(ExtractSynchronization *sync)
+        : m_sync(sync)
+    {
+        if (m_sync)
+            m_sync->mutex.lock();
+    }
+    ~SynchronizationLocker()
+    {
+        if (m_sync)
+            m_sync->mutex.unlock();
+    }
+
+private:
+    ExtractSynchronization *m_sync;
+};
+}
+
 class Lib7z::ExtractCallbackImpl : public IArchiveExtractCallback, public CMyUnknownImp
 {
 public:
@@ -776,9 +1235,18 @@ public:
         , total(0)
         , completed(0)
         , device(0)
+        , sync(0)
+        , slot(0)
+        , deferDirectoryAttributes(false)
     {
     }
 
+    void setSynchronization(ExtractSynchronization *synchronization, int index)
+    {
+        sync = synchronization;
+        slot = index;
+    }
+
     void setTarget(QIODevice* dev)
     {
         device = dev;
@@ -820,11 +1288,13 @@ public:
             const QString path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
             const QFileInfo fi(QString::fromLatin1("%1/%2").arg(targetDir, path));
 
+            bool isDir = false;
+            IsArchiveItemFolder(arc->Archive, index, isDir);
+
+            SynchronizationLocker locker(sync);
             DirectoryGuard guard(fi.absolutePath());
             const QStringList directories = guard.tryCreate();
 
-            bool isDir = false;
-            IsArchiveItemFolder(arc->Archive, index, isDir);
             if (isDir)
                 QDir(fi.absolutePath()).mkdir(fi.fileName());
 
@@ -875,101 +1345,150 @@ public:
     {
         Q_UNUSED(resultEOperationResult)
 
-        if (!targetDir.isEmpty()) {
-            bool hasPerm = false;
-            const QFile::Permissions permissions = getPermissions(arc->Archive, currentIndex, &hasPerm);
+        if (targetDir.isEmpty())
+            return S_OK;
 
-            UString s;
-            if (arc->GetItemPath(currentIndex, s) != S_OK) {
-                Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                    "Could not retrieve path of archive item %1.").arg(currentIndex));
-                return E_FAIL;
+        if (deferDirectoryAttributes) {
+            bool isDir = false;
+            IsArchiveItemFolder(arc->Archive, currentIndex, isDir);
+            if (isDir) {
+                deferredDirectories.append(currentIndex);
+                return S_OK;
             }
-            const QString path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
-            const QString absFilePath = QFileInfo(QString::fromLatin1("%1/%2").arg(targetDir, path))
-                .absoluteFilePath();
-
-            // do we have a symlink?
-            const quint32 attributes = getUInt32Property(arc->Archive, currentIndex, kpidAttrib, 0);
-            struct stat stat_info;
-            stat_info.st_mode = attributes >> 16;
-            if (S_ISLNK(stat_info.st_mode)) {
+        }
+        return setItemAttributes(currentIndex);
+    }
+
+    /*
+        Makes SetOperationResult() skip the attributes of directories. They are applied later on
+        by applyDirectoryAttributes(), once nothing is written into the directories anymore.
+    */
+    void setDeferDirectoryAttributes(bool defer)
+    {
+        deferDirectoryAttributes = defer;
+    }
+
+    HRESULT applyDirectoryAttributes()
+    {
+        // children first, setting the attributes of a directory can make its parent read-only
+        HRESULT result = S_OK;
+        for (int i = deferredDirectories.count() - 1; i >= 0 && result == S_OK; --i)
+            result = setItemAttributes(deferredDirectories.at(i));
+        deferredDirectories.clear();
+        return result;
+    }
+
+    HRESULT setItemAttributes(UInt32 index)
+    {
+        bool hasPerm = false;
+        const QFile::Permissions permissions = getPermissions(arc->Archive, index, &hasPerm);
+
+        UString s;
+        if (arc->GetItemPath(index, s) != S_OK) {
+            Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                "Could not retrieve path of archive item %1.").arg(index));
+            return E_FAIL;
+        }
+        const QString path = UString2QString(s).replace(QLatin1Char('\\'), QLatin1Char('/'));
+        const QString absFilePath = QFileInfo(QString::fromLatin1("%1/%2").arg(targetDir, path))
+            .absoluteFilePath();
+
+        // do we have a symlink?
+        const quint32 attributes = getUInt32Property(arc->Archive, index, kpidAttrib, 0);
+        struct stat stat_info;
+        stat_info.st_mode = attributes >> 16;
+        if (S_ISLNK(stat_info.st_mode)) {
 #ifdef Q_OS_WIN
-                qFatal(QString::fromLatin1("Creating a link from archive is not implemented for windows. "
-                    "Link filename: %1").arg(absFilePath).toLatin1());
-                // TODO
+            qFatal(QString::fromLatin1("Creating a link from archive is not implemented for windows. "
+                "Link filename: %1").arg(absFilePath).toLatin1());
+            // TODO
 //                if (!CreateHardLinkWrapper(absFilePath, QLatin1String(symlinkTarget))) {
 //                    return S_FALSE;
 //                }
 #else
-                QFileInfo symlinkPlaceHolderFileInfo(absFilePath);
-                if (symlinkPlaceHolderFileInfo.isSymLink()) {
-                    Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                        "Could not create symlink at '%1'. Another one is already existing.")
-                        .arg(absFilePath));
-                    return E_FAIL;
-                }
-                QFile symlinkPlaceHolderFile(absFilePath);
-                if (!symlinkPlaceHolderFile.open(QIODevice::ReadOnly)) {
-                    Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                        "Could not read symlink target from file '%1'.").arg(absFilePath));
-                    return E_FAIL;
-                }
+            QFileInfo symlinkPlaceHolderFileInfo(absFilePath);
+            if (symlinkPlaceHolderFileInfo.isSymLink()) {
+                Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                    "Could not create symlink at '%1'. Another one is already existing.")
+                    .arg(absFilePath));
+                return E_FAIL;
+            }
+            QFile symlinkPlaceHolderFile(absFilePath);
+            if (!symlinkPlaceHolderFile.open(QIODevice::ReadOnly)) {
+                Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                    "Could not read symlink target from file '%1'.").arg(absFilePath));
+                return E_FAIL;
+            }
 
-                const QByteArray symlinkTarget = symlinkPlaceHolderFile.readAll();
-                symlinkPlaceHolderFile.close();
-                symlinkPlaceHolderFile.remove();
-                QFile targetFile(QString::fromLatin1(symlinkTarget));
-                if (!targetFile.link(absFilePath)) {
-                    Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
-                        "Could not create symlink at %1: %2.").arg(absFilePath,
-                        targetFile.errorString()));
-                    return E_FAIL;
-                }
-                return S_OK;
-#endif
+            const QByteArray symlinkTarget = symlinkPlaceHolderFile.readAll();
+            symlinkPlaceHolderFile.close();
+            symlinkPlaceHolderFile.remove();
+            QFile targetFile(QString::fromLatin1(symlinkTarget));
+            if (!targetFile.link(absFilePath)) {
+                Lib7z::setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                    "Could not create symlink at %1: %2.").arg(absFilePath,
+                    targetFile.errorString()));
+                return E_FAIL;
             }
+            return S_OK;
+#endif
+        }
 
-            try {
-                if (!absFilePath.isEmpty()) {
-                    // This might fail for archives without all properties, we can only be sure about
-                    // modification time, as it's always stored by default in 7z archives. Also note that
-                    // we restore modification time on Unix only, as access time and change time are
-                    // supposed to be set to the time of installation.
-                    FILETIME mTime;
-                    if (getFileTimeFromProperty(arc->Archive, currentIndex, kpidMTime, &mTime)) {
-                        NWindows::NFile::NIO::COutFile file;
-                        if (file.Open(QString2UString(absFilePath), 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
-                            file.SetTime(&mTime, &mTime, &mTime);
-                    }
+        try {
+            if (!absFilePath.isEmpty()) {
+                // This might fail for archives without all properties, we can only be sure about
+                // modification time, as it's always stored by default in 7z archives. Also note that
+                // we restore modification time on Unix only, as access time and change time are
+                // supposed to be set to the time of installation.
+                FILETIME mTime;
+                if (getFileTimeFromProperty(arc->Archive, index, kpidMTime, &mTime)) {
+                    NWindows::NFile::NIO::COutFile file;
+                    if (file.Open(QString2UString(absFilePath), 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
+                        file.SetTime(&mTime, &mTime, &mTime);
+                }
 #ifdef Q_OS_WIN
-                    FILETIME cTime, aTime;
-                    bool success = getFileTimeFromProperty(arc->Archive, currentIndex, kpidCTime, &cTime);
-                    if (success && getFileTimeFromProperty(arc->Archive, currentIndex, kpidATime, &aTime)) {
-                        NWindows::NFile::NIO::COutFile file;
-                        if (file.Open(QString2UString(absFilePath), 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
-                            file.SetTime(&cTime, &aTime, &mTime);
-                    }
-#endif
+                FILETIME cTime, aTime;
+                bool success = getFileTimeFromProperty(arc->Archive, index, kpidCTime, &cTime);
+                if (success && getFileTimeFromProperty(arc->Archive, index, kpidATime, &aTime)) {
+                    NWindows::NFile::NIO::COutFile file;
+                    if (file.Open(QString2UString(absFilePath), 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL))
+                        file.SetTime(&cTime, &aTime, &mTime);
                 }
-            } catch (...) {}
-
-            if (hasPerm)
-                QFile::setPermissions(absFilePath, permissions);
-        }
+#endif
+            }
+        } catch (...) {}
 
+        if (hasPerm)
+            QFile::setPermissions(absFilePath, permissions);
         return S_OK;
     }
 
     /* reimp */ STDMETHOD(SetTotal)(UInt64 t)
     {
         total = t;
+        if (sync) {
+            SynchronizationLocker locker(sync);
+            sync->totals[slot] = t;
+        }
         return S_OK;
     }
 
     /* reimp */ STDMETHOD(SetCompleted)(const UInt64* c)
     {
         completed = *c;
+        if (sync) {
+            SynchronizationLocker locker(sync);
+            sync->completed[slot] = completed;
+
+            UInt64 sumTotal = 0, sumCompleted = 0;
+            for (int i = 0; i < sync->totals.count(); ++i) {
+                sumTotal += sync->totals.at(i);
+                sumCompleted += sync->completed.at(i);
+            }
+            if (sumTotal > 0)
+                return q->setCompleted(sumCompleted, sumTotal);
+            return S_OK;
+        }
         if (total > 0)
             return q->setCompleted(completed, total);
         return S_OK;
@@ -988,6 +1507,10 @@ private:
     UInt64 completed;
     QPointer<QIODevice> device;
     QString targetDir;
+    ExtractSynchronization *sync;
+    int slot;
+    bool deferDirectoryAttributes;
+    QVector<UInt32> deferredDirectories;
 };
 
 
@@ -1320,7 +1843,43 @@ namespace{
     }
 }
 
+static void addProperty(CObjectVector<CProperty> *properties, const wchar_t *name,
+    const QString &value)
+{
+    CProperty property;
+    property.Name = UString(name);
+    property.Value = QString2UString(value);
+    properties->Add(property);
+}
+
+static CObjectVector<CProperty> compressionProperties(const CompressionOptions &options)
+{
+    CObjectVector<CProperty> properties;
+    addProperty(&properties, L"TC", QLatin1String("ON")); // preserve creation time
+    addProperty(&properties, L"TA", QLatin1String("ON")); // preserve access time
+
+    if (options.level >= 0)
+        addProperty(&properties, L"X", QString::number(qMin(options.level, 9)));
+    if (!options.method.isEmpty())
+        addProperty(&properties, L"0", options.method);
+    if (options.dictionarySize > 0)
+        addProperty(&properties, L"0D", QString::fromLatin1("%1b").arg(options.dictionarySize));
+    if (options.threadCount > 0)
+        addProperty(&properties, L"MT", QString::number(options.threadCount));
+    if (options.solidBlockSize == 0)
+        addProperty(&properties, L"S", QLatin1String("OFF"));
+    else if (options.solidBlockSize > 0)
+        addProperty(&properties, L"S", QString::fromLatin1("%1b").arg(options.solidBlockSize));
+    return properties;
+}
+
 void Lib7z::createArchive(QFileDevice* archive, const QStringList &sourcePaths, UpdateCallback* callback)
+{
+    createArchive(archive, sourcePaths, CompressionOptions(), callback);
+}
+
+void Lib7z::createArchive(QFileDevice* archive, const QStringList &sourcePaths,
+    const CompressionOptions &options, UpdateCallback* callback)
 {
     assert(archive);
 
@@ -1331,20 +1890,7 @@ void Lib7z::createArchive(QFileDevice* archive, const QStringList &sourcePaths,
     try {
         callback->setTarget(archive);
 
-        QScopedPointer<CCodecs> codecs(new CCodecs);
-        if (codecs->Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Could not load codecs"));
-
-        CIntVector formatIndices;
-
-        if (!codecs.data()->FindFormatForArchiveType(L"", formatIndices)) {
-            throw SevenZipException(QCoreApplication::translate("Lib7z",
-                "Could not retrieve default format"));
-        }
-
-        // yes this is crap, but there seems to be no streaming solution to this...
-
-        const QString tempFile = generateTempFileName();
+        CodecRegistry *const registry = codecRegistry();
 
         NWildcard::CCensor censor;
         foreach (const QString &path, sourcePaths) {
@@ -1357,52 +1903,69 @@ void Lib7z::createArchive(QFileDevice* archive, const QStringList &sourcePaths,
         }
         callback->setSourcePaths(sourcePaths);
 
-        CArchivePath archivePath;
-        archivePath.ParseFromPath(QString2UString(tempFile));
-
-        CUpdateArchiveCommand command;
-        command.ArchivePath = archivePath;
-        command.ActionSet = NUpdateArchive::kAddActionSet;
-
-        CUpdateOptions options;
-        options.Commands.Add(command);
-        options.ArchivePath = archivePath;
-        options.MethodMode.FormatIndex = codecs->FindFormatForArchiveType(L"7z");
-
-        // preserve creation time
-        CProperty tc;
-        tc.Name = UString(L"TC");
-        tc.Value = UString(L"ON");
-        options.MethodMode.Properties.Add(tc);
-
-        // preserve access time
-        CProperty ta;
-        ta.Name = UString(L"TA");
-        ta.Value = UString(L"ON");
-        options.MethodMode.Properties.Add(ta);
-
-        CUpdateErrorInfo errorInfo;
-        const HRESULT res = UpdateArchive(codecs.data(), censor, options, errorInfo, 0, callback->impl());
-        if (res != S_OK || !QFile::exists(tempFile)) {
+        CDirItems dirItems;
+        UStringVector errorPaths;
+        CRecordVector<DWORD> errorCodes;
+        HRESULT res = EnumerateItems(censor, dirItems, 0, errorPaths, errorCodes);
+        for (int i = 0; i < errorPaths.Size(); ++i) {
+            if (res == S_OK)
+                res = callback->impl()->CanNotFindError(errorPaths[i], errorCodes[i]);
+        }
+        if (res != S_OK) {
             throw SevenZipException(QCoreApplication::translate("Lib7z",
-                "Could not create archive %1. %2").arg(tempFile, errorMessageFrom7zResult(res)));
+                "Could not scan source paths. %1").arg(errorMessageFrom7zResult(res)));
         }
 
+        CMyComPtr<IOutArchive> outArchive;
+        res = registry->codecs()->CreateOutArchive(registry->sevenZipFormatIndex(), outArchive);
+        if (res != S_OK || !outArchive) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z",
+                "Could not create archive handler. %1").arg(errorMessageFrom7zResult(res)));
+        }
+
+        UInt32 fileTimeType = NFileTimeType::kWindows;
+        outArchive->GetFileTimeType(&fileTimeType);
+
+        // a new archive has no items yet, so every enumerated item is simply added
+        CObjectVector<CArcItem> arcItems;
+        CRecordVector<CUpdatePair2> updatePairs2;
         {
-            //TODO remove temp file even if one the following throws
-            QFile file(tempFile);
-            QInstaller::openForRead(&file);
-            QInstaller::blockingCopy(&file, archive, file.size());
+            CRecordVector<CUpdatePair> updatePairs;
+            GetUpdatePairInfoList(dirItems, arcItems, NFileTimeType::EEnum(fileTimeType),
+                updatePairs);
+            UpdateProduce(updatePairs, NUpdateArchive::kAddActionSet, updatePairs2, NULL);
+        }
+
+        CArchiveUpdateCallback *updateCallbackSpec = new CArchiveUpdateCallback;
+        CMyComPtr<IArchiveUpdateCallback> updateCallback(updateCallbackSpec);
+        updateCallbackSpec->ShareForWrite = false;
+        updateCallbackSpec->StdInMode = false;
+        updateCallbackSpec->Callback = callback->impl();
+        updateCallbackSpec->DirItems = &dirItems;
+        updateCallbackSpec->ArcItems = &arcItems;
+        updateCallbackSpec->UpdatePairs = &updatePairs2;
+
+        res = SetProperties(outArchive, compressionProperties(options));
+        if (res != S_OK) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z",
+                "Invalid compression options. %1").arg(errorMessageFrom7zResult(res)));
         }
 
-        QFile file(tempFile);
-        if (!file.remove()) {
-            qWarning("%s: Could not remove temporary file %s: %s", Q_FUNC_INFO, qPrintable(tempFile),
-                qPrintable(file.errorString()));
+        QFileDeviceOutStream *outStreamSpec = new QFileDeviceOutStream(archive);
+        CMyComPtr<IOutStream> outStream(outStreamSpec);
+        res = outArchive->UpdateItems(outStream, updatePairs2.Size(), updateCallback);
+        callback->impl()->Finilize();
+        if (res != S_OK) {
+            throw SevenZipException(QCoreApplication::translate("Lib7z",
+                "Could not create archive %1. %2").arg(archive->fileName(),
+                outStreamSpec->errorString().isEmpty() ? errorMessageFrom7zResult(res)
+                    : outStreamSpec->errorString()));
         }
     } catch (const char *err) {
         qDebug() << err;
         throw SevenZipException(err);
+    } catch (const SevenZipException &) {
+        throw;
     } catch (const QInstaller::Error &err) {
         throw SevenZipException(err.message());
     } catch (...) {
@@ -1422,7 +1985,7 @@ void Lib7z::extractFileFromArchive(QFileDevice* archive, const File& item, QFile
         callback = dummyCallback.get();
 
     try {
-        const OpenArchiveInfo* const openArchive = OpenArchiveInfo::value(archive);
+        const OpenArchive openArchive(archive);
 
         const int arcIdx = item.archiveIndex.x();
         if (arcIdx < 0 || arcIdx >= openArchive->archiveLink.Arcs.Size()) {
@@ -1491,8 +2054,201 @@ void Lib7z::extractFileFromArchive(QFileDevice* archive, const File& item,
     outDir.release();
 }
 
+namespace {
+/*
+    Extracts the items listed in \a indices, which belong to a subset of the solid blocks of an
+    archive, using its own archive handle. Used to decode several blocks of a 7z archive at once.
+*/
+class ExtractFoldersRunnable : public QRunnable
+{
+public:
+    ExtractFoldersRunnable(const QString &archivePath, const QVector<UInt32> &indices,
+            CMyComPtr<ExtractCallbackImpl> callback)
+        : m_archivePath(archivePath)
+        , m_indices(indices)
+        , m_callback(callback)
+        , m_result(S_OK)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        try {
+            QFile file(m_archivePath);
+            if (!file.open(QIODevice::ReadOnly)) {
+                Lib7z::setLastError(QCoreApplication::translate("Lib7z", "Could not open %1 for "
+                    "reading: %2.").arg(m_archivePath, file.errorString()));
+                m_result = E_FAIL;
+                return;
+            }
+
+            OpenArchive openArchive(&file);
+            openArchive.close();
+            if (openArchive->archiveLink.Arcs.Size() != 1) {
+                Lib7z::setLastError(QCoreApplication::translate("Lib7z", "Could not open archive"));
+                m_result = E_FAIL;
+                return;
+            }
+
+            const CArc &arc = openArchive->archiveLink.Arcs[0];
+            m_callback->setArchive(&arc);
+            m_result = arc.Archive->Extract(m_indices.constData(), m_indices.count(), false, m_callback);
+        } catch (const SevenZipException &e) {
+            Lib7z::setLastError(e.message());
+            m_result = E_FAIL;
+        } catch (...) {
+            m_result = E_FAIL;
+        }
+    }
+
+    HRESULT result() const { return m_result; }
+
+private:
+    const QString m_archivePath;
+    const QVector<UInt32> m_indices;
+    CMyComPtr<ExtractCallbackImpl> m_callback;
+    HRESULT m_result;
+};
+}
+
+/*
+    Distributes the solid blocks (folders) of \a arc over at most \a threadCount lists of item
+    indices, balanced by their uncompressed size. Directories are returned in \a directories,
+    other items not stored in any block, like empty files, go into the first list. Returns less
+    than two lists if the archive has only one block.
+*/
+static QVector<QVector<UInt32> > partitionArchiveFolders(const CArc &arc, int threadCount,
+    QVector<UInt32> *directories)
+{
+    IInArchive* const arch = arc.Archive;
+    UInt32 numItems = 0;
+    if (arch->GetNumberOfItems(&numItems) != S_OK)
+        return QVector<QVector<UInt32> >();
+
+    QHash<UInt32, QVector<UInt32> > folderItems;
+    QHash<UInt32, quint64> folderSizes;
+    QVector<UInt32> unpackedItems;
+    for (UInt32 item = 0; item < numItems; ++item) {
+        bool isDirectory = false;
+        IsArchiveItemFolder(arch, item, isDirectory);
+        if (isDirectory) {
+            directories->append(item);
+            continue;
+        }
+
+        const NCOM::CPropVariant prop = readProperty(arch, item, kpidBlock);
+        if (prop.vt != VT_UI4) {
+            unpackedItems.append(item);
+            continue;
+        }
+        folderItems[prop.ulVal].append(item);
+        folderSizes[prop.ulVal] += getUInt64Property(arch, item, kpidSize, 0);
+    }
+
+    if (folderItems.count() < 2)
+        return QVector<QVector<UInt32> >();
+
+    // biggest blocks first, each one to the currently least loaded thread
+    QList<QPair<quint64, UInt32> > folders;
+    foreach (UInt32 folder, folderItems.keys())
+        folders.append(qMakePair(folderSizes.value(folder), folder));
+    std::sort(folders.begin(), folders.end());
+    std::reverse(folders.begin(), folders.end());
+
+    const int count = qMin(threadCount, folders.count());
+    QVector<QVector<UInt32> > partitions(count);
+    QVector<quint64> loads(count, 0);
+    partitions[0] = unpackedItems;
+    for (int i = 0; i < folders.count(); ++i) {
+        const int target = std::min_element(loads.begin(), loads.end()) - loads.begin();
+        partitions[target] += folderItems.value(folders.at(i).second);
+        loads[target] += folders.at(i).first;
+    }
+
+    // the 7z handler expects the indices in ascending order
+    for (int i = 0; i < partitions.count(); ++i)
+        std::sort(partitions[i].begin(), partitions[i].end());
+    return partitions;
+}
+
+/*
+    Extracts the archive behind \a openArchive using up to \a threadCount threads, each decoding
+    a different set of solid blocks. Returns \c false if the archive cannot be split up, without
+    extracting anything.
+*/
+static bool extractArchiveConcurrently(QFileDevice *archive, const OpenArchive &openArchive,
+    const QString &targetDirectory, ExtractCallback *callback, int threadCount)
+{
+    // every thread needs its own archive handle, so we need to be able to open the file again
+    const QString archivePath = archive->fileName();
+    if (archivePath.isEmpty() || !QFileInfo(archivePath).isNativePath()
+        || openArchive->archiveLink.Arcs.Size() != 1) {
+            return false;
+    }
+
+    const CArc &arc = openArchive->archiveLink.Arcs[0];
+    QVector<UInt32> directories;
+    const QVector<QVector<UInt32> > partitions = partitionArchiveFolders(arc, threadCount,
+        &directories);
+    if (partitions.count() < 2)
+        return false;
+
+    ExtractSynchronization sync(partitions.count());
+
+    // Create all directories up front, the blocks write into them from different threads. Their
+    // attributes are applied at the very end: a directory without write permission would make
+    // the other threads fail, and every file created inside changes its modification time.
+    CMyComPtr<ExtractCallbackImpl> directoryImpl = new ExtractCallbackImpl(callback);
+    directoryImpl->setTarget(targetDirectory);
+    directoryImpl->setArchive(&arc);
+    directoryImpl->setSynchronization(&sync, 0);
+    directoryImpl->setDeferDirectoryAttributes(true);
+    if (!directories.isEmpty()) {
+        const HRESULT result = arc.Archive->Extract(directories.constData(), directories.count(),
+            false, directoryImpl);
+        if (result != S_OK)
+            throw SevenZipException(errorMessageFrom7zResult(result));
+    }
+
+    QList<ExtractFoldersRunnable*> runnables;
+    for (int i = 1; i < partitions.count(); ++i) {
+        CMyComPtr<ExtractCallbackImpl> impl = new ExtractCallbackImpl(callback);
+        impl->setTarget(targetDirectory);
+        impl->setSynchronization(&sync, i);
+        runnables.append(new ExtractFoldersRunnable(archivePath, partitions.at(i), impl));
+    }
+
+    // use a private pool, the calling thread might be one of the global pool already
+    QThreadPool pool;
+    pool.setMaxThreadCount(runnables.count());
+    foreach (ExtractFoldersRunnable *runnable, runnables)
+        pool.start(runnable);
+
+    // the first partition is extracted by the calling thread, using the already opened archive
+    CMyComPtr<ExtractCallbackImpl> impl = new ExtractCallbackImpl(callback);
+    impl->setTarget(targetDirectory);
+    impl->setArchive(&arc);
+    impl->setSynchronization(&sync, 0);
+    const QVector<UInt32> &indices = partitions.at(0);
+    HRESULT result = arc.Archive->Extract(indices.constData(), indices.count(), false, impl);
+
+    pool.waitForDone();
+    foreach (ExtractFoldersRunnable *runnable, runnables) {
+        if (result == S_OK)
+            result = runnable->result();
+        delete runnable;
+    }
+
+    if (result == S_OK)
+        result = directoryImpl->applyDirectoryAttributes();
+    if (result != S_OK)
+        throw SevenZipException(errorMessageFrom7zResult(result));
+    return true;
+}
+
 void Lib7z::extractArchive(QFileDevice* archive, const QString &targetDirectory,
-    ExtractCallback* callback)
+    ExtractCallback* callback, int threadCount)
 {
     assert(archive);
 
@@ -1506,7 +2262,14 @@ void Lib7z::extractArchive(QFileDevice* archive, const QString &targetDirectory,
     DirectoryGuard outDir(fi.absolutePath());
     outDir.tryCreate();
 
-    const OpenArchiveInfo* const openArchive = OpenArchiveInfo::value(archive);
+    OpenArchive openArchive(archive);
+    openArchive.close();
+
+    if (threadCount > 1 && extractArchiveConcurrently(archive, openArchive, targetDirectory, callback,
+        threadCount)) {
+            outDir.release();
+            return;
+    }
 
     for (int a = 0; a < openArchive->archiveLink.Arcs.Size(); ++a)
     {
@@ -1537,22 +2300,26 @@ bool Lib7z::isSupportedArchive(QFileDevice* archive)
     assert(!archive->isSequential());
     const qint64 initialPos = archive->pos();
     try {
-        QScopedPointer<CCodecs> codecs(new CCodecs);
-        if (codecs->Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Could not load codecs"));
-
-        CIntVector formatIndices;
+        CodecRegistry *const registry = codecRegistry();
+        CCodecs *const codecs = registry->codecs();
 
-        if (!codecs->FindFormatForArchiveType(L"", formatIndices)) {
-            throw SevenZipException(QCoreApplication::translate("Lib7z",
-                "Could not retrieve default format"));
+        const ArchiveKey key = ArchiveKey::fromDevice(archive);
+        if (key.isValid()) {
+            // keep the archive open for the listing and extraction that usually follow
+            try {
+                const OpenArchive openArchive(archive, key);
+            } catch (const SevenZipException &) {
+                return false;
+            }
+            return true;
         }
+
         CArchiveLink archiveLink;
         //CMyComPtr is needed, otherwise it crashes in OpenStream()
         const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
 
-        const HRESULT result = archiveLink.Open2(codecs.data(), formatIndices, /*stdInMode*/false, stream,
-            UString(), 0);
+        const HRESULT result = archiveLink.Open2(codecs, registry->formatIndices(),
+            /*stdInMode*/false, stream, UString(), 0);
 
         archive->seek(initialPos);
         return result == S_OK;
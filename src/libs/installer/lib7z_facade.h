@@ -86,6 +86,93 @@ namespace Lib7z {
         QPoint archiveIndex;
     };
 
+    /*!
+        A compact description of an archive item, passed to ArchiveVisitor::visit(). Items of the
+        same folder share the folder part of their path. Only the properties requested when
+        listing the archive are set.
+    */
+    class INSTALLER_EXPORT ArchiveEntry
+    {
+    public:
+        ArchiveEntry();
+
+        QString path() const;
+        QString directory() const { return m_directory; }
+        QString fileName() const { return m_fileName; }
+
+        bool isDirectory() const { return m_attributes & DirectoryAttribute; }
+        QFile::Permissions permissions() const;
+        QDateTime modificationTime() const;
+        quint64 uncompressedSize() const { return m_uncompressedSize; }
+        quint64 compressedSize() const { return m_compressedSize; }
+        QPoint archiveIndex() const { return QPoint(m_archive, m_index); }
+
+        File toFile() const;
+
+    private:
+        friend class ArchiveLister;
+        enum { PermissionsMask = 0xffff, DirectoryAttribute = 0x10000 };
+
+        QString m_directory;
+        QString m_fileName;
+        quint32 m_attributes;
+        qint32 m_archive;
+        quint32 m_index;
+        qint64 m_modificationTime;
+        quint64 m_uncompressedSize;
+        quint64 m_compressedSize;
+    };
+
+    enum ListProperty {
+        ListPaths = 0x01,
+        ListSizes = 0x02,
+        ListCompressedSizes = 0x04,
+        ListModificationTimes = 0x08,
+        ListPermissions = 0x10,
+        ListAllProperties = 0x1f
+    };
+    Q_DECLARE_FLAGS(ListProperties, ListProperty)
+
+    /*!
+        Receives the items of an archive listed by listArchive(). Return \c false from visit() to
+        stop the listing.
+    */
+    class INSTALLER_EXPORT ArchiveVisitor
+    {
+    public:
+        virtual ~ArchiveVisitor() {}
+        virtual bool visit(const ArchiveEntry &entry) = 0;
+    };
+
+    struct ArchiveStatistics
+    {
+        ArchiveStatistics()
+            : fileCount(0), directoryCount(0), uncompressedSize(0), compressedSize(0) {}
+
+        quint64 fileCount;
+        quint64 directoryCount;
+        quint64 uncompressedSize;
+        quint64 compressedSize;
+    };
+
+    /*!
+        Tunes how createArchive() compresses. An empty \c method and negative or zero numbers
+        keep the 7z defaults. \c method is one of LZMA, LZMA2, PPMd, BZip2, Deflate or Copy,
+        \c level ranges from 0 (store) to 9 (ultra). A \c solidBlockSize of 0 disables solid
+        compression.
+    */
+    struct CompressionOptions
+    {
+        CompressionOptions()
+            : level(-1), threadCount(0), solidBlockSize(-1), dictionarySize(0) {}
+
+        QString method;
+        int level;
+        int threadCount;
+        qint64 solidBlockSize;
+        quint64 dictionarySize;
+    };
+
     class ExtractCallbackPrivate;
     class ExtractCallbackImpl;
 
@@ -135,14 +222,6 @@ namespace Lib7z {
         UpdateCallbackPrivate* const d;
     };
 
-    class OpenArchiveInfoCleaner : public QObject {
-            Q_OBJECT
-        public:
-            OpenArchiveInfoCleaner() {}
-        private Q_SLOTS:
-            void deviceDestroyed(QObject*);
-    };
-
     /*!
         Extracts the given File \a file from \a archive into output device \a out using the
         provided extract callback \a callback.
@@ -167,10 +246,14 @@ namespace Lib7z {
         provided extract callback \a callback. The output filenames are deduced from the \a archive
         content.
 
+        If \a threadCount is greater than one and \a archive is a file on disk containing several
+        solid blocks, up to \a threadCount blocks are decoded concurrently. The calls into
+        \a callback are serialized in that case, and its progress reflects all blocks.
+
         Throws Lib7z::SevenZipException on error.
     */
     void INSTALLER_EXPORT extractArchive(QFileDevice* archive, const QString& targetDirectory,
-        ExtractCallback* callback = 0);
+        ExtractCallback* callback = 0, int threadCount = 1);
 
     /*
      * @thows Lib7z::SevenZipException
@@ -178,11 +261,39 @@ namespace Lib7z {
     void INSTALLER_EXPORT createArchive(QFileDevice* archive, const QStringList& sourcePaths,
         UpdateCallback* callback = 0 );
 
+    /*!
+        Compresses \a sourcePaths into \a archive, starting at the current position of the device,
+        using the given compression \a options. The archive is written directly to the device, so
+        \a archive needs to be seekable and open for writing.
+
+        Throws Lib7z::SevenZipException on error.
+    */
+    void INSTALLER_EXPORT createArchive(QFileDevice* archive, const QStringList& sourcePaths,
+        const CompressionOptions& options, UpdateCallback* callback = 0);
+
     /*
      * @throws Lib7z::SevenZipException
      */
     QVector<File> INSTALLER_EXPORT listArchive(QFileDevice* archive);
 
+    /*!
+        Passes the items of \a archive one by one to \a visitor, until all items are listed or
+        the visitor returns \c false. Only the given \a properties are read from the archive.
+        Does not use the event loop, so it can be called from any thread.
+
+        Throws Lib7z::SevenZipException on error.
+    */
+    void INSTALLER_EXPORT listArchive(QFileDevice* archive, ArchiveVisitor* visitor,
+        ListProperties properties = ListAllProperties);
+
+    /*!
+        Returns the number and the accumulated sizes of the items in \a archive, without reading
+        their paths.
+
+        Throws Lib7z::SevenZipException on error.
+    */
+    ArchiveStatistics INSTALLER_EXPORT archiveStatistics(QFileDevice* archive);
+
     /*
      * @throws Lib7z::SevenZipException
      */
@@ -284,4 +395,6 @@ namespace Lib7z {
     QByteArray INSTALLER_EXPORT formatKeyValuePairs( const QVariantList& l );
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(Lib7z::ListProperties)
+
 #endif // LIB7Z_FACADE_H
@@ -41,10 +41,63 @@
 #include "serverauthenticationdialog.h"
 #include "settings.h"
 
+#include "kdupdaterupdatesinfo_p.h"
+
+#include <QCryptographicHash>
+#include <QLockFile>
+#include <QSettings>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 
 namespace QInstaller {
 
+/*
+    Returns the persistent directory below \a cacheRoot holding the meta data of \a repository, or
+    an empty string if there is no cache root.
+*/
+static QString cacheDirectory(const QString &cacheRoot, const Repository &repository)
+{
+    if (cacheRoot.isEmpty())
+        return QString();
+
+    const QString directory = cacheRoot + QLatin1Char('/') + QString::fromLatin1(
+        QCryptographicHash::hash(repository.url().toString().toUtf8(), QCryptographicHash::Sha1)
+        .toHex());
+    if (!QDir().mkpath(directory))
+        return QString();
+    return directory;
+}
+
+/*
+    Returns the file that records the validators of Updates.xml and the SHA1 checksums of the
+    meta data extracted to \a directory.
+*/
+static QString cacheFile(const QString &directory)
+{
+    return directory + QLatin1String("/cache.ini");
+}
+
+/*
+    Removes the meta data of all packages in \a directory that are not listed in \a packageNames,
+    together with their entries in \a cache.
+*/
+static void pruneCacheDirectory(const QString &directory, QSettings *cache,
+    const QSet<QString> &packageNames)
+{
+    const QDir dir(directory);
+    foreach (const QString &entry, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (!packageNames.contains(entry))
+            QDir(dir.filePath(entry)).removeRecursively();
+    }
+
+    cache->beginGroup(QLatin1String("Packages"));
+    foreach (const QString &packageName, cache->childGroups()) {
+        if (!packageNames.contains(packageName))
+            cache->remove(packageName);
+    }
+    cache->endGroup();
+}
+
 MetadataJob::MetadataJob(QObject *parent)
     : KDJob(parent)
     , m_core(0)
@@ -65,6 +118,28 @@ Repository MetadataJob::repositoryForDirectory(const QString &directory) const
     return m_metadata.value(directory).repository;
 }
 
+/*
+    Returns a temporary directory to download the payload archives of the fetched components to,
+    or an empty string if it could not be created. The meta data directories might be part of the
+    persistent cache, so the archives are kept apart. The directory is removed together with the
+    temporary meta data directories.
+*/
+QString MetadataJob::archivesDirectory()
+{
+    if (m_archivesDirectory.isEmpty()) {
+        QTemporaryDir tmp(QDir::tempPath() + QLatin1String("/remoterepo-archives-XXXXXX"));
+        if (!tmp.isValid()) {
+            qDebug() << "Could not create unique temporary directory.";
+            return QString();
+        }
+
+        tmp.setAutoRemove(false);
+        m_archivesDirectory = tmp.path();
+        m_tempDirDeleter.add(m_archivesDirectory);
+    }
+    return m_archivesDirectory;
+}
+
 
 // -- private slots
 
@@ -79,6 +154,8 @@ void MetadataJob::doStart()
     emit infoMessage(this, tr("Preparing meta information download..."));
     const bool onlineInstaller = m_core->isInstaller() && !m_core->isOfflineOnly();
     if (onlineInstaller || m_core->isMaintainer()) {
+        lockCacheRoot();
+
         QList<FileTaskItem> items;
         const ProductKeyCheck *const productKeyCheck = ProductKeyCheck::instance();
         foreach (const Repository &repo, m_core->settings().repositories()) {
@@ -87,19 +164,33 @@ void MetadataJob::doStart()
                 authenticator.setUser(repo.username());
                 authenticator.setPassword(repo.password());
 
-                QString url = repo.url().toString() + QLatin1String("/Updates.xml?");
+                QString url = repo.url().toString() + QLatin1String("/Updates.xml");
                 if (!m_core->value(QLatin1String("UrlQueryString")).isEmpty())
-                    url += m_core->value(QLatin1String("UrlQueryString")) + QLatin1Char('&');
+                    url += QLatin1Char('?') + m_core->value(QLatin1String("UrlQueryString"));
+
+                // only fetch Updates.xml again if it changed since the cached copy was downloaded,
+                // the validators also make sure proxy caches do not hand out a stale copy
+                QByteArray eTag, lastModified;
+                const QString directory = cacheDirectory(m_cacheRoot, repo);
+                if (!directory.isEmpty() && QFileInfo(directory + QLatin1String("/Updates.xml"))
+                    .exists()) {
+                        const QSettings cache(cacheFile(directory), QSettings::IniFormat);
+                        eTag = cache.value(QLatin1String("Updates/ETag")).toByteArray();
+                        lastModified = cache.value(QLatin1String("Updates/LastModified"))
+                            .toByteArray();
+                }
 
-                // also append a random string to avoid proxy caches
-                FileTaskItem item(url.append(QString::number(qrand() * qrand())));
+                FileTaskItem item(url);
                 item.insert(TaskRole::UserRole, QVariant::fromValue(repo));
                 item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
+                item.insert(TaskRole::ETag, eTag);
+                item.insert(TaskRole::LastModified, lastModified);
                 items.append(item);
             }
         }
         DownloadFileTask *const xmlTask = new DownloadFileTask(items);
         xmlTask->setProxyFactory(m_core->proxyFactory());
+        xmlTask->setMaxConcurrentDownloads(m_core->settings().maxConcurrentDownloads());
         m_xmlTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, xmlTask));
     } else {
         emitFinished();
@@ -182,10 +273,14 @@ void MetadataJob::xmlTaskFinished()
     if (error() != KDJob::NoError)
         return;
 
-    if (status == XmlDownloadSuccess) {
+    if (status == XmlDownloadSuccess && m_packages.isEmpty()) {
+        setProcessedAmount(100);
+        emitFinished();     // all meta data is up to date already
+    } else if (status == XmlDownloadSuccess) {
         setProcessedAmount(0);
         DownloadFileTask *const metadataTask = new DownloadFileTask(m_packages);
         metadataTask->setProxyFactory(m_core->proxyFactory());
+        metadataTask->setMaxConcurrentDownloads(m_core->settings().maxConcurrentDownloads());
         m_metadataTask.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, metadataTask));
         emit infoMessage(this, tr("Retrieving meta information from remote repository..."));
     } else if (status == XmlDownloadRetry) {
@@ -220,6 +315,7 @@ void MetadataJob::unzipTaskFinished()
     delete watcher;
 
     if (m_unzipTasks.isEmpty()) {
+        updateCache();
         setProcessedAmount(100);
         emitFinished();
     }
@@ -286,6 +382,57 @@ void MetadataJob::reset()
         m_unzipTasks.clear();
     } catch (...) {}
     m_tempDirDeleter.releaseAndDeleteAll();
+    m_archivesDirectory.clear();
+    KDUpdater::UpdatesInfo::clearCache();
+
+    m_cacheRoot.clear();
+    m_cacheLock.reset();
+}
+
+/*
+    Locks the directory below the writable cache location that holds the meta data of all
+    repositories, so that no other installer changes it while the meta data is in use. The lock
+    is held until the job is started again or destroyed. If there is no writable cache location
+    or another process holds the lock, temporary directories are used instead.
+*/
+void MetadataJob::lockCacheRoot()
+{
+    const QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (location.isEmpty())
+        return;
+
+    const QString cacheRoot = location + QLatin1String("/metadata");
+    if (!QDir().mkpath(cacheRoot))
+        return;
+
+    m_cacheLock.reset(new QLockFile(cacheRoot + QLatin1String(".lock")));
+    m_cacheLock->setStaleLockTime(0);   // only stale if the owning process is gone
+    if (!m_cacheLock->tryLock()) {
+        qDebug() << "Meta data cache" << cacheRoot << "is in use by another process.";
+        m_cacheLock.reset();
+        return;
+    }
+    m_cacheRoot = cacheRoot;
+}
+
+void MetadataJob::updateCache()
+{
+    // remember the checksums of all extracted archives, so the next run can skip them
+    QScopedPointer<QSettings> cache;
+    foreach (const FileTaskItem &item, m_packages) {
+        const QString packageName = item.value(TaskRole::PackageName).toString();
+        if (packageName.isEmpty())
+            continue;
+
+        const QString file = cacheFile(item.value(TaskRole::UserRole).toString());
+        if (!cache || cache->fileName() != file)
+            cache.reset(new QSettings(file, QSettings::IniFormat));
+
+        const QString cacheKey = QLatin1String("Packages/") + packageName;
+        cache->setValue(cacheKey + QLatin1String("/Version"), item.value(TaskRole::PackageVersion));
+        cache->setValue(cacheKey + QLatin1String("/SHA1"),
+            QString::fromLatin1(item.value(TaskRole::Checksum).toByteArray()));
+    }
 }
 
 MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &results)
@@ -294,124 +441,145 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
         if (error() != KDJob::NoError)
             return XmlDownloadFailure;
 
-        Metadata metadata;
-        QTemporaryDir tmp(QDir::tempPath() + QLatin1String("/remoterepo-XXXXXX"));
-        if (!tmp.isValid()) {
-            qDebug() << "Could not create unique temporary directory.";
-            return XmlDownloadFailure;
-        }
+        const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
 
-        tmp.setAutoRemove(false);
-        metadata.directory = tmp.path();
-        m_tempDirDeleter.add(metadata.directory);
+        Metadata metadata;
+        metadata.repository = item.value(TaskRole::UserRole).value<Repository>();
+        metadata.directory = cacheDirectory(m_cacheRoot, metadata.repository);
+        if (metadata.directory.isEmpty()) {
+            QTemporaryDir tmp(QDir::tempPath() + QLatin1String("/remoterepo-XXXXXX"));
+            if (!tmp.isValid()) {
+                qDebug() << "Could not create unique temporary directory.";
+                return XmlDownloadFailure;
+            }
 
-        QFile file(result.target());
-        if (!file.rename(metadata.directory + QLatin1String("/Updates.xml"))) {
-            qDebug() << "Could not rename target to Updates.xml. Error:" << file.errorString();
-            return XmlDownloadFailure;
+            tmp.setAutoRemove(false);
+            metadata.directory = tmp.path();
+            m_tempDirDeleter.add(metadata.directory);
         }
 
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << "Could not open Updates.xml for reading. Error:" << file.errorString();
-            return XmlDownloadFailure;
+        const QString updatesXml = metadata.directory + QLatin1String("/Updates.xml");
+        QSettings cache(cacheFile(metadata.directory), QSettings::IniFormat);
+        if (item.value(TaskRole::NotModified).toBool()) {
+            QFile::remove(result.target());
+            qDebug() << "Updates.xml of repository" << metadata.repository.displayname()
+                << "did not change.";
+        } else {
+            cache.remove(QLatin1String("Updates"));
+            QFile::remove(updatesXml);
+
+            QFile file(result.target());
+            if (!file.rename(updatesXml)) {
+                qDebug() << "Could not rename target to Updates.xml. Error:" << file.errorString();
+                return XmlDownloadFailure;
+            }
         }
+        const bool online = !(metadata.repository.url().scheme()).isEmpty();
 
-        QString error;
-        QDomDocument doc;
-        if (!doc.setContent(&file, &error)) {
+        // the parsed file is shared with everyone else reading it later on
+        KDUpdater::UpdatesInfo updatesInfo;
+        updatesInfo.setFileName(updatesXml);
+        if (updatesInfo.error() == KDUpdater::UpdatesInfo::CouldNotReadUpdateInfoFileError
+            || updatesInfo.error() == KDUpdater::UpdatesInfo::InvalidXmlError) {
             qDebug() << QString::fromLatin1("Could not fetch a valid version of Updates.xml from "
-                "repository: %1. Error: %2").arg(metadata.repository.displayname(), error);
+                "repository: %1. Error: %2").arg(metadata.repository.displayname(),
+                updatesInfo.errorString());
+            cache.remove(QLatin1String("Updates"));
             return XmlDownloadFailure;
         }
-        file.close();
-
-        const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
-        metadata.repository = item.value(TaskRole::UserRole).value<Repository>();
-        const bool online = !(metadata.repository.url().scheme()).isEmpty();
+        cache.setValue(QLatin1String("Updates/ETag"), item.value(TaskRole::ETag));
+        cache.setValue(QLatin1String("Updates/LastModified"), item.value(TaskRole::LastModified));
 
         bool testCheckSum = true;
-        const QDomElement root = doc.documentElement();
-        const QDomNode checksum = root.firstChildElement(QLatin1String("Checksum"));
-        if (!checksum.isNull())
-            testCheckSum = (checksum.toElement().text().toLower() == scTrue);
-
-        QDomNodeList children = root.childNodes();
-        for (int i = 0; i < children.count(); ++i) {
-            const QDomElement el = children.at(i).toElement();
-            if (!el.isNull() && el.tagName() == QLatin1String("PackageUpdate")) {
-                const QDomNodeList c2 = el.childNodes();
-                QString packageName, packageVersion, packageHash;
-                for (int j = 0; j < c2.count(); ++j) {
-                    if (c2.at(j).toElement().tagName() == scName)
-                        packageName = c2.at(j).toElement().text();
-                    else if (c2.at(j).toElement().tagName() == scVersion)
-                        packageVersion = (online ? c2.at(j).toElement().text() : QString());
-                    else if ((c2.at(j).toElement().tagName() == QLatin1String("SHA1")) && testCheckSum)
-                        packageHash = c2.at(j).toElement().text();
-                }
-
-                const QString repoUrl = metadata.repository.url().toString();
-                FileTaskItem item(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName,
-                    packageVersion), metadata.directory + QString::fromLatin1("/%1-%2-meta.7z")
-                    .arg(packageName, packageVersion));
-
-                QAuthenticator authenticator;
-                authenticator.setUser(metadata.repository.username());
-                authenticator.setPassword(metadata.repository.password());
-
-                item.insert(TaskRole::UserRole, metadata.directory);
-                item.insert(TaskRole::Checksum, packageHash.toLatin1());
-                item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
-                m_packages.append(item);
+        if (!updatesInfo.checksum().isNull())
+            testCheckSum = (updatesInfo.checksum().toLower() == scTrue);
+
+        QSet<QString> packageNames;
+        foreach (const KDUpdater::UpdateInfo &info, updatesInfo.updatesInfo()) {
+            const QString packageName = info.data.value(scName).toString();
+            packageNames.insert(packageName);
+            const QString packageVersion = (online ? info.data.value(scVersion).toString()
+                : QString());
+            const QString packageHash = (testCheckSum ? info.data.value(QLatin1String("SHA1"))
+                .toString() : QString());
+
+            // keep the meta data extracted by a previous run as long as the archive is the same
+            const QString cacheKey = QLatin1String("Packages/") + packageName;
+            const QString packageDirectory = metadata.directory + QLatin1Char('/') + packageName;
+            if (!packageHash.isEmpty()
+                && cache.value(cacheKey + QLatin1String("/Version")).toString() == packageVersion
+                && cache.value(cacheKey + QLatin1String("/SHA1")).toString() == packageHash
+                && QFileInfo(packageDirectory).isDir()) {
+                    continue;
+            }
+            cache.remove(cacheKey);
+            if (!packageName.isEmpty())
+                QDir(packageDirectory).removeRecursively();
+
+            const QString repoUrl = metadata.repository.url().toString();
+            FileTaskItem item(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName,
+                packageVersion), metadata.directory + QString::fromLatin1("/%1-%2-meta.7z")
+                .arg(packageName, packageVersion));
+
+            QAuthenticator authenticator;
+            authenticator.setUser(metadata.repository.username());
+            authenticator.setPassword(metadata.repository.password());
+
+            item.insert(TaskRole::UserRole, metadata.directory);
+            item.insert(TaskRole::Checksum, packageHash.toLatin1());
+            item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
+            if (!packageHash.isEmpty()) {
+                item.insert(TaskRole::PackageName, packageName);
+                item.insert(TaskRole::PackageVersion, packageVersion);
             }
+            m_packages.append(item);
         }
+        pruneCacheDirectory(metadata.directory, &cache, packageNames);
         m_metadata.insert(metadata.directory, metadata);
 
         // search for additional repositories that we might need to check
-        const QDomNode repositoryUpdate = root.firstChildElement(QLatin1String("RepositoryUpdate"));
-        if (repositoryUpdate.isNull())
+        const QList<KDUpdater::RepositoryUpdateInfo> repositoryUpdateInfos
+            = updatesInfo.repositoryUpdates();
+        if (repositoryUpdateInfos.isEmpty())
             continue;
 
         QHash<QString, QPair<Repository, Repository> > repositoryUpdates;
-        children = repositoryUpdate.toElement().childNodes();
-        for (int i = 0; i < children.count(); ++i) {
-            const QDomElement el = children.at(i).toElement();
-            if (!el.isNull() && el.tagName() == QLatin1String("Repository")) {
-                const QString action = el.attribute(QLatin1String("action"));
-                if (action == QLatin1String("add")) {
-                    // add a new repository to the defaults list
-                    Repository repository(el.attribute(QLatin1String("url")), true);
-                    repository.setUsername(el.attribute(QLatin1String("username")));
-                    repository.setPassword(el.attribute(QLatin1String("password")));
-                    repository.setDisplayName(el.attribute(QLatin1String("displayname")));
-                    if (ProductKeyCheck::instance()->isValidRepository(repository)) {
-                        repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
-                        qDebug() << "Repository to add:" << repository.displayname();
-                    }
-                } else if (action == QLatin1String("remove")) {
-                    // remove possible default repositories using the given server url
-                    Repository repository(el.attribute(QLatin1String("url")), true);
+        foreach (const KDUpdater::RepositoryUpdateInfo &info, repositoryUpdateInfos) {
+            const QHash<QString, QString> &el = info.attributes;
+            const QString action = el.value(QLatin1String("action"));
+            if (action == QLatin1String("add")) {
+                // add a new repository to the defaults list
+                Repository repository(el.value(QLatin1String("url")), true);
+                repository.setUsername(el.value(QLatin1String("username")));
+                repository.setPassword(el.value(QLatin1String("password")));
+                repository.setDisplayName(el.value(QLatin1String("displayname")));
+                if (ProductKeyCheck::instance()->isValidRepository(repository)) {
                     repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
-
-                    qDebug() << "Repository to remove:" << repository.displayname();
-                } else if (action == QLatin1String("replace")) {
-                    // replace possible default repositories using the given server url
-                    Repository oldRepository(el.attribute(QLatin1String("oldUrl")), true);
-                    Repository newRepository(el.attribute(QLatin1String("newUrl")), true);
-                    newRepository.setUsername(el.attribute(QLatin1String("username")));
-                    newRepository.setPassword(el.attribute(QLatin1String("password")));
-                    newRepository.setDisplayName(el.attribute(QLatin1String("displayname")));
-
-                    if (ProductKeyCheck::instance()->isValidRepository(newRepository)) {
-                        // store the new repository and the one old it replaces
-                        repositoryUpdates.insertMulti(action, qMakePair(newRepository, oldRepository));
-                        qDebug() << "Replace repository:" << oldRepository.displayname() << "with:"
-                            << newRepository.displayname();
-                    }
-                } else {
-                    qDebug() << "Invalid additional repositories action set in Updates.xml fetched "
-                        "from:" << metadata.repository.displayname() << "Line:" << el.lineNumber();
+                    qDebug() << "Repository to add:" << repository.displayname();
                 }
+            } else if (action == QLatin1String("remove")) {
+                // remove possible default repositories using the given server url
+                Repository repository(el.value(QLatin1String("url")), true);
+                repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
+
+                qDebug() << "Repository to remove:" << repository.displayname();
+            } else if (action == QLatin1String("replace")) {
+                // replace possible default repositories using the given server url
+                Repository oldRepository(el.value(QLatin1String("oldUrl")), true);
+                Repository newRepository(el.value(QLatin1String("newUrl")), true);
+                newRepository.setUsername(el.value(QLatin1String("username")));
+                newRepository.setPassword(el.value(QLatin1String("password")));
+                newRepository.setDisplayName(el.value(QLatin1String("displayname")));
+
+                if (ProductKeyCheck::instance()->isValidRepository(newRepository)) {
+                    // store the new repository and the one old it replaces
+                    repositoryUpdates.insertMulti(action, qMakePair(newRepository, oldRepository));
+                    qDebug() << "Replace repository:" << oldRepository.displayname() << "with:"
+                        << newRepository.displayname();
+                }
+            } else {
+                qDebug() << "Invalid additional repositories action set in Updates.xml fetched "
+                    "from:" << metadata.repository.displayname() << "Line:" << info.lineNumber;
             }
         }
 
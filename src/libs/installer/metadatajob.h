@@ -41,6 +41,7 @@
 #include "repository.h"
 
 #include <QFutureWatcher>
+#include <QLockFile>
 
 namespace QInstaller {
 
@@ -69,6 +70,7 @@ public:
 
     QList<Metadata> metadata() const { return m_metadata.values(); }
     Repository repositoryForDirectory(const QString &directory) const;
+    QString archivesDirectory();
     void setPackageManagerCore(PackageManagerCore *core) { m_core = core; }
 
 private slots:
@@ -82,6 +84,8 @@ private slots:
 
 private:
     void reset();
+    void lockCacheRoot();
+    void updateCache();
     Status parseUpdatesXml(const QList<FileTaskResult> &results);
 
 private:
@@ -93,6 +97,10 @@ private:
     QFutureWatcher<FileTaskResult> m_xmlTask;
     QFutureWatcher<FileTaskResult> m_metadataTask;
     QHash<QFutureWatcher<void> *, QObject*> m_unzipTasks;
+
+    QString m_cacheRoot;
+    QScopedPointer<QLockFile> m_cacheLock;
+    QString m_archivesDirectory;
 };
 
 }   // namespace QInstaller
@@ -40,6 +40,14 @@
 
 namespace QInstaller{
 
+namespace TaskRole {
+enum
+{
+    PackageName = TaskRole::UserRole + 1,
+    PackageVersion
+};
+}
+
 class UnzipArchiveException : public QException
 {
 public:
@@ -81,6 +89,7 @@ public:
         if (archive.open(QIODevice::ReadOnly)) {
             try {
                 Lib7z::extractArchive(&archive, m_targetDir);
+                archive.remove();   // the extracted content is all we need
             } catch (const Lib7z::SevenZipException& e) {
                 fi.reportException(UnzipArchiveException(MetadataJob::tr("Error while extracting "
                     "'%1': %2").arg(m_archive, e.message())));
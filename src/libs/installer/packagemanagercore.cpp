@@ -332,9 +332,24 @@ static QFont *sVirtualComponentsFont = 0;
 Q_GLOBAL_STATIC(QMutex, globalVirtualComponentsFontMutex);
 
 static bool sNoForceInstallation = false;
+static bool sStreamingInstall = false;
+static bool sParallelInstall = false;
 static bool sVirtualComponentsVisible = false;
 static bool sCreateLocalRepositoryFromBinary = false;
 
+static void splitNameAndVersion(const QString &name, QString *fixedName, QString *fixedVersion)
+{
+    const int dash = name.indexOf(QLatin1Char('-'));
+    if (dash >= 0) {
+        // the last part is considered to be the version, then
+        *fixedName = name.left(dash);
+        *fixedVersion = name.mid(dash + 1);
+    } else {
+        *fixedName = name;
+        fixedVersion->clear();
+    }
+}
+
 static bool componentMatches(const Component *component, const QString &name,
     const QString &version = QString())
 {
@@ -550,49 +565,15 @@ int PackageManagerCore::downloadNeededArchives(double partProgressSize)
 {
     Q_ASSERT(partProgressSize >= 0 && partProgressSize <= 1);
 
-    QList<QPair<QString, QString> > archivesToDownload;
-    QList<Component*> neededComponents = orderedComponentsToInstall();
-    foreach (Component *component, neededComponents) {
-        // collect all archives to be downloaded
-        const QStringList toDownload = component->downloadableArchives();
-        foreach (const QString &versionFreeString, toDownload) {
-            archivesToDownload.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
-                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
-                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
-        }
-    }
-
-    if (archivesToDownload.isEmpty())
+    QScopedPointer<DownloadArchivesJob> archivesJob(d->startArchivesDownload(orderedComponentsToInstall(),
+        partProgressSize));
+    if (!archivesJob)
         return 0;
 
-    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
+    archivesJob->waitForFinished();
+    d->finishArchivesDownload(archivesJob.data());
 
-    DownloadArchivesJob archivesJob(this);
-    archivesJob.setAutoDelete(false);
-    archivesJob.setArchivesToDownload(archivesToDownload);
-    connect(this, SIGNAL(installationInterrupted()), &archivesJob, SLOT(cancel()));
-    connect(&archivesJob, SIGNAL(outputTextChanged(QString)), ProgressCoordinator::instance(),
-        SLOT(emitLabelAndDetailTextChanged(QString)));
-    connect(&archivesJob, SIGNAL(downloadStatusChanged(QString)), ProgressCoordinator::instance(),
-        SIGNAL(downloadStatusChanged(QString)));
-
-    ProgressCoordinator::instance()->registerPartProgress(&archivesJob,
-        SIGNAL(progressChanged(double)), partProgressSize);
-
-    archivesJob.start();
-    archivesJob.waitForFinished();
-
-    if (archivesJob.error() == KDJob::Canceled)
-        interrupt();
-    else if (archivesJob.error() != KDJob::NoError)
-        throw Error(archivesJob.errorString());
-
-    if (d->statusCanceledOrFailed())
-        throw Error(tr("Installation canceled by user"));
-
-    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
-
-    return archivesJob.numberOfDownloads();
+    return archivesJob->numberOfDownloads();
 }
 
 /*!
@@ -826,6 +807,45 @@ void PackageManagerCore::setNoForceInstallation(bool value)
     sNoForceInstallation = value;
 }
 
+/*!
+    Returns \c true if components are installed while the archives of later components are still
+    being downloaded.
+*/
+/* static */
+bool PackageManagerCore::streamingInstall()
+{
+    return sStreamingInstall;
+}
+
+/*!
+    Sets whether components are installed as soon as their archives have been downloaded, instead
+    of waiting for all downloads to finish, to \a value.
+*/
+/* static */
+void PackageManagerCore::setStreamingInstall(bool value)
+{
+    sStreamingInstall = value;
+}
+
+/*!
+    Returns \c true if components that do not depend on each other are installed concurrently.
+*/
+/* static */
+bool PackageManagerCore::parallelInstall()
+{
+    return sParallelInstall;
+}
+
+/*!
+    Sets whether components that do not depend on each other are installed concurrently to
+    \a value.
+*/
+/* static */
+void PackageManagerCore::setParallelInstall(bool value)
+{
+    sParallelInstall = value;
+}
+
 /* static */
 bool PackageManagerCore::createLocalRepositoryFromBinary()
 {
@@ -1169,6 +1189,7 @@ ScriptEngine *PackageManagerCore::controlScriptEngine() const
 void PackageManagerCore::appendRootComponent(Component *component)
 {
     d->m_rootComponents.append(component);
+    d->clearComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1236,6 +1257,7 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 {
     component->setUpdateAvailable(true);
     d->m_updaterComponents.append(component);
+    d->clearComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1249,7 +1271,7 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 */
 Component *PackageManagerCore::componentByName(const QString &name) const
 {
-    return componentByName(name, components(ComponentType::AllNoReplacements));
+    return componentByName(name, d->componentIndex());
 }
 
 Component *PackageManagerCore::componentByName(const QString &name, const QList<Component *> &components)
@@ -1257,13 +1279,9 @@ Component *PackageManagerCore::componentByName(const QString &name, const QList<
     if (name.isEmpty())
         return 0;
 
+    QString fixedName;
     QString fixedVersion;
-    QString fixedName = name;
-    if (name.contains(QChar::fromLatin1('-'))) {
-        // the last part is considered to be the version, then
-        fixedVersion = name.section(QLatin1Char('-'), 1);
-        fixedName = name.section(QLatin1Char('-'), 0, 0);
-    }
+    splitNameAndVersion(name, &fixedName, &fixedVersion);
 
     foreach (Component *component, components) {
         if (componentMatches(component, fixedName, fixedVersion))
@@ -1273,6 +1291,49 @@ Component *PackageManagerCore::componentByName(const QString &name, const QList<
     return 0;
 }
 
+/*!
+    \overload
+
+    Returns the first component in \a index matching \a name, where \a index has been created
+    by componentIndex(). Unlike searching a list of components, the lookup does not depend on
+    the number of components, so use it when resolving many names against the same components.
+*/
+Component *PackageManagerCore::componentByName(const QString &name,
+    const QHash<QString, QList<Component *> > &index)
+{
+    if (name.isEmpty())
+        return 0;
+
+    QString fixedName;
+    QString fixedVersion;
+    splitNameAndVersion(name, &fixedName, &fixedVersion);
+
+    const QHash<QString, QList<Component *> >::const_iterator it = index.constFind(fixedName);
+    if (it == index.constEnd())
+        return 0;
+
+    foreach (Component *component, it.value()) {
+        if (componentMatches(component, fixedName, fixedVersion))
+            return component;
+    }
+
+    return 0;
+}
+
+/*!
+    Returns \a components indexed by name for use with componentByName(). Components sharing
+    a name keep the order they have in \a components.
+*/
+QHash<QString, QList<Component *> > PackageManagerCore::componentIndex(
+    const QList<Component *> &components)
+{
+    QHash<QString, QList<Component *> > index;
+    index.reserve(components.count());
+    foreach (Component *component, components)
+        index[component->name()].append(component);
+    return index;
+}
+
 QList<Component *> PackageManagerCore::componentsMarkedForInstallation() const
 {
     QList<Component*> markedForInstallation;
@@ -1399,14 +1460,13 @@ QList<Component*> PackageManagerCore::dependees(const Component *_component) con
     if (availableComponents.isEmpty())
         return QList<Component *>();
 
-    const QLatin1Char dash('-');
+    QString name;
+    QString version;
     QList<Component *> dependees;
     foreach (Component *component, availableComponents) {
         const QStringList &dependencies = component->dependencies();
         foreach (const QString &dependency, dependencies) {
-            // the last part is considered to be the version then
-            const QString name = dependency.contains(dash) ? dependency.section(dash, 0, 0) : dependency;
-            const QString version = dependency.contains(dash) ? dependency.section(dash, 1) : QString();
+            splitNameAndVersion(dependency, &name, &version);
             if (componentMatches(_component, name, version))
                 dependees.append(component);
         }
@@ -2016,6 +2076,7 @@ bool PackageManagerCore::isOfflineOnly() const
 void PackageManagerCore::setUninstaller()
 {
     d->m_magicBinaryMarker = BinaryContent::MagicUninstallerMarker;
+    d->clearComponentIndex();
 }
 
 /*!
@@ -2040,6 +2101,7 @@ bool PackageManagerCore::isUninstaller() const
 void PackageManagerCore::setUpdater()
 {
     d->m_magicBinaryMarker = BinaryContent::MagicUpdaterMarker;
+    d->clearComponentIndex();
 }
 
 /*!
@@ -2062,6 +2124,7 @@ bool PackageManagerCore::isUpdater() const
 void PackageManagerCore::setPackageManager()
 {
     d->m_magicBinaryMarker = BinaryContent::MagicPackageManagerMarker;
+    d->clearComponentIndex();
 }
 
 
@@ -2436,6 +2499,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
 
             std::sort(d->m_updaterComponents.begin(), d->m_updaterComponents.end(),
                 Component::SortingPriorityGreaterThan());
+            d->clearComponentIndex();
         } else {
             // we have no updates, no need to store possible dependencies
             d->clearUpdaterComponentLists();
@@ -114,10 +114,19 @@ public:
     static bool noForceInstallation();
     static void setNoForceInstallation(bool value);
 
+    static bool streamingInstall();
+    static void setStreamingInstall(bool value);
+
+    static bool parallelInstall();
+    static void setParallelInstall(bool value);
+
     static bool createLocalRepositoryFromBinary();
     static void setCreateLocalRepositoryFromBinary(bool create);
 
     static Component *componentByName(const QString &name, const QList<Component *> &components);
+    static Component *componentByName(const QString &name,
+        const QHash<QString, QList<Component *> > &index);
+    static QHash<QString, QList<Component *> > componentIndex(const QList<Component *> &components);
 
     bool fetchLocalPackagesTree();
     LocalPackagesHash localInstalledPackages();
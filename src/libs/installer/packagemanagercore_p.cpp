@@ -39,7 +39,9 @@
 #include "binarylayout.h"
 #include "component.h"
 #include "scriptengine.h"
+#include "componentinstallscheduler.h"
 #include "componentmodel.h"
+#include "downloadarchivesjob.h"
 #include "errors.h"
 #include "fileio.h"
 #include "remotefileengine.h"
@@ -58,6 +60,7 @@
 #include "kdselfrestarter.h"
 #include "kdupdaterfiledownloaderfactory.h"
 #include "kdupdaterupdateoperationfactory.h"
+#include "kdupdaterupdatesinfo_p.h"
 
 #include <productkeycheck.h>
 
@@ -240,7 +243,12 @@ PackageManagerCorePrivate::PackageManagerCorePrivate(PackageManagerCore *core, q
             continue;
         }
 
-        if (!op->fromXml(operation.xml)) {
+        if (!operation.data.isEmpty()) {
+            if (!op->fromBinary(operation.data)) {
+                qWarning() << "Failed to load binary record for operation:" << operation.name;
+                continue;
+            }
+        } else if (!op->fromXml(operation.xml)) {
             qWarning() << "Failed to load XML for operation:" << operation.name;
             continue;
         }
@@ -305,6 +313,12 @@ bool PackageManagerCorePrivate::isProcessRunning(const QString &name,
     return false;
 }
 
+/* static */
+bool PackageManagerCorePrivate::performOperation(Operation *operation, OperationType type)
+{
+    return runOperation(operation, type);
+}
+
 /* static */
 bool PackageManagerCorePrivate::performOperationThreaded(Operation *operation, OperationType type)
 {
@@ -378,6 +392,7 @@ bool PackageManagerCorePrivate::buildComponentTree(QHash<QString, Component*> &c
         }
 
         std::sort(m_rootComponents.begin(), m_rootComponents.end(), Component::SortingPriorityGreaterThan());
+        clearComponentIndex();
 
         storeCheckState();
 
@@ -451,6 +466,7 @@ void PackageManagerCorePrivate::clearAllComponentLists()
         toDelete << list.at(i).second;
     m_componentsToReplaceAllMode.clear();
     m_componentsToInstallCalculated = false;
+    clearComponentIndex();
 
     qDeleteAll(toDelete);
     cleanUpComponentEnvironment();
@@ -476,6 +492,7 @@ void PackageManagerCorePrivate::clearUpdaterComponentLists()
 
     m_componentsToReplaceUpdaterMode.clear();
     m_componentsToInstallCalculated = false;
+    clearComponentIndex();
 
     qDeleteAll(usedComponents);
     cleanUpComponentEnvironment();
@@ -491,6 +508,24 @@ QHash<QString, QPair<Component*, Component*> > &PackageManagerCorePrivate::compo
     return (!isUpdater()) ? m_componentsToReplaceAllMode : m_componentsToReplaceUpdaterMode;
 }
 
+void PackageManagerCorePrivate::clearComponentIndex()
+{
+    m_componentIndex.clear();
+}
+
+/*!
+    Returns the components relevant to the run mode indexed by name. The index is built on first
+    use and has to be cleared with clearComponentIndex() whenever the component lists change.
+*/
+const QHash<QString, QList<Component *> > &PackageManagerCorePrivate::componentIndex()
+{
+    if (m_componentIndex.isEmpty()) {
+        m_componentIndex = PackageManagerCore::componentIndex(m_core
+            ->components(PackageManagerCore::ComponentType::AllNoReplacements));
+    }
+    return m_componentIndex;
+}
+
 void PackageManagerCorePrivate::clearInstallerCalculator()
 {
     delete m_installerCalculator;
@@ -1066,19 +1101,19 @@ void PackageManagerCorePrivate::writeMaintenanceToolBinaryData(QFileDevice *outp
         QInstaller::appendData(output, input, segment.length());
     }
 
-    const qint64 operationsStart = output->pos();
-    QInstaller::appendInt64(output, performedOperations.count());
+    QList<OperationBlob> operations;
+    operations.reserve(performedOperations.count());
     foreach (Operation *operation, performedOperations) {
-        // the installer can't be put into XML, remove it first
+        // the installer can't be serialized, remove it first
         operation->clearValue(QLatin1String("installer"));
-
-        QInstaller::appendString(output, operation->name());
-        QInstaller::appendString(output, operation->toXml().toString());
+        operations.append(OperationBlob(operation->name(), operation->toBinary()));
 
         // for the ui not to get blocked
         qApp->processEvents();
     }
-    QInstaller::appendInt64(output, performedOperations.count());
+
+    const qint64 operationsStart = output->pos();
+    BinaryContent::writeOperations(output, operations);
     const qint64 operationsEnd = output->pos();
 
     // we don't save any component-indexes.
@@ -1468,11 +1503,20 @@ bool PackageManagerCorePrivate::runInstaller()
 
         const double downloadPartProgressSize = double(1) / double(3);
         double componentsInstallPartProgressSize = double(2) / double(3);
-        const int downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
 
-        // if there was no download we have the whole progress for installing components
-        if (!downloadedArchivesCount)
-            componentsInstallPartProgressSize = double(1);
+        // in streaming mode the archives are downloaded while the components get installed
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        if (PackageManagerCore::streamingInstall()) {
+            archivesJob.reset(startArchivesDownload(componentsToInstall, downloadPartProgressSize));
+            if (!archivesJob)
+                componentsInstallPartProgressSize = double(1);
+        } else {
+            const int downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+
+            // if there was no download we have the whole progress for installing components
+            if (!downloadedArchivesCount)
+                componentsInstallPartProgressSize = double(1);
+        }
 
         // Force an update on the components xml as the install dir might have changed.
         m_localPackageHub->setFileName(componentsXmlPath());
@@ -1488,8 +1532,28 @@ bool PackageManagerCorePrivate::runInstaller()
             + (PackageManagerCore::createLocalRepositoryFromBinary() ? 1 : 0);
         double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        if (PackageManagerCore::parallelInstall()) {
+            ComponentInstallScheduler scheduler(this, componentsToInstall);
+            scheduler.setArchivesJob(archivesJob.data());
+            scheduler.run(progressOperationSize, adminRightsGained);
+        } else {
+            int neededArchivesCount = 0;
+            foreach (Component *component, componentsToInstall) {
+                if (archivesJob) {
+                    // archives get registered in component order, so the archives of all
+                    // dependencies are available as well once the ones of this component are
+                    neededArchivesCount += component->downloadableArchives().count();
+                    waitForArchives(archivesJob.data(), neededArchivesCount);
+                }
+                installComponent(component, progressOperationSize, adminRightsGained);
+            }
+        }
+
+        if (archivesJob) {
+            if (!archivesJob->isFinished())
+                archivesJob->waitForFinished();
+            finishArchivesDownload(archivesJob.data());
+        }
 
         if (m_core->isOfflineOnly() && PackageManagerCore::createLocalRepositoryFromBinary()) {
             emit m_core->titleMessageChanged(tr("Creating local repository"));
@@ -1538,6 +1602,9 @@ bool PackageManagerCorePrivate::runInstaller()
             }
         }
 
+        // merge the journal written while installing the components
+        m_localPackageHub->writeToDisk();
+
         emit m_core->titleMessageChanged(tr("Creating Maintenance Tool"));
 
         writeMaintenanceTool(m_performedOperationsOld + m_performedOperationsCurrentSession);
@@ -1711,6 +1778,7 @@ bool PackageManagerCorePrivate::runPackageUpdater()
 
         foreach (Component *component, componentsToInstall)
             installComponent(component, progressOperationSize, adminRightsGained);
+        m_localPackageHub->writeToDisk();
 
         emit m_core->titleMessageChanged(tr("Creating Maintenance Tool"));
 
@@ -1818,6 +1886,29 @@ bool PackageManagerCorePrivate::runUninstaller()
 
 void PackageManagerCorePrivate::installComponent(Component *component, double progressOperationSize,
     bool adminRightsGained)
+{
+    const OperationList operations = beginComponentInstallation(component);
+
+    foreach (Operation *operation, operations) {
+        if (statusCanceledOrFailed())
+            throw Error(tr("Installation canceled by user"));
+
+        const bool becameAdmin = prepareOperation(operation, progressOperationSize, adminRightsGained);
+
+        // allow the operation to backup stuff before performing the operation
+        performOperationThreaded(operation, PackageManagerCorePrivate::Backup);
+
+        const bool ok = performOperationThreaded(operation);
+        finishOperation(component, operation, ok, becameAdmin);
+    }
+
+    finishComponentInstallation(component);
+}
+
+/*!
+    Announces the installation of \a component and returns the operations to perform for it.
+*/
+OperationList PackageManagerCorePrivate::beginComponentInstallation(Component *component)
 {
     const OperationList operations = component->operations();
     if (!component->operationsCreatedSuccessfully())
@@ -1829,61 +1920,76 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
             ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nInstalling component %1")
                 .arg(component->displayName()));
     }
+    return operations;
+}
 
-    foreach (Operation *operation, operations) {
-        if (statusCanceledOrFailed())
-            throw Error(tr("Installation canceled by user"));
-
-        // maybe this operations wants us to be admin...
-        bool becameAdmin = false;
-        if (!adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
-            becameAdmin = m_core->gainAdminRights();
-            qDebug() << operation->name() << "as admin:" << becameAdmin;
-        }
-
-        connectOperationToInstaller(operation, progressOperationSize);
-        connectOperationCallMethodRequest(operation);
+/*!
+    Gains admin rights if \a operation needs them and connects it to the installer. Returns \c true
+    if admin rights have been gained for this operation only.
+*/
+bool PackageManagerCorePrivate::prepareOperation(Operation *operation, double progressOperationSize,
+    bool adminRightsGained)
+{
+    // maybe this operations wants us to be admin...
+    bool becameAdmin = false;
+    if (!adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
+        becameAdmin = m_core->gainAdminRights();
+        qDebug() << operation->name() << "as admin:" << becameAdmin;
+    }
 
-        // allow the operation to backup stuff before performing the operation
-        performOperationThreaded(operation, PackageManagerCorePrivate::Backup);
+    connectOperationToInstaller(operation, progressOperationSize);
+    connectOperationCallMethodRequest(operation);
+    return becameAdmin;
+}
 
-        bool ignoreError = false;
-        bool ok = performOperationThreaded(operation);
-        while (!ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
-            qDebug() << QString::fromLatin1("Operation '%1' with arguments: '%2' failed: %3")
-                .arg(operation->name(), operation->arguments().join(QLatin1String("; ")),
-                operation->errorString());
-            const QMessageBox::StandardButton button =
-                MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
-                QLatin1String("installationErrorWithRetry"), tr("Installer Error"),
-                tr("Error during installation process (%1):\n%2").arg(component->name(),
-                operation->errorString()),
-                QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Retry);
-
-            if (button == QMessageBox::Retry)
-                ok = performOperationThreaded(operation);
-            else if (button == QMessageBox::Ignore)
-                ignoreError = true;
-            else if (button == QMessageBox::Cancel)
-                m_core->interrupt();
-        }
+/*!
+    Handles the result \a ok of the performed \a operation of \a component, asking the user how
+    to proceed if it failed. Throws if the installation cannot continue.
+*/
+void PackageManagerCorePrivate::finishOperation(Component *component, Operation *operation, bool ok,
+    bool becameAdmin)
+{
+    bool ignoreError = false;
+    while (!ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
+        qDebug() << QString::fromLatin1("Operation '%1' with arguments: '%2' failed: %3")
+            .arg(operation->name(), operation->arguments().join(QLatin1String("; ")),
+            operation->errorString());
+        const QMessageBox::StandardButton button =
+            MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
+            QLatin1String("installationErrorWithRetry"), tr("Installer Error"),
+            tr("Error during installation process (%1):\n%2").arg(component->name(),
+            operation->errorString()),
+            QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Retry);
+
+        if (button == QMessageBox::Retry)
+            ok = performOperationThreaded(operation);
+        else if (button == QMessageBox::Ignore)
+            ignoreError = true;
+        else if (button == QMessageBox::Cancel)
+            m_core->interrupt();
+    }
 
-        if (ok || operation->error() > Operation::InvalidArguments) {
-            // Remember that the operation was performed, that allows us to undo it if a following operation
-            // fails or if this operation failed but still needs an undo call to cleanup.
-            addPerformed(operation);
-        }
+    if (ok || operation->error() > Operation::InvalidArguments) {
+        // Remember that the operation was performed, that allows us to undo it if a following operation
+        // fails or if this operation failed but still needs an undo call to cleanup.
+        addPerformed(operation);
+    }
 
-        if (becameAdmin)
-            m_core->dropAdminRights();
+    if (becameAdmin)
+        m_core->dropAdminRights();
 
-        if (!ok && !ignoreError)
-            throw Error(operation->errorString());
+    if (!ok && !ignoreError)
+        throw Error(operation->errorString());
 
-        if (component->value(scEssential, scFalse) == scTrue)
-            m_needsHardRestart = true;
-    }
+    if (component->value(scEssential, scFalse) == scTrue)
+        m_needsHardRestart = true;
+}
 
+/*!
+    Registers \a component as installed once all its operations have been performed.
+*/
+void PackageManagerCorePrivate::finishComponentInstallation(Component *component)
+{
     registerPathsForUninstallation(component->pathsForUninstallation(), component->name());
 
     if (!component->stopProcessForUpdateRequests().isEmpty()) {
@@ -1901,12 +2007,94 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
         component->value(scDescription), component->dependencies(), component->forcedInstallation(),
         component->isVirtual(), component->value(scUncompressedSize).toULongLong(),
         component->value(scInheritVersion));
-    m_localPackageHub->writeToDisk();
+    m_localPackageHub->writeJournal();
 
     component->setInstalled();
     component->markAsPerformedInstallation();
 }
 
+/*!
+    Starts downloading the archives of \a components in the background and returns the running
+    job, or \c 0 if there is nothing to download. The archives are registered in the order of
+    \a components, so a component's archives are available after the ones of all components
+    listed before it.
+*/
+DownloadArchivesJob *PackageManagerCorePrivate::startArchivesDownload(const QList<Component*> &components,
+    double partProgressSize)
+{
+    QList<QPair<QString, QString> > archivesToDownload;
+    foreach (Component *component, components) {
+        // collect all archives to be downloaded
+        const QStringList toDownload = component->downloadableArchives();
+        foreach (const QString &versionFreeString, toDownload) {
+            archivesToDownload.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
+                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
+                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
+        }
+    }
+
+    if (archivesToDownload.isEmpty())
+        return 0;
+
+    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
+
+    // the component's meta data directory is part of the persistent cache, keep the archives out
+    const QString downloadDirectory = m_metadataJob.archivesDirectory();
+    if (downloadDirectory.isEmpty())
+        throw Error(tr("Could not create a temporary directory for the downloaded archives."));
+
+    DownloadArchivesJob *archivesJob = new DownloadArchivesJob(m_core);
+    archivesJob->setAutoDelete(false);
+    archivesJob->setDownloadDirectory(downloadDirectory);
+    archivesJob->setArchivesToDownload(archivesToDownload);
+    connect(m_core, SIGNAL(installationInterrupted()), archivesJob, SLOT(cancel()));
+    connect(archivesJob, SIGNAL(outputTextChanged(QString)), ProgressCoordinator::instance(),
+        SLOT(emitLabelAndDetailTextChanged(QString)));
+    connect(archivesJob, SIGNAL(downloadStatusChanged(QString)), ProgressCoordinator::instance(),
+        SIGNAL(downloadStatusChanged(QString)));
+
+    ProgressCoordinator::instance()->registerPartProgress(archivesJob,
+        SIGNAL(progressChanged(double)), partProgressSize);
+
+    archivesJob->start();
+    return archivesJob;
+}
+
+/*!
+    Blocks, while still processing events, until the first \a count archives of \a archivesJob
+    have been handled or the job has finished. Throws if the job finished with an error.
+*/
+void PackageManagerCorePrivate::waitForArchives(DownloadArchivesJob *archivesJob, int count)
+{
+    if (!archivesJob->isFinished() && archivesJob->numberOfHandledArchives() < count) {
+        QEventLoop loop;
+        loop.connect(archivesJob, SIGNAL(archivesHandled(int)), SLOT(quit()));
+        loop.connect(archivesJob, SIGNAL(finished(KDJob*)), SLOT(quit()));
+        while (!archivesJob->isFinished() && archivesJob->numberOfHandledArchives() < count)
+            loop.exec();
+    }
+
+    if (archivesJob->isFinished() && archivesJob->error() != KDJob::NoError)
+        finishArchivesDownload(archivesJob);
+}
+
+/*!
+    Evaluates the result of the finished \a archivesJob. Throws if the download failed or the
+    installation has been canceled meanwhile.
+*/
+void PackageManagerCorePrivate::finishArchivesDownload(DownloadArchivesJob *archivesJob)
+{
+    if (archivesJob->error() == KDJob::Canceled)
+        m_core->interrupt();
+    else if (archivesJob->error() != KDJob::NoError)
+        throw Error(archivesJob->errorString());
+
+    if (statusCanceledOrFailed())
+        throw Error(tr("Installation canceled by user"));
+
+    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
+}
+
 // -- private
 
 void PackageManagerCorePrivate::deleteMaintenanceTool()
@@ -2089,7 +2277,13 @@ PackagesList PackageManagerCorePrivate::remotePackages()
     m_updateFinder->setAutoDelete(false);
     m_updateFinder->setPackageSources(m_packageSources);
     m_updateFinder->setLocalPackageHub(m_localPackageHub);
+
+    // the finder reports either finished() or error() once all package sources are processed
+    QEventLoop loop;
+    loop.connect(m_updateFinder, SIGNAL(finished()), SLOT(quit()), Qt::QueuedConnection);
+    loop.connect(m_updateFinder, SIGNAL(error(int,QString)), SLOT(quit()), Qt::QueuedConnection);
     m_updateFinder->run();
+    loop.exec();
 
     if (m_updateFinder->updates().isEmpty()) {
         setStatus(PackageManagerCore::Failure, tr("Could not retrieve remote tree: %1.")
@@ -2196,30 +2390,18 @@ bool PackageManagerCorePrivate::addUpdateResourcesFromRepositories(bool parseChe
             continue;
 
         if (parseChecksum) {
-            const QString updatesXmlPath = data.directory + QLatin1String("/Updates.xml");
-            QFile updatesFile(updatesXmlPath);
-            try {
-                QInstaller::openForRead(&updatesFile);
-            } catch(const Error &e) {
-                qDebug() << "Error opening Updates.xml:" << e.message();
-                setStatus(PackageManagerCore::Failure, tr("Could not add temporary update source information."));
-                return false;
-            }
-
-            int line = 0;
-            int column = 0;
-            QString error;
-            QDomDocument doc;
-            if (!doc.setContent(&updatesFile, &error, &line, &column)) {
-                qDebug() << QString::fromLatin1("Parse error in file %4: %1 at line %2 col %3").arg(error,
-                    QString::number(line), QString::number(column), updatesFile.fileName());
+            // shares the document already parsed by the metadata job
+            KDUpdater::UpdatesInfo updatesInfo;
+            updatesInfo.setFileName(data.directory + QLatin1String("/Updates.xml"));
+            if (updatesInfo.error() == KDUpdater::UpdatesInfo::CouldNotReadUpdateInfoFileError
+                || updatesInfo.error() == KDUpdater::UpdatesInfo::InvalidXmlError) {
+                qDebug() << "Error reading Updates.xml:" << updatesInfo.errorString();
                 setStatus(PackageManagerCore::Failure, tr("Could not add temporary update source information."));
                 return false;
             }
 
-            const QDomNode checksum = doc.documentElement().firstChildElement(QLatin1String("Checksum"));
-            if (!checksum.isNull())
-                m_core->setTestChecksum(checksum.toElement().text().toLower() == scTrue);
+            if (!updatesInfo.checksum().isNull())
+                m_core->setTestChecksum(updatesInfo.checksum().toLower() == scTrue);
         }
         m_packageSources.insert(PackageSource(QUrl::fromLocalFile(data.directory), 1));
         ProductKeyCheck::instance()->addPackagesFromXml(data.directory + QLatin1String("/Updates.xml"));
@@ -59,6 +59,7 @@ namespace QInstaller {
 
 struct BinaryLayout;
 class Component;
+class DownloadArchivesJob;
 class ScriptEngine;
 class ComponentModel;
 class TempDirDeleter;
@@ -70,6 +71,7 @@ class PackageManagerCorePrivate : public QObject
 {
     Q_OBJECT
     friend class PackageManagerCore;
+    friend class ComponentInstallScheduler;
     Q_DISABLE_COPY(PackageManagerCorePrivate)
 
 public:
@@ -86,6 +88,8 @@ public:
 
     static bool isProcessRunning(const QString &name, const QList<ProcessInfo> &processes);
 
+    static bool performOperation(Operation *op, PackageManagerCorePrivate::OperationType type
+        = PackageManagerCorePrivate::Perform);
     static bool performOperationThreaded(Operation *op, PackageManagerCorePrivate::OperationType type
         = PackageManagerCorePrivate::Perform);
 
@@ -120,6 +124,9 @@ public:
     QList<Component*> &replacementDependencyComponents();
     QHash<QString, QPair<Component*, Component*> > &componentsToReplace();
 
+    void clearComponentIndex();
+    const QHash<QString, QList<Component *> > &componentIndex();
+
     void clearInstallerCalculator();
     InstallerCalculator *installerCalculator() const;
 
@@ -167,6 +174,15 @@ public:
 
     void installComponent(Component *component, double progressOperationSize,
         bool adminRightsGained = false);
+    OperationList beginComponentInstallation(Component *component);
+    bool prepareOperation(Operation *operation, double progressOperationSize, bool adminRightsGained);
+    void finishOperation(Component *component, Operation *operation, bool ok, bool becameAdmin);
+    void finishComponentInstallation(Component *component);
+
+    DownloadArchivesJob *startArchivesDownload(const QList<Component*> &components,
+        double partProgressSize);
+    void waitForArchives(DownloadArchivesJob *archivesJob, int count);
+    void finishArchivesDownload(DownloadArchivesJob *archivesJob);
 
 signals:
     void installationStarted();
@@ -199,6 +215,9 @@ public:
     QList<QInstaller::Component*> m_updaterComponentsDeps;
     QList<QInstaller::Component*> m_updaterDependencyReplacements;
 
+    // components by name, built on demand from the components relevant to the run mode
+    QHash<QString, QList<Component *> > m_componentIndex;
+
     OperationList m_ownedOperations;
     OperationList m_performedOperationsOld;
     OperationList m_performedOperationsCurrentSession;
@@ -40,11 +40,26 @@ namespace QInstaller {
 typedef qint32 PackageSize;
 
 /*!
-    Write a packet containing \a command and \a data to \a device.
+    Write a packet containing \a command and \a data to \a device and waits until all data
+    pending on \a device, including packets queued with queuePacket(), has been written.
 
     \note Both client and server need to have the same endianness.
  */
 void sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data)
+{
+    queuePacket(device, command, data);
+    // needed for big packages over TCP on Windows
+    device->waitForBytesWritten(-1);
+}
+
+/*!
+    Appends a packet containing \a command and \a data to the write buffer of \a device without
+    waiting for it to be written. Use this for commands that do not expect a reply, so that a
+    number of them can be sent in one go with the next call to sendPacket().
+
+    \note Both client and server need to have the same endianness.
+ */
+void queuePacket(QIODevice *device, const QByteArray &command, const QByteArray &data)
 {
     // use aliasing for writing payload size into bytes
     char payloadBytes[sizeof(PackageSize)];
@@ -65,8 +80,6 @@ void sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &
             break;
         packet.remove(0, bytesWritten);
     }
-    // needed for big packages over TCP on Windows
-    device->waitForBytesWritten(-1);
 }
 
 /*!
@@ -172,6 +172,7 @@ const char QAbstractFileEngineFileTime[] = "QAbstractFileEngine::fileTime";
 } // namespace Protocol
 
 void INSTALLER_EXPORT sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data);
+void INSTALLER_EXPORT queuePacket(QIODevice *device, const QByteArray &command, const QByteArray &data);
 bool INSTALLER_EXPORT receivePacket(QIODevice *device, QByteArray *command, QByteArray *data);
 
 } // namespace QInstaller
@@ -37,8 +37,14 @@
 #include "protocol.h"
 #include "remoteclient.h"
 
+#include <string.h>
+
 namespace QInstaller {
 
+// Writes are collected and reads are fetched ahead in chunks of this size, to keep the number of
+// round trips to the server low. Bigger requests are passed through as they are.
+static const qint64 scTransferWindow = 1024 * 1024;
+
 
 // -- RemoteFileEngineHandler
 
@@ -118,11 +124,66 @@ QString RemoteFileEngineIterator::currentFileName() const
 
 RemoteFileEngine::RemoteFileEngine()
     : RemoteObject(QLatin1String(Protocol::QAbstractFileEngine))
+    , m_readBufferPos(0)
+    , m_sequentialKnown(false)
+    , m_sequential(false)
 {
 }
 
 RemoteFileEngine::~RemoteFileEngine()
 {
+    if (isConnectedToServer())
+        flushWriteBuffer();
+}
+
+/*!
+    Sends the data collected by write() to the server. Returns \c false if not all of it could be
+    written.
+*/
+bool RemoteFileEngine::flushWriteBuffer()
+{
+    if (m_writeBuffer.isEmpty())
+        return true;
+
+    const qint64 written = callRemoteMethod<qint64>
+        (QString::fromLatin1(Protocol::QAbstractFileEngineWrite), m_writeBuffer);
+    const bool success = (written == m_writeBuffer.size());
+    m_writeBuffer.clear();
+    return success;
+}
+
+/*!
+    Drops the data fetched ahead by read(). If \a restorePosition is \c true, the file position
+    on the server is moved back to what has actually been consumed.
+*/
+bool RemoteFileEngine::discardReadBuffer(bool restorePosition)
+{
+    const qint64 unread = m_readBuffer.size() - m_readBufferPos;
+    m_readBuffer.clear();
+    m_readBufferPos = 0;
+
+    if (!restorePosition || unread <= 0)
+        return true;
+    const qint64 position = callRemoteMethod<qint64>
+        (QString::fromLatin1(Protocol::QAbstractFileEnginePos));
+    return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSeek),
+        position - unread);
+}
+
+/*!
+    Reads up to \a maxlen bytes into \a data on the server side. Returns the number of bytes read
+    or -1 on error.
+*/
+qint64 RemoteFileEngine::readRemote(char *data, qint64 maxlen)
+{
+    const QPair<qint64, QByteArray> result = callRemoteMethod<QPair<qint64, QByteArray> >
+        (QString::fromLatin1(Protocol::QAbstractFileEngineRead), maxlen);
+
+    if (result.first <= 0)
+        return result.first;
+
+    memcpy(data, result.second.constData(), size_t(result.first));
+    return result.first;
 }
 
 /*!
@@ -130,8 +191,13 @@ RemoteFileEngine::~RemoteFileEngine()
 */
 bool RemoteFileEngine::atEnd() const
 {
-    if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
+    RemoteFileEngine *const self = const_cast<RemoteFileEngine *>(this);
+    if (self->connectToServer()) {
+        if (m_readBufferPos < m_readBuffer.size())
+            return false;
+        self->flushWriteBuffer();
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineAtEnd));
+    }
     return m_fileEngine.atEnd();
 }
 
@@ -172,8 +238,13 @@ bool RemoteFileEngine::caseSensitive() const
 */
 bool RemoteFileEngine::close()
 {
-    if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineClose));
+    if (connectToServer()) {
+        discardReadBuffer(false);
+        const bool flushed = flushWriteBuffer();
+        const bool closed = callRemoteMethod<bool>
+            (QString::fromLatin1(Protocol::QAbstractFileEngineClose));
+        return flushed && closed;
+    }
     return m_fileEngine.close();
 }
 
@@ -182,8 +253,10 @@ bool RemoteFileEngine::close()
 */
 bool RemoteFileEngine::copy(const QString &newName)
 {
-    if (connectToServer())
+    if (connectToServer()) {
+        flushWriteBuffer();
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineCopy), newName);
+    }
     return m_fileEngine.copy(newName);
 }
 
@@ -262,8 +335,11 @@ QString RemoteFileEngine::fileName(FileName file) const
 */
 bool RemoteFileEngine::flush()
 {
-    if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineFlush));
+    if (connectToServer()) {
+        const bool flushed = flushWriteBuffer();
+        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineFlush))
+            && flushed;
+    }
     return m_fileEngine.flush();
 }
 
@@ -272,8 +348,10 @@ bool RemoteFileEngine::flush()
 */
 int RemoteFileEngine::handle() const
 {
+    // A handle of the server process is meaningless in this process, and passing it on to native
+    // calls (e.g. the kernel copy in blockingCopy()) would operate on an unrelated file.
     if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<qint32>(QString::fromLatin1(Protocol::QAbstractFileEngineHandle));
+        return -1;
     return m_fileEngine.handle();
 }
 
@@ -327,6 +405,7 @@ bool RemoteFileEngine::mkdir(const QString &dirName, bool createParentDirectorie
 bool RemoteFileEngine::open(QIODevice::OpenMode mode)
 {
     if (connectToServer()) {
+        m_sequentialKnown = false;
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineOpen),
             static_cast<qint32>(mode));
     }
@@ -362,8 +441,13 @@ uint RemoteFileEngine::ownerId(FileOwner owner) const
 */
 qint64 RemoteFileEngine::pos() const
 {
-    if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
-        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEnginePos));
+    RemoteFileEngine *const self = const_cast<RemoteFileEngine *>(this);
+    if (self->connectToServer()) {
+        self->flushWriteBuffer();
+        // the server is ahead by what has been fetched, but not read yet
+        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEnginePos))
+            - (m_readBuffer.size() - m_readBufferPos);
+    }
     return m_fileEngine.pos();
 }
 
@@ -372,8 +456,10 @@ qint64 RemoteFileEngine::pos() const
 */
 bool RemoteFileEngine::remove()
 {
-    if (connectToServer())
+    if (connectToServer()) {
+        flushWriteBuffer();
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineRemove));
+    }
     return m_fileEngine.remove();
 }
 
@@ -383,6 +469,7 @@ bool RemoteFileEngine::remove()
 bool RemoteFileEngine::rename(const QString &newName)
 {
     if (connectToServer()) {
+        flushWriteBuffer();
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineRename),
             newName);
     }
@@ -406,8 +493,12 @@ bool RemoteFileEngine::rmdir(const QString &dirName, bool recurseParentDirectori
 */
 bool RemoteFileEngine::seek(qint64 offset)
 {
-    if (connectToServer())
+    if (connectToServer()) {
+        discardReadBuffer(false);
+        if (!flushWriteBuffer())
+            return false;
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSeek), offset);
+    }
     return m_fileEngine.seek(offset);
 }
 
@@ -417,6 +508,9 @@ bool RemoteFileEngine::seek(qint64 offset)
 void RemoteFileEngine::setFileName(const QString &fileName)
 {
     if (connectToServer()) {
+        discardReadBuffer(false);
+        flushWriteBuffer();
+        m_sequentialKnown = false;
         callRemoteMethod(QString::fromLatin1(Protocol::QAbstractFileEngineSetFileName), fileName,
             dummy);
     }
@@ -441,6 +535,9 @@ bool RemoteFileEngine::setPermissions(uint perms)
 bool RemoteFileEngine::setSize(qint64 size)
 {
     if (connectToServer()) {
+        discardReadBuffer(true);
+        if (!flushWriteBuffer())
+            return false;
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSetSize),
             size);
     }
@@ -452,8 +549,11 @@ bool RemoteFileEngine::setSize(qint64 size)
 */
 qint64 RemoteFileEngine::size() const
 {
-    if ((const_cast<RemoteFileEngine *>(this))->connectToServer())
+    RemoteFileEngine *const self = const_cast<RemoteFileEngine *>(this);
+    if (self->connectToServer()) {
+        self->flushWriteBuffer();
         return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEngineSize));
+    }
     return m_fileEngine.size();
 }
 
@@ -473,15 +573,32 @@ bool RemoteFileEngine::supportsExtension(Extension extension) const
 qint64 RemoteFileEngine::read(char *data, qint64 maxlen)
 {
     if (connectToServer()) {
-        QPair<qint64, QByteArray> result = callRemoteMethod<QPair<qint64, QByteArray> >
-            (QString::fromLatin1(Protocol::QAbstractFileEngineRead), maxlen);
-
-        if (result.first <= 0)
-            return result.first;
-
-        QDataStream dataStream(result.second);
-        dataStream.readRawData(data, result.first);
-        return result.first;
+        if (!flushWriteBuffer())
+            return -1;
+
+        if (m_readBufferPos >= m_readBuffer.size()) {
+            if (!m_sequentialKnown) {
+                m_sequential = isSequential();
+                m_sequentialKnown = true;
+            }
+            // do not fetch ahead on sequential devices, the read might block
+            if (maxlen >= scTransferWindow || m_sequential)
+                return readRemote(data, maxlen);
+
+            m_readBuffer.resize(scTransferWindow);
+            m_readBufferPos = 0;
+            const qint64 bytesRead = readRemote(m_readBuffer.data(), scTransferWindow);
+            if (bytesRead <= 0) {
+                m_readBuffer.clear();
+                return bytesRead;
+            }
+            m_readBuffer.resize(bytesRead);
+        }
+
+        const qint64 length = qMin<qint64>(maxlen, m_readBuffer.size() - m_readBufferPos);
+        memcpy(data, m_readBuffer.constData() + m_readBufferPos, size_t(length));
+        m_readBufferPos += length;
+        return length;
     }
     return m_fileEngine.read(data, maxlen);
 }
@@ -492,6 +609,9 @@ qint64 RemoteFileEngine::read(char *data, qint64 maxlen)
 qint64 RemoteFileEngine::readLine(char *data, qint64 maxlen)
 {
     if (connectToServer()) {
+        if (!discardReadBuffer(true) || !flushWriteBuffer())
+            return -1;
+
         QPair<qint64, QByteArray> result = callRemoteMethod<QPair<qint64, QByteArray> >
             (QString::fromLatin1(Protocol::QAbstractFileEngineReadLine), maxlen);
 
@@ -511,22 +631,37 @@ qint64 RemoteFileEngine::readLine(char *data, qint64 maxlen)
 qint64 RemoteFileEngine::write(const char *data, qint64 len)
 {
     if (connectToServer()) {
-        QByteArray ba(data, len);
-        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEngineWrite), ba);
+        if (!discardReadBuffer(true))
+            return -1;
+
+        // Collect small writes and send them in one go, the result is reported by the write
+        // that sends the data, or by flush() and close().
+        if (m_writeBuffer.isEmpty() && len >= scTransferWindow) {
+            return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEngineWrite),
+                QByteArray::fromRawData(data, len));
+        }
+        m_writeBuffer.append(data, len);
+        if (m_writeBuffer.size() >= scTransferWindow && !flushWriteBuffer())
+            return -1;
+        return len;
     }
     return m_fileEngine.write(data, len);
 }
 
 bool RemoteFileEngine::syncToDisk()
 {
-    if (connectToServer())
+    if (connectToServer()) {
+        if (!flushWriteBuffer())
+            return false;
         return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineSyncToDisk));
+    }
     return m_fileEngine.syncToDisk();
 }
 
 bool RemoteFileEngine::renameOverwrite(const QString &newName)
 {
     if (connectToServer()) {
+        flushWriteBuffer();
         return callRemoteMethod<bool>
             (QString::fromLatin1(Protocol::QAbstractFileEngineRenameOverwrite), newName);
     }
@@ -104,8 +104,19 @@ public:
         ExtensionReturn *output = 0) Q_DECL_OVERRIDE;
     bool supportsExtension(Extension extension) const Q_DECL_OVERRIDE;
 
+private:
+    bool flushWriteBuffer();
+    bool discardReadBuffer(bool restorePosition);
+    qint64 readRemote(char *data, qint64 maxlen);
+
 private:
     QFSFileEngine m_fileEngine;
+
+    QByteArray m_writeBuffer;
+    QByteArray m_readBuffer;
+    qint64 m_readBufferPos;
+    bool m_sequentialKnown;
+    bool m_sequential;
 };
 
 } // namespace QInstaller
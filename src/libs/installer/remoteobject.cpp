@@ -121,7 +121,7 @@ bool RemoteObject::isConnectedToServer() const
 
 void RemoteObject::callRemoteMethod(const QString &name)
 {
-    writeData(name, dummy, dummy, dummy);
+    writeData(name, dummy, dummy, dummy, QueuedWrite);
 }
 
 } // namespace QInstaller
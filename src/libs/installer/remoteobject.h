@@ -58,16 +58,18 @@ public:
     bool isConnectedToServer() const;
     void callRemoteMethod(const QString &name);
 
+    // Methods without return value do not wait for the server, the calls are queued and sent
+    // together with the next call that expects a reply.
     template<typename T1, typename T2>
     void callRemoteMethod(const QString &name, const T1 &arg, const T2 &arg2)
     {
-        writeData(name, arg, arg2, dummy);
+        writeData(name, arg, arg2, dummy, QueuedWrite);
     }
 
     template<typename T1, typename T2, typename T3>
     void callRemoteMethod(const QString &name, const T1 &arg, const T2 &arg2, const T3 & arg3)
     {
-        writeData(name, arg, arg2, arg3);
+        writeData(name, arg, arg2, arg3, QueuedWrite);
     }
 
     template<typename T>
@@ -124,6 +126,11 @@ protected:
     struct Dummy {}; Dummy *dummy;
 
 private:
+    enum WriteMode {
+        BlockingWrite,
+        QueuedWrite
+    };
+
     template<typename T> bool isValueType(T) const
     {
         return true;
@@ -138,7 +145,8 @@ private:
     }
 
     template<typename T1, typename T2, typename T3>
-    void writeData(const QString &name, const T1 &arg, const T2 &arg2, const T3 &arg3) const
+    void writeData(const QString &name, const T1 &arg, const T2 &arg2, const T3 &arg3,
+        WriteMode mode = BlockingWrite) const
     {
         QByteArray data;
         QDataStream out(&data, QIODevice::WriteOnly);
@@ -150,7 +158,12 @@ private:
         if (isValueType(arg3))
             out << arg3;
 
-        sendPacket(m_socket, name.toLatin1(), data);
+        if (mode == QueuedWrite) {
+            queuePacket(m_socket, name.toLatin1(), data);
+            m_socket->flush();  // hand over what fits into the socket, but do not block
+        } else {
+            sendPacket(m_socket, name.toLatin1(), data);
+        }
     }
 
 private:
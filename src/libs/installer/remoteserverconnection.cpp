@@ -43,10 +43,139 @@
 
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QHash>
 #include <QLocalSocket>
 
 namespace QInstaller {
 
+namespace {
+
+// Maps the command names sent by the client to the commands dispatched by the server.
+class CommandTable
+{
+public:
+    CommandTable()
+    {
+#define INSERT_COMMAND(name) m_commands.insert(QByteArray(Protocol::name), RemoteCommand::name)
+        INSERT_COMMAND(Create);
+        INSERT_COMMAND(Destroy);
+        INSERT_COMMAND(Shutdown);
+        INSERT_COMMAND(Authorize);
+        INSERT_COMMAND(GetQProcessSignals);
+        INSERT_COMMAND(QProcessCloseWriteChannel);
+        INSERT_COMMAND(QProcessExitCode);
+        INSERT_COMMAND(QProcessExitStatus);
+        INSERT_COMMAND(QProcessKill);
+        INSERT_COMMAND(QProcessReadAll);
+        INSERT_COMMAND(QProcessReadAllStandardOutput);
+        INSERT_COMMAND(QProcessReadAllStandardError);
+        INSERT_COMMAND(QProcessStartDetached);
+        INSERT_COMMAND(QProcessSetWorkingDirectory);
+        INSERT_COMMAND(QProcessSetEnvironment);
+        INSERT_COMMAND(QProcessEnvironment);
+        INSERT_COMMAND(QProcessStart3Arg);
+        INSERT_COMMAND(QProcessStart2Arg);
+        INSERT_COMMAND(QProcessState);
+        INSERT_COMMAND(QProcessTerminate);
+        INSERT_COMMAND(QProcessWaitForFinished);
+        INSERT_COMMAND(QProcessWaitForStarted);
+        INSERT_COMMAND(QProcessWorkingDirectory);
+        INSERT_COMMAND(QProcessErrorString);
+        INSERT_COMMAND(QProcessReadChannel);
+        INSERT_COMMAND(QProcessSetReadChannel);
+        INSERT_COMMAND(QProcessWrite);
+        INSERT_COMMAND(QProcessProcessChannelMode);
+        INSERT_COMMAND(QProcessSetProcessChannelMode);
+        INSERT_COMMAND(QProcessSetNativeArguments);
+        INSERT_COMMAND(QSettingsAllKeys);
+        INSERT_COMMAND(QSettingsBeginGroup);
+        INSERT_COMMAND(QSettingsBeginWriteArray);
+        INSERT_COMMAND(QSettingsBeginReadArray);
+        INSERT_COMMAND(QSettingsChildGroups);
+        INSERT_COMMAND(QSettingsChildKeys);
+        INSERT_COMMAND(QSettingsClear);
+        INSERT_COMMAND(QSettingsContains);
+        INSERT_COMMAND(QSettingsEndArray);
+        INSERT_COMMAND(QSettingsEndGroup);
+        INSERT_COMMAND(QSettingsFallbacksEnabled);
+        INSERT_COMMAND(QSettingsFileName);
+        INSERT_COMMAND(QSettingsGroup);
+        INSERT_COMMAND(QSettingsIsWritable);
+        INSERT_COMMAND(QSettingsRemove);
+        INSERT_COMMAND(QSettingsSetArrayIndex);
+        INSERT_COMMAND(QSettingsSetFallbacksEnabled);
+        INSERT_COMMAND(QSettingsStatus);
+        INSERT_COMMAND(QSettingsSync);
+        INSERT_COMMAND(QSettingsSetValue);
+        INSERT_COMMAND(QSettingsValue);
+        INSERT_COMMAND(QSettingsOrganizationName);
+        INSERT_COMMAND(QSettingsApplicationName);
+        INSERT_COMMAND(QAbstractFileEngineAtEnd);
+        INSERT_COMMAND(QAbstractFileEngineCaseSensitive);
+        INSERT_COMMAND(QAbstractFileEngineClose);
+        INSERT_COMMAND(QAbstractFileEngineCopy);
+        INSERT_COMMAND(QAbstractFileEngineEntryList);
+        INSERT_COMMAND(QAbstractFileEngineError);
+        INSERT_COMMAND(QAbstractFileEngineErrorString);
+        INSERT_COMMAND(QAbstractFileEngineFileFlags);
+        INSERT_COMMAND(QAbstractFileEngineFileName);
+        INSERT_COMMAND(QAbstractFileEngineFlush);
+        INSERT_COMMAND(QAbstractFileEngineHandle);
+        INSERT_COMMAND(QAbstractFileEngineIsRelativePath);
+        INSERT_COMMAND(QAbstractFileEngineIsSequential);
+        INSERT_COMMAND(QAbstractFileEngineLink);
+        INSERT_COMMAND(QAbstractFileEngineMkdir);
+        INSERT_COMMAND(QAbstractFileEngineOpen);
+        INSERT_COMMAND(QAbstractFileEngineOwner);
+        INSERT_COMMAND(QAbstractFileEngineOwnerId);
+        INSERT_COMMAND(QAbstractFileEnginePos);
+        INSERT_COMMAND(QAbstractFileEngineRead);
+        INSERT_COMMAND(QAbstractFileEngineReadLine);
+        INSERT_COMMAND(QAbstractFileEngineRemove);
+        INSERT_COMMAND(QAbstractFileEngineRename);
+        INSERT_COMMAND(QAbstractFileEngineRmdir);
+        INSERT_COMMAND(QAbstractFileEngineSeek);
+        INSERT_COMMAND(QAbstractFileEngineSetFileName);
+        INSERT_COMMAND(QAbstractFileEngineSetPermissions);
+        INSERT_COMMAND(QAbstractFileEngineSetSize);
+        INSERT_COMMAND(QAbstractFileEngineSize);
+        INSERT_COMMAND(QAbstractFileEngineSupportsExtension);
+        INSERT_COMMAND(QAbstractFileEngineExtension);
+        INSERT_COMMAND(QAbstractFileEngineWrite);
+        INSERT_COMMAND(QAbstractFileEngineSyncToDisk);
+        INSERT_COMMAND(QAbstractFileEngineRenameOverwrite);
+        INSERT_COMMAND(QAbstractFileEngineFileTime);
+#undef INSERT_COMMAND
+    }
+
+    RemoteCommand command(const QByteArray &name) const
+    {
+        return m_commands.value(name, RemoteCommand::Unknown);
+    }
+
+private:
+    QHash<QByteArray, RemoteCommand> m_commands;
+};
+Q_GLOBAL_STATIC(CommandTable, commandTable)
+
+bool isQProcessCommand(RemoteCommand command)
+{
+    return command >= RemoteCommand::QProcessCloseWriteChannel && command <= RemoteCommand::QProcessSetNativeArguments;
+}
+
+bool isQSettingsCommand(RemoteCommand command)
+{
+    return command >= RemoteCommand::QSettingsAllKeys && command <= RemoteCommand::QSettingsApplicationName;
+}
+
+bool isQAbstractFileEngineCommand(RemoteCommand command)
+{
+    return command >= RemoteCommand::QAbstractFileEngineAtEnd
+        && command <= RemoteCommand::QAbstractFileEngineFileTime;
+}
+
+} // anon namespace
+
 RemoteServerConnection::RemoteServerConnection(qintptr socketDescriptor, const QString &key,
                                                QObject *parent)
     : QThread(parent)
@@ -86,7 +215,7 @@ void RemoteServerConnection::run()
             continue;
         }
 
-        const QString command = QString::fromLatin1(cmd);
+        const RemoteCommand command = commandTable()->command(cmd);
         QBuffer buf;
         buf.setBuffer(&data);
         buf.open(QIODevice::ReadOnly);
@@ -94,14 +223,14 @@ void RemoteServerConnection::run()
         stream.setDevice(&buf);
         StreamChecker streamChecker(&stream);
 
-        if (authorized && command == QLatin1String(Protocol::Shutdown)) {
+        if (authorized && command == RemoteCommand::Shutdown) {
             authorized = false;
             sendData(&socket, true);
             socket.flush();
             socket.close();
             emit shutdownRequested();
             return;
-        } else if (command == QLatin1String(Protocol::Authorize)) {
+        } else if (command == RemoteCommand::Authorize) {
             QString key;
             stream >> key;
             sendData(&socket, (authorized = (key == m_authorizationKey)));
@@ -111,10 +240,10 @@ void RemoteServerConnection::run()
                 return;
             }
         } else if (authorized) {
-            if (command.isEmpty())
+            if (cmd.isEmpty())
                 continue;
 
-            if (command == QLatin1String(Protocol::Create)) {
+            if (command == RemoteCommand::Create) {
                 QString type;
                 stream >> type;
                 if (type == QLatin1String(Protocol::QSettings)) {
@@ -145,23 +274,23 @@ void RemoteServerConnection::run()
                 continue;
             }
 
-            if (command == QLatin1String(Protocol::Destroy)) {
+            if (command == RemoteCommand::Destroy) {
                 QString type;
                 stream >> type;
                 if (type == QLatin1String(Protocol::QSettings)) {
                     settings.reset();
-                } else if (command == QLatin1String(Protocol::QProcess)) {
+                } else if (type == QLatin1String(Protocol::QProcess) && m_process) {
                     m_signalReceiver->m_receivedSignals.clear();
                     m_process->deleteLater();
                     m_process = 0;
-                } else if (command == QLatin1String(Protocol::QAbstractFileEngine)) {
+                } else if (type == QLatin1String(Protocol::QAbstractFileEngine)) {
                     delete m_engine;
                     m_engine = 0;
                 }
                 return;
             }
 
-            if (command == QLatin1String(Protocol::GetQProcessSignals)) {
+            if (command == RemoteCommand::GetQProcessSignals) {
                 if (m_signalReceiver) {
                     QMutexLocker _(&m_signalReceiver->m_lock);
                     sendData(&socket, m_signalReceiver->m_receivedSignals);
@@ -170,19 +299,19 @@ void RemoteServerConnection::run()
                 continue;
             }
 
-            if (command.startsWith(QLatin1String(Protocol::QProcess))) {
+            if (isQProcessCommand(command)) {
                 handleQProcess(&socket, command, stream);
-            } else if (command.startsWith(QLatin1String(Protocol::QSettings))) {
+            } else if (isQSettingsCommand(command)) {
                 handleQSettings(&socket, command, stream, settings.data());
-            } else if (command.startsWith(QLatin1String(Protocol::QAbstractFileEngine))) {
+            } else if (isQAbstractFileEngineCommand(command)) {
                 handleQFSFileEngine(&socket, command, stream);
             } else {
-                qDebug() << "Unknown command:" << command;
+                qDebug() << "Unknown command:" << cmd;
             }
         } else {
             // authorization failed, connection not wanted
             socket.close();
-            qDebug() << "Unknown command:" << command;
+            qDebug() << "Unknown command:" << cmd;
             return;
         }
     }
@@ -198,309 +327,441 @@ void RemoteServerConnection::sendData(QIODevice *device, const T &data)
     sendPacket(device, Protocol::Reply, result);
 }
 
-void RemoteServerConnection::handleQProcess(QIODevice *socket, const QString &command, QDataStream &data)
+void RemoteServerConnection::handleQProcess(QIODevice *socket, RemoteCommand command,
+                                            QDataStream &data)
 {
-    if (command == QLatin1String(Protocol::QProcessCloseWriteChannel)) {
-        m_process->closeWriteChannel();
-    } else if (command == QLatin1String(Protocol::QProcessExitCode)) {
-        sendData(socket, m_process->exitCode());
-    } else if (command == QLatin1String(Protocol::QProcessExitStatus)) {
-        sendData(socket, static_cast<qint32> (m_process->exitStatus()));
-    } else if (command == QLatin1String(Protocol::QProcessKill)) {
-        m_process->kill();
-    } else if (command == QLatin1String(Protocol::QProcessReadAll)) {
-        sendData(socket, m_process->readAll());
-    } else if (command == QLatin1String(Protocol::QProcessReadAllStandardOutput)) {
-        sendData(socket, m_process->readAllStandardOutput());
-    } else if (command == QLatin1String(Protocol::QProcessReadAllStandardError)) {
-        sendData(socket, m_process->readAllStandardError());
-    } else if (command == QLatin1String(Protocol::QProcessStartDetached)) {
-        QString program;
-        QStringList arguments;
-        QString workingDirectory;
-        data >> program;
-        data >> arguments;
-        data >> workingDirectory;
-
-        qint64 pid = -1;
-        bool success = QInstaller::startDetached(program, arguments, workingDirectory, &pid);
-        sendData(socket, qMakePair< bool, qint64>(success, pid));
-    } else if (command == QLatin1String(Protocol::QProcessSetWorkingDirectory)) {
-        QString dir;
-        data >> dir;
-        m_process->setWorkingDirectory(dir);
-    } else if (command == QLatin1String(Protocol::QProcessSetEnvironment)) {
-        QStringList env;
-        data >> env;
-        m_process->setEnvironment(env);
-    } else if (command == QLatin1String(Protocol::QProcessEnvironment)) {
-        sendData(socket, m_process->environment());
-    } else if (command == QLatin1String(Protocol::QProcessStart3Arg)) {
-        QString program;
-        QStringList arguments;
-        qint32 mode;
-        data >> program;
-        data >> arguments;
-        data >> mode;
-        m_process->start(program, arguments, static_cast<QIODevice::OpenMode> (mode));
-    } else if (command == QLatin1String(Protocol::QProcessStart2Arg)) {
-        QString program;
-        qint32 mode;
-        data >> program;
-        data >> mode;
-        m_process->start(program, static_cast<QIODevice::OpenMode> (mode));
-    } else if (command == QLatin1String(Protocol::QProcessState)) {
-        sendData(socket, static_cast<qint32> (m_process->state()));
-    } else if (command == QLatin1String(Protocol::QProcessTerminate)) {
-        m_process->terminate();
-    } else if (command == QLatin1String(Protocol::QProcessWaitForFinished)) {
-        qint32 msecs;
-        data >> msecs;
-        sendData(socket, m_process->waitForFinished(msecs));
-    } else if (command == QLatin1String(Protocol::QProcessWaitForStarted)) {
-        qint32 msecs;
-        data >> msecs;
-        sendData(socket, m_process->waitForStarted(msecs));
-    } else if (command == QLatin1String(Protocol::QProcessWorkingDirectory)) {
-        sendData(socket, m_process->workingDirectory());
-    } else if (command == QLatin1String(Protocol::QProcessErrorString)) {
-        sendData(socket, m_process->errorString());
-    } else if (command == QLatin1String(Protocol::QProcessReadChannel)) {
-        sendData(socket, static_cast<qint32> (m_process->readChannel()));
-    } else if (command == QLatin1String(Protocol::QProcessSetReadChannel)) {
-        qint32 processChannel;
-        data >> processChannel;
-        m_process->setReadChannel(static_cast<QProcess::ProcessChannel>(processChannel));
-    } else if (command == QLatin1String(Protocol::QProcessWrite)) {
-        QByteArray byteArray;
-        data >> byteArray;
-        sendData(socket, m_process->write(byteArray));
-    } else if (command == QLatin1String(Protocol::QProcessProcessChannelMode)) {
-        sendData(socket, static_cast<qint32> (m_process->processChannelMode()));
-    } else if (command == QLatin1String(Protocol::QProcessSetProcessChannelMode)) {
-        qint32 processChannel;
-        data >> processChannel;
-        m_process->setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannel));
-    }
+    switch (command) {
+        case RemoteCommand::QProcessCloseWriteChannel:
+            m_process->closeWriteChannel();
+            break;
+        case RemoteCommand::QProcessExitCode:
+            sendData(socket, m_process->exitCode());
+            break;
+        case RemoteCommand::QProcessExitStatus:
+            sendData(socket, static_cast<qint32> (m_process->exitStatus()));
+            break;
+        case RemoteCommand::QProcessKill:
+            m_process->kill();
+            break;
+        case RemoteCommand::QProcessReadAll:
+            sendData(socket, m_process->readAll());
+            break;
+        case RemoteCommand::QProcessReadAllStandardOutput:
+            sendData(socket, m_process->readAllStandardOutput());
+            break;
+        case RemoteCommand::QProcessReadAllStandardError:
+            sendData(socket, m_process->readAllStandardError());
+            break;
+        case RemoteCommand::QProcessStartDetached: {
+            QString program;
+            QStringList arguments;
+            QString workingDirectory;
+            data >> program;
+            data >> arguments;
+            data >> workingDirectory;
+
+            qint64 pid = -1;
+            bool success = QInstaller::startDetached(program, arguments, workingDirectory, &pid);
+            sendData(socket, qMakePair< bool, qint64>(success, pid));
+            break;
+        }
+        case RemoteCommand::QProcessSetWorkingDirectory: {
+            QString dir;
+            data >> dir;
+            m_process->setWorkingDirectory(dir);
+            break;
+        }
+        case RemoteCommand::QProcessSetEnvironment: {
+            QStringList env;
+            data >> env;
+            m_process->setEnvironment(env);
+            break;
+        }
+        case RemoteCommand::QProcessEnvironment:
+            sendData(socket, m_process->environment());
+            break;
+        case RemoteCommand::QProcessStart3Arg: {
+            QString program;
+            QStringList arguments;
+            qint32 mode;
+            data >> program;
+            data >> arguments;
+            data >> mode;
+            m_process->start(program, arguments, static_cast<QIODevice::OpenMode> (mode));
+            break;
+        }
+        case RemoteCommand::QProcessStart2Arg: {
+            QString program;
+            qint32 mode;
+            data >> program;
+            data >> mode;
+            m_process->start(program, static_cast<QIODevice::OpenMode> (mode));
+            break;
+        }
+        case RemoteCommand::QProcessState:
+            sendData(socket, static_cast<qint32> (m_process->state()));
+            break;
+        case RemoteCommand::QProcessTerminate:
+            m_process->terminate();
+            break;
+        case RemoteCommand::QProcessWaitForFinished: {
+            qint32 msecs;
+            data >> msecs;
+            sendData(socket, m_process->waitForFinished(msecs));
+            break;
+        }
+        case RemoteCommand::QProcessWaitForStarted: {
+            qint32 msecs;
+            data >> msecs;
+            sendData(socket, m_process->waitForStarted(msecs));
+            break;
+        }
+        case RemoteCommand::QProcessWorkingDirectory:
+            sendData(socket, m_process->workingDirectory());
+            break;
+        case RemoteCommand::QProcessErrorString:
+            sendData(socket, m_process->errorString());
+            break;
+        case RemoteCommand::QProcessReadChannel:
+            sendData(socket, static_cast<qint32> (m_process->readChannel()));
+            break;
+        case RemoteCommand::QProcessSetReadChannel: {
+            qint32 processChannel;
+            data >> processChannel;
+            m_process->setReadChannel(static_cast<QProcess::ProcessChannel>(processChannel));
+            break;
+        }
+        case RemoteCommand::QProcessWrite: {
+            QByteArray byteArray;
+            data >> byteArray;
+            sendData(socket, m_process->write(byteArray));
+            break;
+        }
+        case RemoteCommand::QProcessProcessChannelMode:
+            sendData(socket, static_cast<qint32> (m_process->processChannelMode()));
+            break;
+        case RemoteCommand::QProcessSetProcessChannelMode: {
+            qint32 processChannel;
+            data >> processChannel;
+            m_process->setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>
+                (processChannel));
+            break;
+        }
 #ifdef Q_OS_WIN
-    else if (command == QLatin1String(Protocol::QProcessSetNativeArguments)) {
-        QString arguments;
-        data >> arguments;
-        m_process->setNativeArguments(arguments);
-    }
+        case RemoteCommand::QProcessSetNativeArguments: {
+            QString arguments;
+            data >> arguments;
+            m_process->setNativeArguments(arguments);
+            break;
+        }
 #endif
-    else if (!command.isEmpty()) {
-        qDebug() << "Unknown QProcess command:" << command;
+        default:
+            qDebug() << "Unknown QProcess command:" << static_cast<int>(command);
+            break;
     }
 }
 
-void RemoteServerConnection::handleQSettings(QIODevice *socket, const QString &command,
+void RemoteServerConnection::handleQSettings(QIODevice *socket, RemoteCommand command,
                                              QDataStream &data, PermissionSettings *settings)
 {
     if (!settings)
         return;
 
-    if (command == QLatin1String(Protocol::QSettingsAllKeys)) {
-        sendData(socket, settings->allKeys());
-    } else if (command == QLatin1String(Protocol::QSettingsBeginGroup)) {
-        QString prefix;
-        data >> prefix;
-        settings->beginGroup(prefix);
-    } else if (command == QLatin1String(Protocol::QSettingsBeginWriteArray)) {
-        QString prefix;
-        data >> prefix;
-        qint32 size;
-        data >> size;
-        settings->beginWriteArray(prefix, size);
-    } else if (command == QLatin1String(Protocol::QSettingsBeginReadArray)) {
-        QString prefix;
-        data >> prefix;
-        sendData(socket, settings->beginReadArray(prefix));
-    } else if (command == QLatin1String(Protocol::QSettingsChildGroups)) {
-        sendData(socket, settings->childGroups());
-    } else if (command == QLatin1String(Protocol::QSettingsChildKeys)) {
-        sendData(socket, settings->childKeys());
-    } else if (command == QLatin1String(Protocol::QSettingsClear)) {
-        settings->clear();
-    } else if (command == QLatin1String(Protocol::QSettingsContains)) {
-        QString key;
-        data >> key;
-        sendData(socket, settings->contains(key));
-    } else if (command == QLatin1String(Protocol::QSettingsEndArray)) {
-        settings->endArray();
-    } else if (command == QLatin1String(Protocol::QSettingsEndGroup)) {
-        settings->endGroup();
-    } else if (command == QLatin1String(Protocol::QSettingsFallbacksEnabled)) {
-        sendData(socket, settings->fallbacksEnabled());
-    } else if (command == QLatin1String(Protocol::QSettingsFileName)) {
-        sendData(socket, settings->fileName());
-    } else if (command == QLatin1String(Protocol::QSettingsGroup)) {
-        sendData(socket, settings->group());
-    } else if (command == QLatin1String(Protocol::QSettingsIsWritable)) {
-        sendData(socket, settings->isWritable());
-    } else if (command == QLatin1String(Protocol::QSettingsRemove)) {
-        QString key;
-        data >> key;
-        settings->remove(key);
-    } else if (command == QLatin1String(Protocol::QSettingsSetArrayIndex)) {
-        qint32 i;
-        data >> i;
-        settings->setArrayIndex(i);
-    } else if (command == QLatin1String(Protocol::QSettingsSetFallbacksEnabled)) {
-        bool b;
-        data >> b;
-        settings->setFallbacksEnabled(b);
-    } else if (command == QLatin1String(Protocol::QSettingsStatus)) {
-        sendData(socket, settings->status());
-    } else if (command == QLatin1String(Protocol::QSettingsSync)) {
-        settings->sync();
-    } else if (command == QLatin1String(Protocol::QSettingsSetValue)) {
-        QString key;
-        QVariant value;
-        data >> key;
-        data >> value;
-        settings->setValue(key, value);
-    } else if (command == QLatin1String(Protocol::QSettingsValue)) {
-        QString key;
-        QVariant defaultValue;
-        data >> key;
-        data >> defaultValue;
-        sendData(socket, settings->value(key, defaultValue));
-    } else if (command == QLatin1String(Protocol::QSettingsOrganizationName)) {
-        sendData(socket, settings->organizationName());
-    } else if (command == QLatin1String(Protocol::QSettingsApplicationName)) {
-        sendData(socket, settings->applicationName());
-    } else if (!command.isEmpty()) {
-        qDebug() << "Unknown QSettings command:" << command;
+    switch (command) {
+        case RemoteCommand::QSettingsAllKeys:
+            sendData(socket, settings->allKeys());
+            break;
+        case RemoteCommand::QSettingsBeginGroup: {
+            QString prefix;
+            data >> prefix;
+            settings->beginGroup(prefix);
+            break;
+        }
+        case RemoteCommand::QSettingsBeginWriteArray: {
+            QString prefix;
+            data >> prefix;
+            qint32 size;
+            data >> size;
+            settings->beginWriteArray(prefix, size);
+            break;
+        }
+        case RemoteCommand::QSettingsBeginReadArray: {
+            QString prefix;
+            data >> prefix;
+            sendData(socket, settings->beginReadArray(prefix));
+            break;
+        }
+        case RemoteCommand::QSettingsChildGroups:
+            sendData(socket, settings->childGroups());
+            break;
+        case RemoteCommand::QSettingsChildKeys:
+            sendData(socket, settings->childKeys());
+            break;
+        case RemoteCommand::QSettingsClear:
+            settings->clear();
+            break;
+        case RemoteCommand::QSettingsContains: {
+            QString key;
+            data >> key;
+            sendData(socket, settings->contains(key));
+            break;
+        }
+        case RemoteCommand::QSettingsEndArray:
+            settings->endArray();
+            break;
+        case RemoteCommand::QSettingsEndGroup:
+            settings->endGroup();
+            break;
+        case RemoteCommand::QSettingsFallbacksEnabled:
+            sendData(socket, settings->fallbacksEnabled());
+            break;
+        case RemoteCommand::QSettingsFileName:
+            sendData(socket, settings->fileName());
+            break;
+        case RemoteCommand::QSettingsGroup:
+            sendData(socket, settings->group());
+            break;
+        case RemoteCommand::QSettingsIsWritable:
+            sendData(socket, settings->isWritable());
+            break;
+        case RemoteCommand::QSettingsRemove: {
+            QString key;
+            data >> key;
+            settings->remove(key);
+            break;
+        }
+        case RemoteCommand::QSettingsSetArrayIndex: {
+            qint32 i;
+            data >> i;
+            settings->setArrayIndex(i);
+            break;
+        }
+        case RemoteCommand::QSettingsSetFallbacksEnabled: {
+            bool b;
+            data >> b;
+            settings->setFallbacksEnabled(b);
+            break;
+        }
+        case RemoteCommand::QSettingsStatus:
+            sendData(socket, settings->status());
+            break;
+        case RemoteCommand::QSettingsSync:
+            settings->sync();
+            break;
+        case RemoteCommand::QSettingsSetValue: {
+            QString key;
+            QVariant value;
+            data >> key;
+            data >> value;
+            settings->setValue(key, value);
+            break;
+        }
+        case RemoteCommand::QSettingsValue: {
+            QString key;
+            QVariant defaultValue;
+            data >> key;
+            data >> defaultValue;
+            sendData(socket, settings->value(key, defaultValue));
+            break;
+        }
+        case RemoteCommand::QSettingsOrganizationName:
+            sendData(socket, settings->organizationName());
+            break;
+        case RemoteCommand::QSettingsApplicationName:
+            sendData(socket, settings->applicationName());
+            break;
+        default:
+            qDebug() << "Unknown QSettings command:" << static_cast<int>(command);
+            break;
     }
 }
 
-void RemoteServerConnection::handleQFSFileEngine(QIODevice *socket, const QString &command,
+void RemoteServerConnection::handleQFSFileEngine(QIODevice *socket, RemoteCommand command,
                                                  QDataStream &data)
 {
-    if (command == QLatin1String(Protocol::QAbstractFileEngineAtEnd)) {
-        sendData(socket, m_engine->atEnd());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineCaseSensitive)) {
-        sendData(socket, m_engine->caseSensitive());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineClose)) {
-        sendData(socket, m_engine->close());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineCopy)) {
-        QString newName;
-        data >>newName;
-        sendData(socket, m_engine->copy(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineEntryList)) {
-        qint32 filters;
-        QStringList filterNames;
-        data >>filters;
-        data >>filterNames;
-        sendData(socket, m_engine->entryList(static_cast<QDir::Filters> (filters), filterNames));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineError)) {
-        sendData(socket, static_cast<qint32> (m_engine->error()));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineErrorString)) {
-        sendData(socket, m_engine->errorString());
-    }
-    else if (command == QLatin1String(Protocol::QAbstractFileEngineFileFlags)) {
-        qint32 flags;
-        data >>flags;
-        flags = m_engine->fileFlags(static_cast<QAbstractFileEngine::FileFlags>(flags));
-        sendData(socket, static_cast<qint32>(flags));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFileName)) {
-        qint32 file;
-        data >>file;
-        sendData(socket, m_engine->fileName(static_cast<QAbstractFileEngine::FileName> (file)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFlush)) {
-        sendData(socket, m_engine->flush());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineHandle)) {
-        sendData(socket, m_engine->handle());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineIsRelativePath)) {
-        sendData(socket, m_engine->isRelativePath());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineIsSequential)) {
-        sendData(socket, m_engine->isSequential());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineLink)) {
-        QString newName;
-        data >>newName;
-        sendData(socket, m_engine->link(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineMkdir)) {
-        QString dirName;
-        bool createParentDirectories;
-        data >>dirName;
-        data >>createParentDirectories;
-        sendData(socket, m_engine->mkdir(dirName, createParentDirectories));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOpen)) {
-        qint32 openMode;
-        data >>openMode;
-        sendData(socket, m_engine->open(static_cast<QIODevice::OpenMode> (openMode)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOwner)) {
-        qint32 owner;
-        data >>owner;
-        sendData(socket, m_engine->owner(static_cast<QAbstractFileEngine::FileOwner> (owner)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOwnerId)) {
-        qint32 owner;
-        data >>owner;
-        sendData(socket, m_engine->ownerId(static_cast<QAbstractFileEngine::FileOwner> (owner)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEnginePos)) {
-        sendData(socket, m_engine->pos());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRead)) {
-        qint64 maxlen;
-        data >> maxlen;
-        QByteArray byteArray(maxlen, '\0');
-        const qint64 r = m_engine->read(byteArray.data(), maxlen);
-        sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineReadLine)) {
-        qint64 maxlen;
-        data >> maxlen;
-        QByteArray byteArray(maxlen, '\0');
-        const qint64 r = m_engine->readLine(byteArray.data(), maxlen);
-        sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRemove)) {
-        sendData(socket, m_engine->remove());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRename)) {
-        QString newName;
-        data >>newName;
-        sendData(socket, m_engine->rename(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRmdir)) {
-        QString dirName;
-        bool recurseParentDirectories;
-        data >>dirName;
-        data >>recurseParentDirectories;
-        sendData(socket, m_engine->rmdir(dirName, recurseParentDirectories));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSeek)) {
-        quint64 offset;
-        data >>offset;
-        sendData(socket, m_engine->seek(offset));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetFileName)) {
-        QString fileName;
-        data >>fileName;
-        m_engine->setFileName(fileName);
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetPermissions)) {
-        uint perms;
-        data >>perms;
-        sendData(socket, m_engine->setPermissions(perms));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetSize)) {
-        qint64 size;
-        data >>size;
-        sendData(socket, m_engine->setSize(size));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSize)) {
-        sendData(socket, m_engine->size());
-    } else if ((command == QLatin1String(Protocol::QAbstractFileEngineSupportsExtension))
-        || (command == QLatin1String(Protocol::QAbstractFileEngineExtension))) {
+    switch (command) {
+        case RemoteCommand::QAbstractFileEngineAtEnd:
+            sendData(socket, m_engine->atEnd());
+            break;
+        case RemoteCommand::QAbstractFileEngineCaseSensitive:
+            sendData(socket, m_engine->caseSensitive());
+            break;
+        case RemoteCommand::QAbstractFileEngineClose:
+            sendData(socket, m_engine->close());
+            break;
+        case RemoteCommand::QAbstractFileEngineCopy: {
+            QString newName;
+            data >>newName;
+            sendData(socket, m_engine->copy(newName));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineEntryList: {
+            qint32 filters;
+            QStringList filterNames;
+            data >>filters;
+            data >>filterNames;
+            sendData(socket, m_engine->entryList(static_cast<QDir::Filters> (filters),
+                filterNames));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineError:
+            sendData(socket, static_cast<qint32> (m_engine->error()));
+            break;
+        case RemoteCommand::QAbstractFileEngineErrorString:
+            sendData(socket, m_engine->errorString());
+            break;
+        case RemoteCommand::QAbstractFileEngineFileFlags: {
+            qint32 flags;
+            data >>flags;
+            flags = m_engine->fileFlags(static_cast<QAbstractFileEngine::FileFlags>(flags));
+            sendData(socket, static_cast<qint32>(flags));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineFileName: {
+            qint32 file;
+            data >>file;
+            sendData(socket, m_engine->fileName(static_cast<QAbstractFileEngine::FileName> (file)));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineFlush:
+            sendData(socket, m_engine->flush());
+            break;
+        case RemoteCommand::QAbstractFileEngineHandle:
+            sendData(socket, m_engine->handle());
+            break;
+        case RemoteCommand::QAbstractFileEngineIsRelativePath:
+            sendData(socket, m_engine->isRelativePath());
+            break;
+        case RemoteCommand::QAbstractFileEngineIsSequential:
+            sendData(socket, m_engine->isSequential());
+            break;
+        case RemoteCommand::QAbstractFileEngineLink: {
+            QString newName;
+            data >>newName;
+            sendData(socket, m_engine->link(newName));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineMkdir: {
+            QString dirName;
+            bool createParentDirectories;
+            data >>dirName;
+            data >>createParentDirectories;
+            sendData(socket, m_engine->mkdir(dirName, createParentDirectories));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineOpen: {
+            qint32 openMode;
+            data >>openMode;
+            sendData(socket, m_engine->open(static_cast<QIODevice::OpenMode> (openMode)));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineOwner: {
+            qint32 owner;
+            data >>owner;
+            sendData(socket, m_engine->owner(static_cast<QAbstractFileEngine::FileOwner> (owner)));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineOwnerId: {
+            qint32 owner;
+            data >>owner;
+            sendData(socket, m_engine->ownerId(static_cast<QAbstractFileEngine::FileOwner>
+                (owner)));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEnginePos:
+            sendData(socket, m_engine->pos());
+            break;
+        case RemoteCommand::QAbstractFileEngineRead: {
+            qint64 maxlen;
+            data >> maxlen;
+            QByteArray byteArray(maxlen, '\0');
+            const qint64 r = m_engine->read(byteArray.data(), maxlen);
+            byteArray.resize(qMax<qint64>(r, 0));   // do not send what has not been read
+            sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineReadLine: {
+            qint64 maxlen;
+            data >> maxlen;
+            QByteArray byteArray(maxlen, '\0');
+            const qint64 r = m_engine->readLine(byteArray.data(), maxlen);
+            byteArray.resize(qMax<qint64>(r, 0));   // do not send what has not been read
+            sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineRemove:
+            sendData(socket, m_engine->remove());
+            break;
+        case RemoteCommand::QAbstractFileEngineRename: {
+            QString newName;
+            data >>newName;
+            sendData(socket, m_engine->rename(newName));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineRmdir: {
+            QString dirName;
+            bool recurseParentDirectories;
+            data >>dirName;
+            data >>recurseParentDirectories;
+            sendData(socket, m_engine->rmdir(dirName, recurseParentDirectories));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineSeek: {
+            quint64 offset;
+            data >>offset;
+            sendData(socket, m_engine->seek(offset));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineSetFileName: {
+            QString fileName;
+            data >>fileName;
+            m_engine->setFileName(fileName);
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineSetPermissions: {
+            uint perms;
+            data >>perms;
+            sendData(socket, m_engine->setPermissions(perms));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineSetSize: {
+            qint64 size;
+            data >>size;
+            sendData(socket, m_engine->setSize(size));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineSize:
+            sendData(socket, m_engine->size());
+            break;
+        case RemoteCommand::QAbstractFileEngineSupportsExtension:
+        case RemoteCommand::QAbstractFileEngineExtension:
             // Implemented client side.
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineWrite)) {
-        QByteArray content;
-        data >> content;
-        sendData(socket, m_engine->write(content.data(), content.size()));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSyncToDisk)) {
-        sendData(socket, m_engine->syncToDisk());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRenameOverwrite)) {
-        QString newFilename;
-        data >> newFilename;
-        sendData(socket, m_engine->renameOverwrite(newFilename));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFileTime)) {
-        qint32 filetime;
-        data >> filetime;
-        sendData(socket, m_engine->fileTime(static_cast<QAbstractFileEngine::FileTime> (filetime)));
-    } else if (!command.isEmpty()) {
-        qDebug() << "Unknown QAbstractFileEngine command:" << command;
+            break;
+        case RemoteCommand::QAbstractFileEngineWrite: {
+            QByteArray content;
+            data >> content;
+            sendData(socket, m_engine->write(content.data(), content.size()));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineSyncToDisk:
+            sendData(socket, m_engine->syncToDisk());
+            break;
+        case RemoteCommand::QAbstractFileEngineRenameOverwrite: {
+            QString newFilename;
+            data >> newFilename;
+            sendData(socket, m_engine->renameOverwrite(newFilename));
+            break;
+        }
+        case RemoteCommand::QAbstractFileEngineFileTime: {
+            qint32 filetime;
+            data >> filetime;
+            sendData(socket, m_engine->fileTime(static_cast<QAbstractFileEngine::FileTime>
+                (filetime)));
+            break;
+        }
+        default:
+            qDebug() << "Unknown QAbstractFileEngine command:" << static_cast<int>(command);
+            break;
     }
 }
 
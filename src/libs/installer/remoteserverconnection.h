@@ -48,6 +48,7 @@ QT_END_NAMESPACE
 namespace QInstaller {
 
 class PermissionSettings;
+enum struct RemoteCommand;
 
 class QProcessSignalReceiver;
 
@@ -68,10 +69,10 @@ signals:
 private:
     template <typename T>
     void sendData(QIODevice *device, const T &arg);
-    void handleQProcess(QIODevice *device, const QString &command, QDataStream &data);
-    void handleQSettings(QIODevice *device, const QString &command, QDataStream &data,
+    void handleQProcess(QIODevice *device, RemoteCommand command, QDataStream &data);
+    void handleQSettings(QIODevice *device, RemoteCommand command, QDataStream &data,
                          PermissionSettings *settings);
-    void handleQFSFileEngine(QIODevice *device, const QString &command, QDataStream &data);
+    void handleQFSFileEngine(QIODevice *device, RemoteCommand command, QDataStream &data);
 
 private:
     qintptr m_socketDescriptor;
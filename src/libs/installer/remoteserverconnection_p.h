@@ -43,6 +43,103 @@
 
 namespace QInstaller {
 
+// Commands the server understands. The commands of each wrapped type are kept in one consecutive
+// block, the server relies on that to pick the handler.
+enum struct RemoteCommand {
+    Unknown,
+    Create,
+    Destroy,
+    Shutdown,
+    Authorize,
+    GetQProcessSignals,
+
+    QProcessCloseWriteChannel,
+    QProcessExitCode,
+    QProcessExitStatus,
+    QProcessKill,
+    QProcessReadAll,
+    QProcessReadAllStandardOutput,
+    QProcessReadAllStandardError,
+    QProcessStartDetached,
+    QProcessSetWorkingDirectory,
+    QProcessSetEnvironment,
+    QProcessEnvironment,
+    QProcessStart3Arg,
+    QProcessStart2Arg,
+    QProcessState,
+    QProcessTerminate,
+    QProcessWaitForFinished,
+    QProcessWaitForStarted,
+    QProcessWorkingDirectory,
+    QProcessErrorString,
+    QProcessReadChannel,
+    QProcessSetReadChannel,
+    QProcessWrite,
+    QProcessProcessChannelMode,
+    QProcessSetProcessChannelMode,
+    QProcessSetNativeArguments,
+
+    QSettingsAllKeys,
+    QSettingsBeginGroup,
+    QSettingsBeginWriteArray,
+    QSettingsBeginReadArray,
+    QSettingsChildGroups,
+    QSettingsChildKeys,
+    QSettingsClear,
+    QSettingsContains,
+    QSettingsEndArray,
+    QSettingsEndGroup,
+    QSettingsFallbacksEnabled,
+    QSettingsFileName,
+    QSettingsGroup,
+    QSettingsIsWritable,
+    QSettingsRemove,
+    QSettingsSetArrayIndex,
+    QSettingsSetFallbacksEnabled,
+    QSettingsStatus,
+    QSettingsSync,
+    QSettingsSetValue,
+    QSettingsValue,
+    QSettingsOrganizationName,
+    QSettingsApplicationName,
+
+    QAbstractFileEngineAtEnd,
+    QAbstractFileEngineCaseSensitive,
+    QAbstractFileEngineClose,
+    QAbstractFileEngineCopy,
+    QAbstractFileEngineEntryList,
+    QAbstractFileEngineError,
+    QAbstractFileEngineErrorString,
+    QAbstractFileEngineFileFlags,
+    QAbstractFileEngineFileName,
+    QAbstractFileEngineFlush,
+    QAbstractFileEngineHandle,
+    QAbstractFileEngineIsRelativePath,
+    QAbstractFileEngineIsSequential,
+    QAbstractFileEngineLink,
+    QAbstractFileEngineMkdir,
+    QAbstractFileEngineOpen,
+    QAbstractFileEngineOwner,
+    QAbstractFileEngineOwnerId,
+    QAbstractFileEnginePos,
+    QAbstractFileEngineRead,
+    QAbstractFileEngineReadLine,
+    QAbstractFileEngineRemove,
+    QAbstractFileEngineRename,
+    QAbstractFileEngineRmdir,
+    QAbstractFileEngineSeek,
+    QAbstractFileEngineSetFileName,
+    QAbstractFileEngineSetPermissions,
+    QAbstractFileEngineSetSize,
+    QAbstractFileEngineSize,
+    QAbstractFileEngineSupportsExtension,
+    QAbstractFileEngineExtension,
+    QAbstractFileEngineWrite,
+    QAbstractFileEngineSyncToDisk,
+    QAbstractFileEngineRenameOverwrite,
+    QAbstractFileEngineFileTime
+};
+
 class QProcessSignalReceiver : public QObject
 {
     Q_OBJECT
@@ -258,7 +258,8 @@ Settings Settings::fromFileAndPrefix(const QString &path, const QString &prefix,
                 << scWizardDefaultWidth << scWizardDefaultHeight
                 << scRepositorySettingsPageVisible << scTargetConfigurationFile
                 << scRemoteRepositories << scTranslations << QLatin1String(scControlScript)
-                << scCreateLocalRepository << scInstallActionColumnVisible;
+                << scCreateLocalRepository << scInstallActionColumnVisible
+                << scMaxConcurrentDownloads << scMaxConcurrentDownloadsPerHost;
 
     Settings s;
     s.d->m_data.insert(scPrefix, prefix);
@@ -327,6 +328,10 @@ Settings Settings::fromFileAndPrefix(const QString &path, const QString &prefix,
         s.d->m_data.insert(scCreateLocalRepository, false);
     if (!s.d->m_data.contains(scInstallActionColumnVisible))
         s.d->m_data.insert(scInstallActionColumnVisible, false);
+    if (s.d->m_data.value(scMaxConcurrentDownloads).toInt() <= 0)
+        s.d->m_data.insert(scMaxConcurrentDownloads, 6);
+    if (s.d->m_data.value(scMaxConcurrentDownloadsPerHost).toInt() <= 0)
+        s.d->m_data.insert(scMaxConcurrentDownloadsPerHost, 4);
 
     return s;
 }
@@ -486,6 +491,16 @@ bool Settings::installActionColumnVisible() const
     return d->m_data.value(scInstallActionColumnVisible, false).toBool();
 }
 
+int Settings::maxConcurrentDownloads() const
+{
+    return d->m_data.value(scMaxConcurrentDownloads, 6).toInt();
+}
+
+int Settings::maxConcurrentDownloadsPerHost() const
+{
+    return d->m_data.value(scMaxConcurrentDownloadsPerHost, 4).toInt();
+}
+
 bool Settings::allowSpaceInPath() const
 {
     return d->m_data.value(scAllowSpaceInPath, true).toBool();
@@ -114,6 +114,9 @@ public:
     bool createLocalRepository() const;
     bool installActionColumnVisible() const;
 
+    int maxConcurrentDownloads() const;
+    int maxConcurrentDownloadsPerHost() const;
+
     bool dependsOnLocalInstallerBinary() const;
     bool hasReplacementRepos() const;
     QSet<Repository> repositories() const;
@@ -44,7 +44,17 @@ namespace QInstaller {
 
 UninstallerCalculator::UninstallerCalculator(const QList<Component *> &installedComponents)
     : m_installedComponents(installedComponents)
+    , m_dependeeIndexCreated(false)
 {
+    // all names installed components provide, either by their name or by replacing a component
+    foreach (Component *component, m_installedComponents) {
+        m_installedNames.insert(component->name());
+        const QString replaces = component->value(scReplaces);
+        foreach (const QString &name, replaces.split(QInstaller::commaRegExp(),
+            QString::SkipEmptyParts)) {
+                m_installedNames.insert(name);
+        }
+    }
 }
 
 QSet<Component *> UninstallerCalculator::componentsToUninstall() const
@@ -60,10 +70,18 @@ void UninstallerCalculator::appendComponentToUninstall(Component *component)
     if (!component->isInstalled())
         return;
 
-    PackageManagerCore *core = component->packageManagerCore();
+    if (!m_dependeeIndexCreated)
+        createDependeeIndex(component->packageManagerCore());
+
     // remove all already resolved dependees
-    QSet<Component *> dependees = core->dependees(component).toSet()
-            .subtract(m_componentsToUninstall);
+    QSet<Component *> dependees;
+    foreach (const Dependee &dependee, m_dependees.value(component->name())) {
+        if (dependee.version.isEmpty() || PackageManagerCore::versionMatches(
+            component->value(scVersion), dependee.version)) {
+                dependees.insert(dependee.component);
+        }
+    }
+    dependees.subtract(m_componentsToUninstall);
 
     foreach (Component *dependee, dependees)
         appendComponentToUninstall(dependee);
@@ -71,6 +89,26 @@ void UninstallerCalculator::appendComponentToUninstall(Component *component)
     m_componentsToUninstall.insert(component);
 }
 
+void UninstallerCalculator::createDependeeIndex(PackageManagerCore *core)
+{
+    m_dependeeIndexCreated = true;
+
+    // index the dependencies of all available components by the name they depend on, the same
+    // components PackageManagerCore::dependees() looks at
+    const QLatin1Char dash('-');
+    foreach (Component *component, core->components(PackageManagerCore::ComponentType::All)) {
+        foreach (const QString &dependency, component->dependencies()) {
+            // the last part is considered to be the version then
+            const int index = dependency.indexOf(dash);
+            Dependee dependee;
+            dependee.component = component;
+            if (index >= 0)
+                dependee.version = dependency.mid(index + 1);
+            m_dependees[index >= 0 ? dependency.left(index) : dependency].append(dependee);
+        }
+    }
+}
+
 void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*> &components)
 {
     foreach (Component *component, components)
@@ -81,7 +119,7 @@ void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*>
     foreach (Component *component, m_installedComponents) {
         // If a components is installed and not yet scheduled for un-installation, check for auto depend.
         if (component->isInstalled() && !m_componentsToUninstall.contains(component)) {
-            QStringList autoDependencies = component->autoDependencies();
+            const QStringList autoDependencies = component->autoDependencies();
             if (autoDependencies.isEmpty())
                 continue;
 
@@ -101,17 +139,14 @@ void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*>
                 continue;
             }
 
-            foreach (Component *c, m_installedComponents) {
-                const QString replaces = c->value(scReplaces);
-                const QStringList possibleNames = replaces.split(QInstaller::commaRegExp(),
-                                                                 QString::SkipEmptyParts) << c->name();
-                foreach (const QString &possibleName, possibleNames)
-                    autoDependencies.removeAll(possibleName);
+            foreach (const QString &autoDependency, autoDependencies) {
+                // A component requested auto installation, keep it to resolve their dependencies
+                // as well.
+                if (!m_installedNames.contains(autoDependency)) {
+                    autoDependOnList.append(component);
+                    break;
+                }
             }
-
-            // A component requested auto installation, keep it to resolve their dependencies as well.
-            if (!autoDependencies.isEmpty())
-                autoDependOnList.append(component);
         }
     }
 
@@ -44,6 +44,7 @@
 namespace QInstaller {
 
 class Component;
+class PackageManagerCore;
 
 class INSTALLER_EXPORT UninstallerCalculator
 {
@@ -57,9 +58,19 @@ public:
 private:
 
     void appendComponentToUninstall(Component *component);
+    void createDependeeIndex(PackageManagerCore *core);
+
+    struct Dependee {
+        Component *component;
+        QString version;
+    };
 
     QList<Component *> m_installedComponents;
     QSet<Component *> m_componentsToUninstall;
+    bool m_dependeeIndexCreated;
+    // < name of the dependency, < components depending on it > >
+    QHash<QString, QList<Dependee> > m_dependees;
+    QSet<QString> m_installedNames;
 };
 
 }
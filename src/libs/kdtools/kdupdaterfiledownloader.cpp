@@ -46,6 +46,7 @@
 #include <QUrl>
 #include <QTemporaryFile>
 #include <QFileInfo>
+#include <QSettings>
 #include <QThreadPool>
 #include <QDebug>
 #include <QSslError>
@@ -379,6 +380,22 @@ void KDUpdater::FileDownloader::cancelDownload()
     // Do nothing
 }
 
+/*!
+    Pauses the file download. The default implementation does nothing, the download continues.
+*/
+void KDUpdater::FileDownloader::pauseDownload()
+{
+    // Do nothing
+}
+
+/*!
+    Resumes a file download paused with pauseDownload(). The default implementation does nothing.
+*/
+void KDUpdater::FileDownloader::resumeDownload()
+{
+    // Do nothing
+}
+
 /*!
     Starts the download speed timer.
 */
@@ -1036,6 +1053,11 @@ void KDUpdater::ResourceFileDownloader::onError()
     \brief The HttpDownloader class is used to download files over FTP, HTTP, or HTTPS.
 
     HTTPS is supported if Qt is built with SSL.
+
+    If the downloaded file name is set, an interrupted download can be continued. The validators
+    of the server response are kept in a state file next to the partial file, and the next
+    download of the same URL asks the server for the missing part only. The partial file is read
+    once to restore the checksum. Downloads can also be paused and resumed the same way.
 */
 struct KDUpdater::HttpDownloader::Private
 {
@@ -1045,6 +1067,9 @@ struct KDUpdater::HttpDownloader::Private
         , destination(0)
         , downloaded(false)
         , aborted(false)
+        , paused(false)
+        , resumeOffset(0)
+        , truncatePending(false)
         , m_authenticationCount(0)
     {}
 
@@ -1055,11 +1080,48 @@ struct KDUpdater::HttpDownloader::Private
     QString destFileName;
     bool downloaded;
     bool aborted;
+    bool paused;
+    qint64 resumeOffset;
+    bool truncatePending;
     int m_authenticationCount;
 
+    QString stateFileName() const
+    {
+        return destFileName + QLatin1String(".resume");
+    }
+
+    bool isRedirection() const
+    {
+        return q->followRedirects()
+            && http->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid();
+    }
+
+    bool isErrorResponse() const
+    {
+        return http->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 400;
+    }
+
+    void saveState()
+    {
+        QSettings state(stateFileName(), QSettings::IniFormat);
+        state.setValue(QLatin1String("Url"), q->url().toString());
+        state.setValue(QLatin1String("ETag"), http->rawHeader("ETag"));
+        state.setValue(QLatin1String("LastModified"), http->rawHeader("Last-Modified"));
+    }
+
+    void discardPartialData()
+    {
+        truncatePending = false;
+        destination->resize(0);
+        destination->seek(0);
+        q->resetCheckSumData();
+        if (!destFileName.isEmpty())
+            saveState();
+    }
+
     void shutDown()
     {
-        disconnect(http, SIGNAL(finished()), q, SLOT(httpReqFinished()));
+        http->disconnect(q);
         http->deleteLater();
         http = 0;
         destination->close();
@@ -1092,8 +1154,10 @@ KDUpdater::HttpDownloader::HttpDownloader(QObject *parent)
 */
 KDUpdater::HttpDownloader::~HttpDownloader()
 {
-    if (this->isAutoRemoveDownloadedFile() && !d->destFileName.isEmpty())
+    if (this->isAutoRemoveDownloadedFile() && !d->destFileName.isEmpty()) {
         QFile::remove(d->destFileName);
+        QFile::remove(d->stateFileName());
+    }
     delete d;
 }
 
@@ -1119,7 +1183,7 @@ void KDUpdater::HttpDownloader::doDownload()
     if (d->downloaded)
         return;
 
-    if (d->http)
+    if (d->http || d->paused)
         return;
 
     startDownload(url());
@@ -1151,8 +1215,51 @@ KDUpdater::HttpDownloader *KDUpdater::HttpDownloader::clone(QObject *parent) con
     return new HttpDownloader(parent);
 }
 
+/*!
+    Checks whether the server continues an interrupted download and remembers the validators of
+    the response, so that the download can be continued later on. If the server sends the whole
+    file instead, the partial file is dropped as soon as the new content arrives. Error responses
+    leave the partial file and its state untouched.
+*/
+void KDUpdater::HttpDownloader::httpMetaDataChanged()
+{
+    if (!d->http || !d->destination)
+        return;
+
+    if (d->isRedirection())
+        return;
+
+    const int status = d->http->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (d->isErrorResponse())
+        return; // reported by httpError(), the download can still be continued later on
+
+    if (d->resumeOffset > 0) {
+        if (status == 416) {
+            // the partial file does not match the server's file anymore
+            restartDownload(d->http->url());
+            return;
+        }
+        if (status == 200) {
+            // the file changed on the server, it gets sent completely
+            d->truncatePending = true;
+            d->resumeOffset = 0;
+        }
+    }
+
+    if (!d->destFileName.isEmpty() && status == 200 && !d->truncatePending)
+        d->saveState();
+}
+
 void KDUpdater::HttpDownloader::httpReadyRead()
 {
+    if (d->isRedirection() || d->isErrorResponse()) {
+        d->http->readAll(); // the body of a redirection or an error is not part of the file
+        return;
+    }
+
+    if (d->truncatePending && d->http->bytesAvailable() > 0)
+        d->discardPartialData();
+
     static QByteArray buffer(16384, '\0');
     while (d->http->bytesAvailable()) {
         const qint64 read = d->http->read(buffer.data(), buffer.size());
@@ -1189,7 +1296,51 @@ void KDUpdater::HttpDownloader::cancelDownload()
     if (d->http) {
         d->http->abort();
         httpDone(true);
+    } else if (d->paused) {
+        d->aborted = false;
+        d->paused = false;
+        setDownloadCanceled();
+    }
+}
+
+/*!
+    Pauses downloading the file. The connection to the server is closed, the data received so far
+    is kept and continued by resumeDownload().
+*/
+void KDUpdater::HttpDownloader::pauseDownload()
+{
+    if (d->downloaded || d->paused)
+        return;
+
+    d->paused = true;
+    if (!d->http)
+        return;
+
+    QTemporaryFile *file = qobject_cast<QTemporaryFile *>(d->destination);
+    if (file && !d->isRedirection()) {
+        // keep the partial file, the download continues in it
+        file->setAutoRemove(false);
+        d->destFileName = file->fileName();
+        d->saveState();
     }
+
+    httpReadyRead();
+    d->destination->flush();
+    d->shutDown();
+    stopDownloadSpeedTimer();
+    emit downloadStatus(tr("Download paused."));
+}
+
+/*!
+    Resumes downloading the file paused by pauseDownload().
+*/
+void KDUpdater::HttpDownloader::resumeDownload()
+{
+    if (!d->paused)
+        return;
+
+    d->paused = false;
+    doDownload();
 }
 
 void KDUpdater::HttpDownloader::httpDone(bool error)
@@ -1234,6 +1385,7 @@ void KDUpdater::HttpDownloader::onSuccess()
 {
     d->downloaded = true;
     d->destFileName = d->destination->fileName();
+    QFile::remove(d->stateFileName());
     if (QTemporaryFile *file = dynamic_cast<QTemporaryFile *>(d->destination))
         file->setAutoRemove(false);
     delete d->destination;
@@ -1255,6 +1407,8 @@ void KDUpdater::HttpDownloader::httpReqFinished()
             return;
 
         httpReadyRead();
+        if (d->truncatePending)
+            d->discardPartialData();  // the new file is empty
         d->destination->flush();
         setDownloadCompleted();
         d->http->deleteLater();
@@ -1270,6 +1424,11 @@ void KDUpdater::HttpDownloader::httpReadProgress(qint64 done, qint64 total)
             return; // if we are a redirection, do not emit the progress
     }
 
+    // a continued download only reports the missing part
+    done += d->resumeOffset;
+    if (total > 0)
+        total += d->resumeOffset;
+
     setProgress(done, total);
     emit downloadProgress(calcProgress(done, total));
 }
@@ -1291,8 +1450,28 @@ void KDUpdater::HttpDownloader::startDownload(const QUrl &url)
 {
     d->m_authenticationCount = 0;
     d->manager.setProxyFactory(proxyFactory());
-    d->http = d->manager.get(QNetworkRequest(url));
+    d->resumeOffset = 0;
+    d->truncatePending = false;
+
+    // continue a previously interrupted download of the same file if the server supports it
+    QNetworkRequest request(url);
+    if (!d->destFileName.isEmpty() && QFileInfo(d->destFileName).size() > 0) {
+        const QSettings state(d->stateFileName(), QSettings::IniFormat);
+        QByteArray validator = state.value(QLatin1String("ETag")).toByteArray();
+        if (validator.isEmpty() || validator.startsWith("W/"))  // weak validators do not work
+            validator = state.value(QLatin1String("LastModified")).toByteArray();
+
+        if (state.value(QLatin1String("Url")).toString() == this->url().toString()
+            && !validator.isEmpty()) {
+                d->resumeOffset = QFileInfo(d->destFileName).size();
+                request.setRawHeader("Range", "bytes=" + QByteArray::number(d->resumeOffset) + '-');
+                request.setRawHeader("If-Range", validator);
+        }
+    }
+
+    d->http = d->manager.get(request);
 
+    connect(d->http, SIGNAL(metaDataChanged()), this, SLOT(httpMetaDataChanged()));
     connect(d->http, SIGNAL(readyRead()), this, SLOT(httpReadyRead()));
     connect(d->http, SIGNAL(downloadProgress(qint64, qint64)), this,
         SLOT(httpReadProgress(qint64, qint64)));
@@ -1304,7 +1483,17 @@ void KDUpdater::HttpDownloader::startDownload(const QUrl &url)
         QTemporaryFile *file = new QTemporaryFile(this);
         file->open();
         d->destination = file;
+    } else if (d->resumeOffset > 0) {
+        d->destination = new QFile(d->destFileName, this);
+        if (d->destination->open(QIODevice::ReadWrite)) {
+            // restore the checksum of the data received so far
+            QByteArray buffer(16384, Qt::Uninitialized);
+            qint64 read = 0;
+            while ((read = d->destination->read(buffer.data(), buffer.size())) > 0)
+                addCheckSumData(buffer.constData(), read);
+        }
     } else {
+        QFile::remove(d->stateFileName());
         d->destination = new QFile(d->destFileName, this);
         d->destination->open(QIODevice::ReadWrite | QIODevice::Truncate);
     }
@@ -1318,6 +1507,17 @@ void KDUpdater::HttpDownloader::startDownload(const QUrl &url)
     }
 }
 
+/*!
+    Drops the partial file and downloads \a url again from the beginning.
+*/
+void KDUpdater::HttpDownloader::restartDownload(const QUrl &url)
+{
+    d->shutDown();
+    QFile::remove(d->stateFileName());
+    QFile::remove(d->destFileName);
+    startDownload(url);
+}
+
 void KDUpdater::HttpDownloader::onAuthenticationRequired(QNetworkReply *reply, QAuthenticator *authenticator)
 {
     Q_UNUSED(reply)
@@ -95,6 +95,8 @@ public:
 
 public Q_SLOTS:
     virtual void cancelDownload();
+    virtual void pauseDownload();
+    virtual void resumeDownload();
 
 protected:
     virtual void onError() = 0;
@@ -119,6 +119,8 @@ public:
 
 public Q_SLOTS:
     void cancelDownload();
+    void pauseDownload();
+    void resumeDownload();
 
 protected:
     void onError();
@@ -128,6 +130,7 @@ protected:
 private Q_SLOTS:
     void doDownload();
 
+    void httpMetaDataChanged();
     void httpReadyRead();
     void httpReadProgress(qint64 done, qint64 total);
     void httpError(QNetworkReply::NetworkError);
@@ -139,6 +142,7 @@ private Q_SLOTS:
 #endif
 private:
     void startDownload(const QUrl &url);
+    void restartDownload(const QUrl &url);
 
 private:
     struct Private;
@@ -43,8 +43,9 @@
 #include "fileutils.h"
 #include "globals.h"
 
-#include <QCoreApplication>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 
 using namespace KDUpdater;
 using namespace QInstaller;
@@ -58,11 +59,24 @@ using namespace QInstaller;
     application. The class basically processes the application's KDUpdater::PackagesInfo and the
     UpdateXMLs it aggregates from all the update sources and populates a list of KDUpdater::Update
     objects.
+
+    The search runs asynchronously once run() was called. The finished() signal is emitted as soon
+    as the list of updates is complete, error() if none of the update sources could be used.
 */
 
 //
 // Private
 //
+namespace {
+
+struct ParseResult
+{
+    QString errorString;
+    QList<UpdateInfo> updates;
+};
+
+} // namespace
+
 class UpdateFinder::Private
 {
 public:
@@ -76,6 +90,8 @@ public:
         : q(qq)
         , downloadCompleteCount(0)
         , m_downloadsToComplete(0)
+        , m_sourcesCompleteCount(0)
+        , m_validSourcesCount(0)
     {}
 
     ~Private()
@@ -85,32 +101,39 @@ public:
 
     struct Data {
         Data()
-            : downloader(0) {}
+            : downloader(0), watcher(0) {}
         Data(const PackageSource &i, FileDownloader *d = 0)
-            : info(i), downloader(d) {}
+            : info(i), downloader(d), watcher(0) {}
 
         PackageSource info;
         FileDownloader *downloader;
+        QFutureWatcher<ParseResult> *watcher;
     };
     UpdateFinder *q;
     QHash<QString, Update *> updates;
 
     // Temporary structure that notes down information about updates.
-    bool cancel;
     int downloadCompleteCount;
     int m_downloadsToComplete;
-    QHash<UpdatesInfo *, Data> m_updatesInfoList;
+    int m_sourcesCompleteCount;
+    int m_validSourcesCount;
+    QString m_applicationName;
+    QString m_lastError;
+    QList<Data> m_updateSources;
 
     void clear();
     void computeUpdates();
     void cancelComputeUpdates();
-    bool downloadUpdateXMLFiles();
-    bool computeApplicableUpdates();
+    void downloadUpdateXMLFiles();
+    void parseUpdateXMLFile(Data *data, const QString &fileName);
+    void sourceFailed(const QString &error);
+    void reportComputeProgress();
+    void finishComputeUpdates();
 
-    QList<UpdateInfo> applicableUpdates(UpdatesInfo *updatesInfo);
     void createUpdateObjects(const PackageSource &source, const QList<UpdateInfo> &updateInfoList);
     Resolution checkPriorityAndVersion(const PackageSource &source, const QVariantHash &data) const;
     void slotDownloadDone();
+    void slotParseDone();
 
     QSet<PackageSource> packageSources;
     std::weak_ptr<LocalPackageHub> m_localPackageHub;
@@ -127,6 +150,41 @@ static int computePercent(int done, int total)
     return total ? done * Q_INT64_C(100) / total : 0 ;
 }
 
+/*!
+   \internal
+
+   Parses the Updates.xml file \a fileName and returns the updates applicable to the application
+   called \a applicationName. Runs on a thread of the global thread pool, so it must not touch any
+   state of the update finder.
+*/
+static ParseResult parseUpdatesXml(const QString &fileName, const QString &applicationName)
+{
+    ParseResult result;
+    UpdatesInfo updatesInfo;
+    updatesInfo.setFileName(fileName);
+    if (!updatesInfo.isValid()) {
+        result.errorString = updatesInfo.errorString();
+        return result;
+    }
+
+    // Check to see if the updates info contains updates for any application
+    if (updatesInfo.applicationName() != QLatin1String("{AnyApplication}")) {
+        // updatesInfo.applicationName() describes one application or a series of
+        // application names separated by commas.
+        QString appName = updatesInfo.applicationName();
+        appName = appName.replace(QLatin1String( ", " ), QLatin1String( "," ));
+        appName = appName.replace(QLatin1String( " ," ), QLatin1String( "," ));
+
+        // Catch hold of app names contained updatesInfo.applicationName()
+        // If the application appName isn't one of the app names, then the updates are not applicable.
+        const QStringList apps = appName.split(QInstaller::commaRegExp(), QString::SkipEmptyParts);
+        if (apps.indexOf(applicationName) < 0)
+            return result;
+    }
+    result.updates = updatesInfo.updatesInfo();
+    return result;
+}
+
 /*!
    \internal
 
@@ -137,15 +195,25 @@ void UpdateFinder::Private::clear()
     qDeleteAll(updates);
     updates.clear();
 
-    const QList<Data> values = m_updatesInfoList.values();
-    foreach (const Data &data, values)
-        delete data.downloader;
-
-    qDeleteAll(m_updatesInfoList.keys());
-    m_updatesInfoList.clear();
+    // might be called from a slot connected to one of them, a still running parse just finishes
+    // without anybody listening
+    foreach (const Data &data, m_updateSources) {
+        if (data.watcher) {
+            QObject::disconnect(data.watcher, 0, q, 0);
+            data.watcher->deleteLater();
+        }
+        if (data.downloader) {
+            QObject::disconnect(data.downloader, 0, q, 0);
+            data.downloader->deleteLater();
+        }
+    }
+    m_updateSources.clear();
 
     downloadCompleteCount = 0;
     m_downloadsToComplete = 0;
+    m_sourcesCompleteCount = 0;
+    m_validSourcesCount = 0;
+    m_lastError.clear();
 }
 
 /*!
@@ -155,8 +223,10 @@ void UpdateFinder::Private::clear()
    studying the application's KDUpdater::PackagesInfo object and the UpdateXML files
    from each of the update sources described in QInstaller::PackageSource.
 
-   This function can take a long time to complete. The following signals are emitted
-   during the execution of this function
+   The computation is asynchronous. Each Updates.xml file is parsed on the global thread pool as
+   soon as it is available, the applicable updates of a source are merged in once its parse has
+   finished. The task reports finished() once all sources are done, or error() if none of them
+   provided a valid Updates.xml file.
 
    The function creates KDUpdater::Update objects on the stack. All KDUpdater::Update objects
    are made children of the application associated with this finder.
@@ -170,12 +240,7 @@ void UpdateFinder::Private::clear()
 */
 void UpdateFinder::Private::computeUpdates()
 {
-    // Computing updates is done in two stages
-    // 1. Downloading Update XML files from all the update sources
-    // 2. Matching updates with Package XML and figuring out available updates
-
     clear();
-    cancel = false;
 
     // First do some quick sanity checks on the packages info
     std::shared_ptr<LocalPackageHub> packages = m_localPackageHub.lock();
@@ -195,35 +260,24 @@ void UpdateFinder::Private::computeUpdates()
         return;
     }
 
-    // Now we can start...
-
-    // Step 1: 0 - 49 percent
-    if (!downloadUpdateXMLFiles() || cancel) {
-        clear();
-        return;
-    }
+    // the parser threads must not access the package hub
+    m_applicationName = packages->applicationName();
 
-    // Step 2: 50 - 100 percent
-    if (!computeApplicableUpdates() || cancel) {
-        clear();
-        return;
-    }
-
-    // All done
-    q->reportProgress(100, tr("%n update(s) found.", "", updates.count()));
-    q->reportDone();
+    // Now we can start...
+    downloadUpdateXMLFiles();
 }
 
 /*!
    \internal
 
-   Cancels the computation of updates.
+   Cancels the computation of updates. Pending downloads are canceled and the results of parses
+   still running are discarded.
 
    \sa computeUpdates()
 */
 void UpdateFinder::Private::cancelComputeUpdates()
 {
-    cancel = true;
+    clear();
 }
 
 /*!
@@ -234,17 +288,15 @@ void UpdateFinder::Private::cancelComputeUpdates()
    asynchronous in downloading updates from different sources.
 
    The function basically does this for each update source:
-   a) Create a KDUpdater::FileDownloader and KDUpdater::UpdatesInfo for each update
+   a) Create a KDUpdater::FileDownloader for each update source that is not a local file
    b) Triggers the download of Updates.xml from each file downloader.
    c) The downloadCompleted(), downloadCanceled() and downloadAborted() signals are connected
-   in each of the downloaders. Once all the downloads are complete and/or aborted, the next stage
-   would be done.
+   in each of the downloaders. Every downloaded file is parsed right away.
 
-   The function gets into an event loop until all the downloads are complete.
+   Local files and resources are handed to the parser immediately.
 */
-bool UpdateFinder::Private::downloadUpdateXMLFiles()
+void UpdateFinder::Private::downloadUpdateXMLFiles()
 {
-    // create UpdatesInfo for each update source
     foreach (const PackageSource &info, packageSources) {
         const QUrl url = QString::fromLatin1("%1/Updates.xml").arg(info.url.toString());
         if (url.scheme() != QLatin1String("resource") && url.scheme() != QLatin1String("file")) {
@@ -258,133 +310,90 @@ bool UpdateFinder::Private::downloadUpdateXMLFiles()
             connect(downloader, SIGNAL(downloadCanceled()), q, SLOT(slotDownloadDone()));
             connect(downloader, SIGNAL(downloadCompleted()), q, SLOT(slotDownloadDone()));
             connect(downloader, SIGNAL(downloadAborted(QString)), q, SLOT(slotDownloadDone()));
-            m_updatesInfoList.insert(new UpdatesInfo, Data(info, downloader));
+            m_updateSources.append(Data(info, downloader));
+            ++m_downloadsToComplete;
         } else {
-            UpdatesInfo *updatesInfo = new UpdatesInfo;
-            updatesInfo->setFileName(QInstaller::pathFromUrl(url));
-            m_updatesInfoList.insert(updatesInfo, Data(info));
+            m_updateSources.append(Data(info));
         }
     }
 
-    // Trigger download of Updates.xml file
-    downloadCompleteCount = 0;
-    m_downloadsToComplete = 0;
-    foreach (const Data &data, m_updatesInfoList) {
-        if (data.downloader) {
-            m_downloadsToComplete++;
-            data.downloader->download();
-        }
-    }
-
-    // Wait until all downloaders have completed their downloads.
-    while (true) {
-        QCoreApplication::processEvents();
-        if (cancel)
-            return false;
-
-        if (downloadCompleteCount == m_downloadsToComplete)
-            break;
-
-        q->reportProgress(computePercent(downloadCompleteCount, m_downloadsToComplete),
-            tr("Downloading Updates.xml from update sources."));
+    if (m_updateSources.isEmpty()) {
+        finishComputeUpdates();
+        return;
     }
 
-    // Setup the update info objects with the files from download.
-    foreach (UpdatesInfo *updatesInfo, m_updatesInfoList.keys()) {
-        const Data data = m_updatesInfoList.value(updatesInfo);
+    // Trigger download of Updates.xml file, or start parsing right away
+    for (int i = 0; i < m_updateSources.count(); ++i) {
+        Data &data = m_updateSources[i];
         if (data.downloader) {
-            if (!data.downloader->isDownloaded()) {
-                q->reportError(tr("Could not download package source %1 from ('%2')").arg(data
-                    .downloader->url().fileName(), data.info.url.toString()));
-            } else {
-                updatesInfo->setFileName(data.downloader->downloadedFileName());
-            }
+            data.downloader->download();
+        } else {
+            parseUpdateXMLFile(&data, QInstaller::pathFromUrl(QString::fromLatin1("%1/Updates.xml")
+                .arg(data.info.url.toString())));
         }
     }
-
-    // Remove all invalid update info objects.
-    QMutableHashIterator<UpdatesInfo *, Data> it(m_updatesInfoList);
-    while (it.hasNext()) {
-        UpdatesInfo *info = it.next().key();
-        if (info->isValid())
-            continue;
-
-        q->reportError(info->errorString());
-        delete info;
-        it.remove();
-    }
-
-    if (m_updatesInfoList.isEmpty())
-        return false;
-
-    q->reportProgress(49, tr("Updates.xml file(s) downloaded from update sources."));
-    return true;
 }
 
 /*!
    \internal
 
-   This function runs through all the KDUpdater::UpdatesInfo objects created during
-   the downloadUpdateXMLFiles() method and compares it with the data contained in
-   KDUpdater::PackagesInfo. Thereby figures out whether an update is applicable for
-   this application or not.
+   Starts parsing \a fileName for the update source described by \a data on the global thread
+   pool.
 */
-bool UpdateFinder::Private::computeApplicableUpdates()
+void UpdateFinder::Private::parseUpdateXMLFile(Data *data, const QString &fileName)
 {
-    int i = 0;
-    foreach (UpdatesInfo *updatesInfo, m_updatesInfoList.keys()) {
-        // Fetch updates applicable to this application.
-        QList<UpdateInfo> updates = applicableUpdates(updatesInfo);
-        if (!updates.count())
-            continue;
-
-        if (cancel)
-            return false;
-        const PackageSource updateSource = m_updatesInfoList.value(updatesInfo).info;
-
-        // Create Update objects for updates that have a valid
-        // UpdateFile
-        createUpdateObjects(updateSource, updates);
-        if (cancel)
-            return false;
+    data->watcher = new QFutureWatcher<ParseResult>(q);
+    connect(data->watcher, SIGNAL(finished()), q, SLOT(slotParseDone()));
+    data->watcher->setFuture(QtConcurrent::run(parseUpdatesXml, fileName, m_applicationName));
+}
 
-        // Report progress
-        q->reportProgress(computeProgressPercentage(51, 100, computePercent(i,
-            m_updatesInfoList.count())), tr("Computing applicable updates."));
-        ++i;
-    }
+/*!
+   \internal
 
-    q->reportProgress(99, tr("Application updates computed."));
-    return true;
+   Marks the current update source as done without providing any updates. The error is kept
+   and reported in case none of the update sources is usable.
+*/
+void UpdateFinder::Private::sourceFailed(const QString &error)
+{
+    qDebug() << error;
+    m_lastError = error;
+    ++m_sourcesCompleteCount;
 }
 
-QList<UpdateInfo> UpdateFinder::Private::applicableUpdates(UpdatesInfo *updatesInfo)
+/*!
+   \internal
+*/
+void UpdateFinder::Private::reportComputeProgress()
 {
-    const QList<UpdateInfo> dummy;
-    if (!updatesInfo || updatesInfo->updateInfoCount() == 0)
-        return dummy;
+    // downloads and parses of all sources, one step each
+    const int pc = computePercent(downloadCompleteCount + m_sourcesCompleteCount,
+        m_downloadsToComplete + m_updateSources.count());
+    q->reportProgress(computeProgressPercentage(0, 99, pc),
+        downloadCompleteCount < m_downloadsToComplete
+            ? tr("Downloading Updates.xml from update sources.")
+            : tr("Computing applicable updates."));
+}
 
-    std::shared_ptr<LocalPackageHub> packages = m_localPackageHub.lock();
-    if (!packages)
-        return dummy;
+/*!
+   \internal
 
-    // Check to see if the updates info contains updates for any application
-    if (updatesInfo->applicationName() != QLatin1String("{AnyApplication}")) {
-        // updatesInfo->applicationName() describes one application or a series of
-        // application names separated by commas.
-        QString appName = updatesInfo->applicationName();
-        appName = appName.replace(QLatin1String( ", " ), QLatin1String( "," ));
-        appName = appName.replace(QLatin1String( " ," ), QLatin1String( "," ));
+   Finishes the task once every update source has either failed or been parsed.
+*/
+void UpdateFinder::Private::finishComputeUpdates()
+{
+    if (m_sourcesCompleteCount < m_updateSources.count())
+        return;
 
-        // Catch hold of app names contained updatesInfo->applicationName()
-        // If the application appName isn't one of the app names, then the updates are not applicable.
-        const QStringList apps = appName.split(QInstaller::commaRegExp(), QString::SkipEmptyParts);
-        if (apps.indexOf([&packages] { return packages->isValid() ? packages->applicationName()
-                : QCoreApplication::applicationName(); } ()) < 0) {
-            return dummy;
-        }
+    if (m_validSourcesCount == 0) {
+        const QString error = m_lastError;
+        clear();
+        q->reportError(error);
+        return;
     }
-    return updatesInfo->updatesInfo();
+
+    // All done
+    q->reportProgress(100, tr("%n update(s) found.", "", updates.count()));
+    q->reportDone();
 }
 
 void UpdateFinder::Private::createUpdateObjects(const PackageSource &source,
@@ -505,10 +514,6 @@ void UpdateFinder::doRun()
 bool UpdateFinder::doStop()
 {
     d->cancelComputeUpdates();
-
-    // Wait until the cancel has actually happened, and then return.
-    // Thinking of using QMutex for this. Frank/Till any suggestions?
-
     return true;
 }
 
@@ -539,11 +544,51 @@ bool UpdateFinder::doResume()
 */
 void UpdateFinder::Private::slotDownloadDone()
 {
-    ++downloadCompleteCount;
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(q->sender());
+    for (int i = 0; i < m_updateSources.count(); ++i) {
+        Data &data = m_updateSources[i];
+        if (data.downloader != downloader)
+            continue;
+
+        ++downloadCompleteCount;
+        if (!downloader->isDownloaded()) {
+            sourceFailed(tr("Could not download package source %1 from ('%2')").arg(downloader
+                ->url().fileName(), data.info.url.toString()));
+        } else {
+            parseUpdateXMLFile(&data, downloader->downloadedFileName());
+        }
+        break;
+    }
+
+    reportComputeProgress();
+    finishComputeUpdates();
+}
+
+/*!
+   \internal
+*/
+void UpdateFinder::Private::slotParseDone()
+{
+    QObject *const watcher = q->sender();
+    for (int i = 0; i < m_updateSources.count(); ++i) {
+        const Data &data = m_updateSources.at(i);
+        if (data.watcher != watcher)
+            continue;
+
+        const ParseResult result = data.watcher->result();
+        if (!result.errorString.isEmpty()) {
+            sourceFailed(result.errorString);
+        } else {
+            // Create Update objects for updates that have a valid UpdateFile
+            createUpdateObjects(data.info, result.updates);
+            ++m_validSourcesCount;
+            ++m_sourcesCompleteCount;
+        }
+        break;
+    }
 
-    int pc = computePercent(downloadCompleteCount, m_downloadsToComplete);
-    pc = computeProgressPercentage(0, 45, pc);
-    q->reportProgress( pc, tr("Downloading Updates.xml from update sources.") );
+    reportComputeProgress();
+    finishComputeUpdates();
 }
 
 
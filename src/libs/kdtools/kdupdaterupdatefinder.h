@@ -69,6 +69,7 @@ private:
 private:
     Private *d;
     Q_PRIVATE_SLOT(d, void slotDownloadDone())
+    Q_PRIVATE_SLOT(d, void slotParseDone())
 };
 
 } // namespace KDUpdater
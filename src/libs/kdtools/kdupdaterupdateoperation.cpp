@@ -489,3 +489,41 @@ bool UpdateOperation::fromXml(const QString &xml)
     }
     return fromXml(doc);
 }
+
+/*!
+    Saves operation arguments and values into a compact binary record and returns it. Unlike
+    toXml(), list values are streamed as is and no text conversion takes place, which keeps
+    writing and reading operations with large values, like lists of installed files, cheap.
+    You can override this method to store your own extra-data, or to leave out values that
+    should not be persisted. The record can be restored by fromBinary().
+*/
+QByteArray UpdateOperation::toBinary() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_4);
+    stream << m_arguments << m_values;
+    return data;
+}
+
+/*!
+    Restores operation arguments and values from the binary record  data written by
+    toBinary(). Returns \c true on success, otherwise \c false.
+*/
+bool UpdateOperation::fromBinary(const QByteArray &data)
+{
+    QStringList args;
+    QVariantMap values;
+
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_4);
+    stream >> args >> values;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Error reading binary operation record of size" << data.size();
+        return false;
+    }
+
+    setArguments(args);
+    m_values = values;
+    return true;
+}
@@ -84,6 +84,9 @@ public:
     virtual bool fromXml(const QString &xml);
     virtual bool fromXml(const QDomDocument &doc);
 
+    virtual QByteArray toBinary() const;
+    virtual bool fromBinary(const QByteArray &data);
+
 protected:
     void setName(const QString &name);
     void setErrorString(const QString &errorString);
@@ -52,6 +52,7 @@ public:
     CopyOperation *clone() const;
 
     QDomDocument toXml() const;
+    QByteArray toBinary() const;
 private:
     QString sourcePath();
     QString destinationPath();
@@ -83,6 +84,7 @@ public:
     DeleteOperation *clone() const;
 
     QDomDocument toXml() const;
+    QByteArray toBinary() const;
 };
 
 class KDTOOLS_EXPORT MkdirOperation : public UpdateOperation
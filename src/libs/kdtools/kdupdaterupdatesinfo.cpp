@@ -34,12 +34,31 @@
 
 #include "kdupdaterupdatesinfo_p.h"
 
+#include <QCryptographicHash>
 #include <QFile>
+#include <QFileInfo>
 #include <QLocale>
+#include <QMutex>
 #include <QUrl>
+#include <QXmlStreamReader>
 
 using namespace KDUpdater;
 
+namespace {
+
+struct CachedUpdatesInfo
+{
+    QByteArray sha1;
+    UpdatesInfo info;
+};
+
+typedef QHash<QString, CachedUpdatesInfo> UpdatesInfoCache;
+
+Q_GLOBAL_STATIC(UpdatesInfoCache, updatesInfoCache)
+Q_GLOBAL_STATIC(QMutex, updatesInfoCacheMutex)
+
+} // namespace
+
 UpdatesInfoData::UpdatesInfoData()
      : error(UpdatesInfo::NotYetReadError)
 {
@@ -51,50 +70,60 @@ UpdatesInfoData::~UpdatesInfoData()
 
 void UpdatesInfoData::setInvalidContentError(const QString &detail)
 {
+    // keep the first error, the remaining file is read nevertheless
+    if (error == UpdatesInfo::InvalidContentError)
+        return;
+
     error = UpdatesInfo::InvalidContentError;
     errorMessage = tr("Updates.xml contains invalid content: %1").arg(detail);
 }
 
-void UpdatesInfoData::parseFile(const QString &updateXmlFile)
+void UpdatesInfoData::parseFile(const QString &updateXmlFile, const QByteArray &content)
 {
-    QFile file(updateXmlFile);
-    if (!file.open(QFile::ReadOnly)) {
-        error = UpdatesInfo::CouldNotReadUpdateInfoFileError;
-        errorMessage = tr("Could not read \"%1\"").arg(updateXmlFile);
-        return;
+    error = UpdatesInfo::NotYetReadError;
+
+    QXmlStreamReader reader(content);
+    if (reader.readNextStartElement()) {
+        if (reader.name() != QLatin1String("Updates")) {
+            setInvalidContentError(tr("Root element %1 unexpected, should be \"Updates\".")
+                .arg(reader.name().toString()));
+            return;
+        }
+
+        while (reader.readNextStartElement()) {
+            if (reader.name() == QLatin1String("ApplicationName")) {
+                applicationName = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            } else if (reader.name() == QLatin1String("ApplicationVersion")) {
+                applicationVersion = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+            } else if (reader.name() == QLatin1String("Checksum")) {
+                checksum = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+                // an empty element still counts as present, only a missing one leaves it null
+                if (checksum.isNull())
+                    checksum = QLatin1String("");
+            } else if (reader.name() == QLatin1String("PackageUpdate")) {
+                parsePackageUpdateElement(reader);
+            } else if (reader.name() == QLatin1String("RepositoryUpdate")) {
+                parseRepositoryUpdateElement(reader);
+            } else {
+                reader.skipCurrentElement();
+            }
+        }
     }
 
-    QDomDocument doc;
-    QString parseErrorMessage;
-    int parseErrorLine, parseErrorColumn;
-    if (!doc.setContent(&file, &parseErrorMessage, &parseErrorLine, &parseErrorColumn)) {
+    // make sure the rest of the document is well formed as well
+    while (!reader.atEnd())
+        reader.readNext();
+
+    if (reader.hasError()) {
         error = UpdatesInfo::InvalidXmlError;
         errorMessage = tr("Parse error in %1 at %2, %3: %4").arg(updateXmlFile,
-            QString::number(parseErrorLine), QString::number(parseErrorColumn), parseErrorMessage);
+            QString::number(reader.lineNumber()), QString::number(reader.columnNumber()),
+            reader.errorString());
         return;
     }
 
-    QDomElement rootE = doc.documentElement();
-    if (rootE.tagName() != QLatin1String("Updates")) {
-        setInvalidContentError(tr("Root element %1 unexpected, should be \"Updates\".").arg(rootE.tagName()));
+    if (error == UpdatesInfo::InvalidContentError)
         return;
-    }
-
-    QDomNodeList childNodes = rootE.childNodes();
-    for(int i = 0; i < childNodes.count(); i++) {
-        const QDomElement childE = childNodes.at(i).toElement();
-        if (childE.isNull())
-            continue;
-
-        if (childE.tagName() == QLatin1String("ApplicationName"))
-            applicationName = childE.text();
-        else if (childE.tagName() == QLatin1String("ApplicationVersion"))
-            applicationVersion = childE.text();
-        else if (childE.tagName() == QLatin1String("PackageUpdate")) {
-            if (!parsePackageUpdateElement(childE))
-                return; //error handled in subroutine
-        }
-    }
 
     if (applicationName.isEmpty()) {
         setInvalidContentError(tr("ApplicationName element is missing."));
@@ -110,74 +139,81 @@ void UpdatesInfoData::parseFile(const QString &updateXmlFile)
     error = UpdatesInfo::NoError;
 }
 
-bool UpdatesInfoData::parsePackageUpdateElement(const QDomElement &updateE)
+void UpdatesInfoData::parsePackageUpdateElement(QXmlStreamReader &reader)
 {
-    if (updateE.isNull())
-        return false;
-
     UpdateInfo info;
-    for (int i = 0; i < updateE.childNodes().count(); i++) {
-        QDomElement childE = updateE.childNodes().at(i).toElement();
-        if (childE.isNull())
-            continue;
-
-        if (childE.tagName() == QLatin1String("ReleaseNotes")) {
-            info.data[childE.tagName()] = QUrl(childE.text());
-        } else if (childE.tagName() == QLatin1String("Licenses")) {
+    while (reader.readNextStartElement()) {
+        const QString tagName = reader.name().toString();
+        if (tagName == QLatin1String("ReleaseNotes")) {
+            info.data[tagName] = QUrl(reader.readElementText(QXmlStreamReader::IncludeChildElements));
+        } else if (tagName == QLatin1String("Licenses")) {
             QHash<QString, QVariant> licenseHash;
-            const QDomNodeList licenseNodes = childE.childNodes();
-            for (int i = 0; i < licenseNodes.count(); ++i) {
-                const QDomNode licenseNode = licenseNodes.at(i);
-                if (licenseNode.nodeName() == QLatin1String("License")) {
-                    QDomElement element = licenseNode.toElement();
-                    licenseHash.insert(element.attributeNode(QLatin1String("name")).value(),
-                        element.attributeNode(QLatin1String("file")).value());
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("License")) {
+                    const QXmlStreamAttributes attributes = reader.attributes();
+                    licenseHash.insert(attributes.value(QLatin1String("name")).toString(),
+                        attributes.value(QLatin1String("file")).toString());
                 }
+                reader.skipCurrentElement();
             }
             if (!licenseHash.isEmpty())
                 info.data.insert(QLatin1String("Licenses"), licenseHash);
-        } else if (childE.tagName() == QLatin1String("Version")) {
+        } else if (tagName == QLatin1String("Version")) {
             info.data.insert(QLatin1String("inheritVersionFrom"),
-                childE.attribute(QLatin1String("inheritVersionFrom")));
-            info.data[childE.tagName()] = childE.text();
-        } else if (childE.tagName() == QLatin1String("DisplayName")) {
-            processLocalizedTag(childE, info.data);
-        } else if (childE.tagName() == QLatin1String("Description")) {
-            processLocalizedTag(childE, info.data);
-        } else if (childE.tagName() == QLatin1String("UpdateFile")) {
-            info.data[QLatin1String("CompressedSize")] = childE.attribute(QLatin1String("CompressedSize"));
-            info.data[QLatin1String("UncompressedSize")] = childE.attribute(QLatin1String("UncompressedSize"));
+                reader.attributes().value(QLatin1String("inheritVersionFrom")).toString());
+            info.data[tagName] = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+        } else if (tagName == QLatin1String("DisplayName")) {
+            processLocalizedTag(reader, info.data);
+        } else if (tagName == QLatin1String("Description")) {
+            processLocalizedTag(reader, info.data);
+        } else if (tagName == QLatin1String("UpdateFile")) {
+            const QXmlStreamAttributes attributes = reader.attributes();
+            info.data[QLatin1String("CompressedSize")] = attributes.value(QLatin1String("CompressedSize"))
+                .toString();
+            info.data[QLatin1String("UncompressedSize")] = attributes
+                .value(QLatin1String("UncompressedSize")).toString();
+            reader.skipCurrentElement();
         } else {
-            info.data[childE.tagName()] = childE.text();
+            info.data[tagName] = reader.readElementText(QXmlStreamReader::IncludeChildElements);
         }
     }
 
-    if (!info.data.contains(QLatin1String("Name"))) {
+    if (!info.data.contains(QLatin1String("Name")))
         setInvalidContentError(tr("PackageUpdate element without Name"));
-        return false;
-    }
-    if (!info.data.contains(QLatin1String("Version"))) {
+    else if (!info.data.contains(QLatin1String("Version")))
         setInvalidContentError(tr("PackageUpdate element without Version"));
-        return false;
-    }
-    if (!info.data.contains(QLatin1String("ReleaseDate"))) {
+    else if (!info.data.contains(QLatin1String("ReleaseDate")))
         setInvalidContentError(tr("PackageUpdate element without ReleaseDate"));
-        return false;
-    }
 
     updateInfoList.append(info);
-    return true;
 }
 
-void UpdatesInfoData::processLocalizedTag(const QDomElement &childE, QHash<QString, QVariant> &info) const
+void UpdatesInfoData::parseRepositoryUpdateElement(QXmlStreamReader &reader)
+{
+    while (reader.readNextStartElement()) {
+        if (reader.name() == QLatin1String("Repository")) {
+            RepositoryUpdateInfo info;
+            info.lineNumber = reader.lineNumber();
+            foreach (const QXmlStreamAttribute &attribute, reader.attributes())
+                info.attributes.insert(attribute.name().toString(), attribute.value().toString());
+            repositoryUpdateList.append(info);
+        }
+        reader.skipCurrentElement();
+    }
+}
+
+void UpdatesInfoData::processLocalizedTag(QXmlStreamReader &reader, QHash<QString, QVariant> &info) const
 {
-    QString languageAttribute = childE.attribute(QLatin1String("xml:lang")).toLower();
-    if (!info.contains(childE.tagName()) && (languageAttribute.isEmpty()))
-        info[childE.tagName()] = childE.text();
+    const QString tagName = reader.name().toString();
+    const QString languageAttribute = reader.attributes().value(QLatin1String("xml:lang")).toString()
+        .toLower();
+    const QString text = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+    if (!info.contains(tagName) && (languageAttribute.isEmpty()))
+        info[tagName] = text;
 
     // overwrite default if we have a language specific description
     if (QLocale().name().startsWith(languageAttribute, Qt::CaseInsensitive))
-        info[childE.tagName()] = childE.text();
+        info[tagName] = text;
 }
 
 
@@ -198,6 +234,11 @@ bool UpdatesInfo::isValid() const
     return d->error == NoError;
 }
 
+UpdatesInfo::Error UpdatesInfo::error() const
+{
+    return static_cast<Error>(d->error);
+}
+
 QString UpdatesInfo::errorString() const
 {
     return d->errorMessage;
@@ -210,10 +251,48 @@ void UpdatesInfo::setFileName(const QString &updateXmlFile)
 
     d->applicationName.clear();
     d->applicationVersion.clear();
+    d->checksum.clear();
     d->updateInfoList.clear();
-
+    d->repositoryUpdateList.clear();
     d->updateXmlFile = updateXmlFile;
-    d->parseFile(d->updateXmlFile);
+
+    QFile file(updateXmlFile);
+    if (!file.open(QFile::ReadOnly)) {
+        d->error = CouldNotReadUpdateInfoFileError;
+        d->errorMessage = UpdatesInfoData::tr("Could not read \"%1\"").arg(updateXmlFile);
+        return;
+    }
+    const QByteArray content = file.readAll();
+
+    // every file is parsed only once as long as its content does not change, all objects set to
+    // the same file share the parsed data; size and modification time are not enough, a file
+    // rewritten within the timestamp resolution can keep both
+    const QByteArray sha1 = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+    const QString key = QFileInfo(updateXmlFile).absoluteFilePath();
+    {
+        QMutexLocker _(updatesInfoCacheMutex());
+        const UpdatesInfoCache::const_iterator it = updatesInfoCache()->constFind(key);
+        if (it != updatesInfoCache()->constEnd() && it->sha1 == sha1
+            && it->info.fileName() == updateXmlFile) {
+            d = it->info.d;
+            return;
+        }
+    }
+
+    d->parseFile(updateXmlFile, content);
+
+    CachedUpdatesInfo cached;
+    cached.sha1 = sha1;
+    cached.info = *this;
+
+    QMutexLocker _(updatesInfoCacheMutex());
+    updatesInfoCache()->insert(key, cached);
+}
+
+void UpdatesInfo::clearCache()
+{
+    QMutexLocker _(updatesInfoCacheMutex());
+    updatesInfoCache()->clear();
 }
 
 QString UpdatesInfo::fileName() const
@@ -231,6 +310,11 @@ QString UpdatesInfo::applicationVersion() const
     return d->applicationVersion;
 }
 
+QString UpdatesInfo::checksum() const
+{
+    return d->checksum;
+}
+
 int UpdatesInfo::updateInfoCount() const
 {
     return d->updateInfoList.count();
@@ -247,3 +331,8 @@ QList<UpdateInfo> UpdatesInfo::updatesInfo() const
 {
     return d->updateInfoList;
 }
+
+QList<RepositoryUpdateInfo> UpdatesInfo::repositoryUpdates() const
+{
+    return d->repositoryUpdateList;
+}
@@ -52,6 +52,12 @@ struct KDTOOLS_EXPORT UpdateInfo
     QHash<QString, QVariant> data;
 };
 
+struct KDTOOLS_EXPORT RepositoryUpdateInfo
+{
+    QHash<QString, QString> attributes;
+    qint64 lineNumber;
+};
+
 class KDTOOLS_EXPORT UpdatesInfo
 {
 public:
@@ -77,10 +83,14 @@ public:
 
     QString applicationName() const;
     QString applicationVersion() const;
+    QString checksum() const;
 
     int updateInfoCount() const;
     UpdateInfo updateInfo(int index) const;
     QList<UpdateInfo> updatesInfo() const;
+    QList<RepositoryUpdateInfo> repositoryUpdates() const;
+
+    static void clearCache();
 
 private:
     QSharedDataPointer<UpdatesInfoData> d;
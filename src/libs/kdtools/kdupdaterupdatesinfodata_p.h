@@ -36,12 +36,16 @@
 #define KD_UPDATER_UPDATE_INFO_DATA_H
 
 #include <QCoreApplication>
-#include <QDomElement>
 #include <QSharedData>
 
+QT_BEGIN_NAMESPACE
+class QXmlStreamReader;
+QT_END_NAMESPACE
+
 namespace KDUpdater {
 
 struct UpdateInfo;
+struct RepositoryUpdateInfo;
 
 struct UpdatesInfoData : public QSharedData
 {
@@ -56,15 +60,18 @@ public:
     QString updateXmlFile;
     QString applicationName;
     QString applicationVersion;
+    QString checksum;
     QList<UpdateInfo> updateInfoList;
+    QList<RepositoryUpdateInfo> repositoryUpdateList;
 
-    void parseFile(const QString &updateXmlFile);
-    bool parsePackageUpdateElement(const QDomElement &updateE);
+    void parseFile(const QString &updateXmlFile, const QByteArray &content);
+    void parsePackageUpdateElement(QXmlStreamReader &reader);
+    void parseRepositoryUpdateElement(QXmlStreamReader &reader);
 
     void setInvalidContentError(const QString &detail);
 
 private:
-    void processLocalizedTag(const QDomElement &childE, QHash<QString, QVariant> &info) const;
+    void processLocalizedTag(QXmlStreamReader &reader, QHash<QString, QVariant> &info) const;
 };
 
 } // namespace KDUpdater
@@ -36,12 +36,25 @@
 #include "localpackagehub.h"
 #include "globals.h"
 
+#include <QDataStream>
+#include <QDebug>
 #include <QDomDocument>
 #include <QDomElement>
 #include <QFileInfo>
+#include <QXmlStreamReader>
 
 using namespace KDUpdater;
 
+static const quint32 scJournalMagic = 0x49465731; // "IFW1"
+static const int scMinJournalRecordsBeforeCompaction = 64;
+
+enum JournalRecordType {
+    ApplicationRecord,
+    AddPackageRecord,
+    RemovePackageRecord,
+    ClearRecord
+};
+
 /*!
     \inmodule kdupdater
     \class KDUpdater::LocalPackageHub
@@ -56,6 +69,15 @@ using namespace KDUpdater;
         \li Get information about the number of packages installed and their meta-data via the
             packageInfoCount() and packageInfo() methods.
     \endlist
+
+    Changes can either be written as a whole with writeToDisk(), or be appended to a journal file
+    next to the installation information file with writeJournal(). The latter is meant to be
+    called after each installed or removed package, its cost does not depend on the number of
+    packages. The journal is replayed by refresh() and merged into the XML file by writeToDisk(),
+    or by writeJournal() once it has grown large enough. The XML file is written to a replacement
+    file first, which is renamed over the old one, and a journal record cut off by a crash is
+    ignored, so the installation information stays readable if the process gets killed in the
+    middle of an installation.
 */
 
 /*!
@@ -77,7 +99,9 @@ struct LocalPackageHub::PackagesInfoData
 {
     PackagesInfoData() :
         error(LocalPackageHub::NotYetReadError),
-        modified(false)
+        modified(false),
+        journalSize(0),
+        journalRecordCount(0)
     {}
     QString errorMessage;
     LocalPackageHub::Error error;
@@ -88,10 +112,186 @@ struct LocalPackageHub::PackagesInfoData
 
     QMap<QString, LocalPackage> m_packageInfoMap;
 
-    void addPackageFrom(const QDomElement &packageE);
+    // changes not yet written to the journal
+    QList<QByteArray> pendingRecords;
+    // valid part of the journal file, a record torn by a crash lies behind it
+    qint64 journalSize;
+    int journalRecordCount;
+    QString journalApplicationName;
+    QString journalApplicationVersion;
+
+    QString journalFileName() const { return fileName + QLatin1String(".journal"); }
+    QString replacementFileName() const { return fileName + QLatin1String(".new"); }
+
+    bool readFile(const QString &path);
+    void addPackageFrom(QXmlStreamReader &reader);
     void setInvalidContentError(const QString &detail);
+
+    void addRecord(JournalRecordType type, const LocalPackage &info = LocalPackage());
+    void applyRecord(const QByteArray &record);
+    void readJournal();
+    void clearJournal();
 };
 
+void LocalPackageHub::PackagesInfoData::addRecord(JournalRecordType type, const LocalPackage &info)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_4);
+    stream << quint8(type);
+
+    switch (type) {
+        case ApplicationRecord:
+            stream << applicationName << applicationVersion;
+            break;
+        case AddPackageRecord:
+            stream << info.name << info.pixmap << info.title << info.description << info.version
+                << info.inheritVersionFrom << info.dependencies << info.translations
+                << info.lastUpdateDate << info.installDate << info.forcedInstallation
+                << info.virtualComp << info.uncompressedSize;
+            break;
+        case RemovePackageRecord:
+            stream << info.name;
+            break;
+        case ClearRecord:
+            break;
+    }
+    pendingRecords.append(record);
+}
+
+void LocalPackageHub::PackagesInfoData::applyRecord(const QByteArray &record)
+{
+    QDataStream stream(record);
+    stream.setVersion(QDataStream::Qt_5_4);
+
+    quint8 type;
+    stream >> type;
+    switch (type) {
+        case ApplicationRecord:
+            stream >> applicationName >> applicationVersion;
+            journalApplicationName = applicationName;
+            journalApplicationVersion = applicationVersion;
+            break;
+        case AddPackageRecord: {
+            LocalPackage info;
+            stream >> info.name >> info.pixmap >> info.title >> info.description >> info.version
+                >> info.inheritVersionFrom >> info.dependencies >> info.translations
+                >> info.lastUpdateDate >> info.installDate >> info.forcedInstallation
+                >> info.virtualComp >> info.uncompressedSize;
+            m_packageInfoMap.insert(info.name, info);
+        }   break;
+        case RemovePackageRecord: {
+            QString name;
+            stream >> name;
+            m_packageInfoMap.remove(name);
+        }   break;
+        case ClearRecord:
+            m_packageInfoMap.clear();
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+    Replays the journal on top of the packages read from the XML file. The records are absolute,
+    so replaying a journal that has already been merged into the XML file does not change anything.
+*/
+void LocalPackageHub::PackagesInfoData::readJournal()
+{
+    journalSize = 0;
+    journalRecordCount = 0;
+    journalApplicationName = applicationName;
+    journalApplicationVersion = applicationVersion;
+
+    QFile file(journalFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_4);
+
+    quint32 magic;
+    stream >> magic;
+    if (stream.status() != QDataStream::Ok || magic != scJournalMagic)
+        return;
+    journalSize = file.pos();
+
+    while (!stream.atEnd()) {
+        quint16 checksum;
+        QByteArray record;
+        stream >> checksum >> record;
+        if (stream.status() != QDataStream::Ok
+            || checksum != qChecksum(record.constData(), record.size())) {
+                break;  // torn by a crash, the rest of the journal is lost
+        }
+        applyRecord(record);
+        journalSize = file.pos();
+        ++journalRecordCount;
+    }
+
+    if (journalRecordCount > 0)
+        modified = true;
+}
+
+void LocalPackageHub::PackagesInfoData::clearJournal()
+{
+    QFile::remove(journalFileName());
+    pendingRecords.clear();
+    journalSize = 0;
+    journalRecordCount = 0;
+    journalApplicationName = applicationName;
+    journalApplicationVersion = applicationVersion;
+}
+
+/*
+    Reads the installation information from the XML file \a path. Returns \c false and sets the
+    error if the file could not be read or parsed.
+*/
+bool LocalPackageHub::PackagesInfoData::readFile(const QString &path)
+{
+    applicationName.clear();
+    applicationVersion.clear();
+    m_packageInfoMap.clear();
+
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) {
+        error = LocalPackageHub::CouldNotReadPackageFileError;
+        errorMessage = tr("Could not open %1.").arg(path);
+        return false;
+    }
+
+    QXmlStreamReader reader(&file);
+    if (reader.readNextStartElement() && reader.name() != QLatin1String("Packages")) {
+        setInvalidContentError(tr("Root element %1 unexpected, should be 'Packages'.")
+            .arg(reader.name().toString()));
+        return false;
+    }
+
+    while (reader.readNextStartElement()) {
+        if (reader.name() == QLatin1String("ApplicationName"))
+            applicationName = reader.readElementText();
+        else if (reader.name() == QLatin1String("ApplicationVersion"))
+            applicationVersion = reader.readElementText();
+        else if (reader.name() == QLatin1String("Package"))
+            addPackageFrom(reader);
+        else
+            reader.skipCurrentElement();
+    }
+
+    if (reader.hasError()) {
+        m_packageInfoMap.clear();
+        error = LocalPackageHub::InvalidXmlError;
+        errorMessage = tr("Parse error in %1 at %2, %3: %4")
+                       .arg(path,
+                            QString::number(reader.lineNumber()),
+                            QString::number(reader.columnNumber()),
+                            reader.errorString());
+        return false;
+    }
+    return true;
+}
+
 void LocalPackageHub::PackagesInfoData::setInvalidContentError(const QString &detail)
 {
     error = LocalPackageHub::InvalidContentError;
@@ -242,63 +442,33 @@ void LocalPackageHub::refresh()
     d->applicationName.clear();
     d->applicationVersion.clear();
     d->m_packageInfoMap.clear();
+    d->pendingRecords.clear();
     d->modified = false;
 
-    QFile file(d->fileName);
-
-    // if the file does not exist then we just skip the reading
-    if (!file.exists()) {
-        d->error = NotYetReadError;
-        d->errorMessage = tr("The file %1 does not exist.").arg(d->fileName);
-        return;
-    }
-
-    // Open Packages.xml
-    if (!file.open(QFile::ReadOnly)) {
-        d->error = CouldNotReadPackageFileError;
-        d->errorMessage = tr("Could not open %1.").arg(d->fileName);
-        return;
-    }
-
-    // Parse the XML document
-    QDomDocument doc;
-    QString parseErrorMessage;
-    int parseErrorLine;
-    int parseErrorColumn;
-    if (!doc.setContent(&file, &parseErrorMessage, &parseErrorLine, &parseErrorColumn)) {
-        d->error = InvalidXmlError;
-        d->errorMessage = tr("Parse error in %1 at %2, %3: %4")
-                          .arg(d->fileName,
-                               QString::number(parseErrorLine),
-                               QString::number(parseErrorColumn),
-                               parseErrorMessage);
-        return;
-    }
-    file.close();
-
-    // Now populate information from the XML file.
-    QDomElement rootE = doc.documentElement();
-    if (rootE.tagName() != QLatin1String("Packages")) {
-        d->setInvalidContentError(tr("Root element %1 unexpected, should be 'Packages'.")
-            .arg(rootE.tagName()));
-        return;
-    }
-
-    QDomNodeList childNodes = rootE.childNodes();
-    for (int i = 0; i < childNodes.count(); i++) {
-        QDomNode childNode = childNodes.item(i);
-        QDomElement childNodeE = childNode.toElement();
-        if (childNodeE.isNull())
-            continue;
-
-        if (childNodeE.tagName() == QLatin1String("ApplicationName"))
-            d->applicationName = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("ApplicationVersion"))
-            d->applicationVersion = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("Package"))
-            d->addPackageFrom(childNodeE);
+    if (QFile::exists(d->fileName)) {
+        if (!d->readFile(d->fileName))
+            return;
+    } else if (!QFile::exists(d->replacementFileName())
+        || !d->readFile(d->replacementFileName())) {
+            // writeToDisk() removes the file right before it renames the written replacement, a
+            // crash in between leaves only the replacement; without a complete one, the journal
+            // holds everything written so far
+            d->applicationName.clear();
+            d->applicationVersion.clear();
+            d->m_packageInfoMap.clear();
+            d->readJournal();
+            if (d->journalRecordCount > 0) {
+                // an installation was interrupted before the file was written for the first time
+                d->error = NoError;
+                d->errorMessage.clear();
+                return;
+            }
+            d->error = NotYetReadError;
+            d->errorMessage = tr("The file %1 does not exist.").arg(d->fileName);
+            return;
     }
 
+    d->readJournal();
     d->error = NoError;
     d->errorMessage.clear();
 }
@@ -320,6 +490,7 @@ void LocalPackageHub::addPackage(const QString &name, const QString &version,
         // TODO: What about the other fields, update?
         d->m_packageInfoMap[name].version = version;
         d->m_packageInfoMap[name].lastUpdateDate = QDate::currentDate();
+        d->addRecord(AddPackageRecord, d->m_packageInfoMap.value(name));
     } else {
         LocalPackage info;
         info.name = name;
@@ -333,6 +504,7 @@ void LocalPackageHub::addPackage(const QString &name, const QString &version,
         info.virtualComp = virtualComp;
         info.uncompressedSize = uncompressedSize;
         d->m_packageInfoMap.insert(name, info);
+        d->addRecord(AddPackageRecord, info);
     }
     d->modified = true;
 }
@@ -345,6 +517,9 @@ bool LocalPackageHub::removePackage(const QString &name)
     if (d->m_packageInfoMap.remove(name) <= 0)
         return false;
 
+    LocalPackage info;
+    info.name = name;
+    d->addRecord(RemovePackageRecord, info);
     d->modified = true;
     return true;
 }
@@ -365,11 +540,22 @@ static void addTextChildHelper(QDomNode *node,
 }
 
 /*!
-    Writes the installation information file to disk.
+    Writes the installation information file to disk. The journal written by writeJournal() is
+    removed afterwards. Returns \c false and keeps the journal if the file could not be written.
+
+    The file is written to a replacement next to it, which is renamed over the file once it has
+    been written completely. Both go through QFile, so that they end up in the right place also
+    when the file engine of an elevated installation is in use.
 */
-void LocalPackageHub::writeToDisk()
+bool LocalPackageHub::writeToDisk()
 {
-    if (d->modified && (!d->m_packageInfoMap.isEmpty() || QFile::exists(d->fileName))) {
+    if (d->modified && d->m_packageInfoMap.isEmpty() && !QFile::exists(d->fileName)) {
+        d->clearJournal();
+        d->modified = false;
+        return true;
+    }
+
+    if (d->modified) {
         QDomDocument doc;
         QDomElement root = doc.createElement(QLatin1String("Packages")) ;
         doc.appendChild(root);
@@ -409,62 +595,133 @@ void LocalPackageHub::writeToDisk()
             root.appendChild(package);
         }
 
-        // Open Packages.xml
-        QFile file(d->fileName);
-        if (!file.open(QFile::WriteOnly))
-            return;
+        QFile file(d->replacementFileName());
+        if (!file.open(QFile::WriteOnly)) {
+            qWarning() << "Could not open" << file.fileName() << "for writing:"
+                << file.errorString();
+            return false;
+        }
 
-        file.write(doc.toByteArray(4));
+        const QByteArray data = doc.toByteArray(4);
+        if (file.write(data) != data.size() || !file.flush()) {
+            qWarning() << "Could not write" << file.fileName() << ":" << file.errorString();
+            file.close();
+            file.remove();
+            return false;
+        }
         file.close();
+
+        // QFile::rename() does not overwrite, refresh() picks up the replacement if we crash
+        // before it got renamed
+        if ((QFile::exists(d->fileName) && !QFile::remove(d->fileName))
+            || !file.rename(d->fileName)) {
+                qWarning() << "Could not replace" << d->fileName << ":" << file.errorString();
+                return false;
+        }
+
+        d->clearJournal();
         d->modified = false;
     }
+    return true;
 }
 
-void LocalPackageHub::PackagesInfoData::addPackageFrom(const QDomElement &packageE)
+/*!
+    Appends the changes made since the last write to the journal file. Once the journal holds more
+    records than there are packages, it gets merged into the installation information file by
+    calling writeToDisk().
+*/
+void LocalPackageHub::writeJournal()
 {
-    if (packageE.isNull())
+    if (d->applicationName != d->journalApplicationName
+        || d->applicationVersion != d->journalApplicationVersion) {
+            d->addRecord(ApplicationRecord);
+    }
+
+    if (d->pendingRecords.isEmpty())
         return;
 
-    QDomNodeList childNodes = packageE.childNodes();
-    if (childNodes.count() == 0)
+    // if the compaction fails, the records are appended to the journal instead, so they survive
+    if (d->journalRecordCount + d->pendingRecords.count()
+        > qMax(scMinJournalRecordsBeforeCompaction, d->m_packageInfoMap.count())) {
+            if (writeToDisk())
+                return;
+    }
+
+    QFile file(d->journalFileName());
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Could not open" << file.fileName() << "for writing:" << file.errorString();
         return;
+    }
 
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_4);
+    if (d->journalSize == 0) {
+        file.resize(0);
+        stream << scJournalMagic;
+    } else {
+        // drop a record torn by a previous crash
+        file.resize(d->journalSize);
+        file.seek(d->journalSize);
+    }
+
+    foreach (const QByteArray &record, d->pendingRecords)
+        stream << qChecksum(record.constData(), record.size()) << record;
+
+    if (stream.status() != QDataStream::Ok || !file.flush()) {
+        qWarning() << "Could not write" << file.fileName() << ":" << file.errorString();
+        file.resize(d->journalSize);
+        return;
+    }
+
+    d->journalSize = file.pos();
+    d->journalRecordCount += d->pendingRecords.count();
+    d->journalApplicationName = d->applicationName;
+    d->journalApplicationVersion = d->applicationVersion;
+    d->pendingRecords.clear();
+}
+
+void LocalPackageHub::PackagesInfoData::addPackageFrom(QXmlStreamReader &reader)
+{
+    bool hasChildren = false;
     LocalPackage info;
     info.forcedInstallation = false;
     info.virtualComp = false;
-    for (int i = 0; i < childNodes.count(); i++) {
-        QDomNode childNode = childNodes.item(i);
-        QDomElement childNodeE = childNode.toElement();
-        if (childNodeE.isNull())
-            continue;
-
-        if (childNodeE.tagName() == QLatin1String("Name"))
-            info.name = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("Pixmap"))
-            info.pixmap = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("Title"))
-            info.title = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("Description"))
-            info.description = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("Version")) {
-            info.version = childNodeE.text();
-            info.inheritVersionFrom = childNodeE.attribute(QLatin1String("inheritVersionFrom"));
+    info.uncompressedSize = 0;
+    while (reader.readNextStartElement()) {
+        hasChildren = true;
+        const QStringRef name = reader.name();
+        if (name == QLatin1String("Name"))
+            info.name = reader.readElementText();
+        else if (name == QLatin1String("Pixmap"))
+            info.pixmap = reader.readElementText();
+        else if (name == QLatin1String("Title"))
+            info.title = reader.readElementText();
+        else if (name == QLatin1String("Description"))
+            info.description = reader.readElementText();
+        else if (name == QLatin1String("Version")) {
+            info.inheritVersionFrom = reader.attributes().value(QLatin1String("inheritVersionFrom"))
+                .toString();
+            info.version = reader.readElementText();
         }
-        else if (childNodeE.tagName() == QLatin1String("Virtual"))
-            info.virtualComp = childNodeE.text().toLower() == QLatin1String("true") ? true : false;
-        else if (childNodeE.tagName() == QLatin1String("Size"))
-            info.uncompressedSize = childNodeE.text().toULongLong();
-        else if (childNodeE.tagName() == QLatin1String("Dependencies")) {
-            info.dependencies = childNodeE.text().split(QInstaller::commaRegExp(),
+        else if (name == QLatin1String("Virtual"))
+            info.virtualComp = reader.readElementText().toLower() == QLatin1String("true");
+        else if (name == QLatin1String("Size"))
+            info.uncompressedSize = reader.readElementText().toULongLong();
+        else if (name == QLatin1String("Dependencies")) {
+            info.dependencies = reader.readElementText().split(QInstaller::commaRegExp(),
                 QString::SkipEmptyParts);
-        } else if (childNodeE.tagName() == QLatin1String("ForcedInstallation"))
-            info.forcedInstallation = childNodeE.text().toLower() == QLatin1String( "true" ) ? true : false;
-        else if (childNodeE.tagName() == QLatin1String("LastUpdateDate"))
-            info.lastUpdateDate = QDate::fromString(childNodeE.text(), Qt::ISODate);
-        else if (childNodeE.tagName() == QLatin1String("InstallDate"))
-            info.installDate = QDate::fromString(childNodeE.text(), Qt::ISODate);
+        } else if (name == QLatin1String("ForcedInstallation"))
+            info.forcedInstallation = reader.readElementText().toLower() == QLatin1String("true");
+        else if (name == QLatin1String("LastUpdateDate"))
+            info.lastUpdateDate = QDate::fromString(reader.readElementText(), Qt::ISODate);
+        else if (name == QLatin1String("InstallDate"))
+            info.installDate = QDate::fromString(reader.readElementText(), Qt::ISODate);
+        else
+            reader.skipCurrentElement();
     }
-    m_packageInfoMap.insert(info.name, info);
+
+    if (hasChildren && !reader.hasError())
+        m_packageInfoMap.insert(info.name, info);
 }
 
 /*!
@@ -473,6 +730,8 @@ void LocalPackageHub::PackagesInfoData::addPackageFrom(const QDomElement &packag
 void LocalPackageHub::clearPackageInfos()
 {
     d->m_packageInfoMap.clear();
+    d->pendingRecords.clear();
+    d->addRecord(ClearRecord);
     d->modified = true;
 }
 
@@ -111,7 +111,8 @@ public:
     bool removePackage(const QString &pkgName);
 
     void refresh();
-    void writeToDisk();
+    bool writeToDisk();
+    void writeJournal();
 
 private:
     struct PackagesInfoData;
@@ -92,6 +92,14 @@ CommandLineParser::CommandLineParser()
         QLatin1String("Create a local repository inside the installation directory. This option "
         "has no effect on online installers.")));
 
+    m_parser.addOption(QCommandLineOption(QLatin1String(CommandLineOptions::StreamingInstall),
+        QLatin1String("Install components as soon as their archives are downloaded, while the "
+        "remaining archives are still being fetched. This option has no effect on offline "
+        "installers.")));
+
+    m_parser.addOption(QCommandLineOption(QLatin1String(CommandLineOptions::ParallelInstall),
+        QLatin1String("Install components that do not depend on each other concurrently.")));
+
     m_parser.addOption(QCommandLineOption(QLatin1String(CommandLineOptions::AddRepository),
         QLatin1String("Add a local or remote repository to the list of user defined repositories."),
         QLatin1String("URI,...")));
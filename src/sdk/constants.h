@@ -52,6 +52,8 @@ const char NoForceInstallation[] = "no-force-installations";
 const char ShowVirtualComponents[] = "show-virtual-components";
 const char LoggingRules[] = "logging-rules";
 const char CreateLocalRepository[] = "create-local-repository";
+const char StreamingInstall[] = "streaming-install";
+const char ParallelInstall[] = "parallel-install";
 const char AddRepository[] = "addRepository";
 const char AddTmpRepository[] = "addTempRepository";
 const char SetTmpRepository[] = "setTempRepository";
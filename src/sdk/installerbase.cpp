@@ -211,6 +211,10 @@ int InstallerBase::run()
     QInstaller::PackageManagerCore::setCreateLocalRepositoryFromBinary(parser
         .isSet(QLatin1String(CommandLineOptions::CreateLocalRepository))
         || m_core->settings().createLocalRepository());
+    QInstaller::PackageManagerCore::setStreamingInstall(parser
+        .isSet(QLatin1String(CommandLineOptions::StreamingInstall)));
+    QInstaller::PackageManagerCore::setParallelInstall(parser
+        .isSet(QLatin1String(CommandLineOptions::ParallelInstall)));
 
     QHash<QString, QString> params;
     const QStringList positionalArguments = parser.positionalArguments();
@@ -34,10 +34,12 @@
 
 #include <binarycontent.h>
 #include <binaryformat.h>
+#include <binaryformatenginehandler.h>
 #include <errors.h>
 #include <fileio.h>
 #include <kdupdaterupdateoperation.h>
 
+#include <QDir>
 #include <QTest>
 #include <QTemporaryFile>
 
@@ -121,6 +123,29 @@ private slots:
         }
     }
 
+    void findMagicCookieBetweenPartialMatches()
+    {
+        QTemporaryFile file;
+        file.open();
+
+        try {
+            // surround the cookie with data that repeatedly matches all but its last byte
+            const quint64 cookie = QInstaller::BinaryContent::MagicCookie;
+            const QByteArray partial(reinterpret_cast<const char *>(&cookie), sizeof(cookie) - 1);
+
+            QInstaller::blockingWrite(&file, partial.repeated(1024));
+            QInstaller::appendInt64(&file, cookie);
+            QInstaller::blockingWrite(&file, partial.repeated(1024));
+
+            QCOMPARE(QInstaller::BinaryContent::findMagicCookie(&file, cookie),
+                qint64(partial.size() * 1024));
+        } catch (const QInstaller::Error &error) {
+            QFAIL(qPrintable(error.message()));
+        } catch (...) {
+            QFAIL("Unexpected error.");
+        }
+    }
+
     void findMagicCookieWithError()
     {
         QTest::ignoreMessage(QtDebugMsg, "create Error-Exception: \"No marker found, stopped after 71.00 KiB.\" ");
@@ -140,6 +165,42 @@ private slots:
         }
     }
 
+    void readAndCopyResourceSegment()
+    {
+        QTemporaryFile file;
+        file.open();
+
+        try {
+            QInstaller::blockingWrite(&file, QByteArray(scTinySize, '1'));
+            QInstaller::blockingWrite(&file, QByteArray(scLargeSize, '2'));
+            QInstaller::blockingWrite(&file, QByteArray(scTinySize, '3'));
+            file.close();
+
+            Resource resource(file.fileName(), Range<qint64>::fromStartAndLength(scTinySize,
+                scLargeSize));
+            QVERIFY(resource.open());
+
+            QCOMPARE(resource.read(4), QByteArray(4, '2'));
+            QVERIFY(resource.seek(scLargeSize - 4));
+            QCOMPARE(resource.readAll(), QByteArray(4, '2'));
+
+            QVERIFY(resource.seek(0));
+            QTemporaryFile target;
+            target.open();
+            QInstaller::blockingWrite(&target, QByteArray("prefix"));
+            resource.copyData(&target);
+            QCOMPARE(resource.pos(), scLargeSize);
+            QCOMPARE(target.pos(), scLargeSize + 6);
+
+            target.seek(0);
+            QCOMPARE(target.readAll(), QByteArray("prefix") + QByteArray(scLargeSize, '2'));
+        } catch (const QInstaller::Error &error) {
+            QFAIL(qPrintable(error.message()));
+        } catch (...) {
+            QFAIL("Unexpected error.");
+        }
+    }
+
     void writeBinaryContent()
     {
         QTemporaryFile binary;
@@ -398,6 +459,87 @@ private slots:
         resource->close();
     }
 
+    void resourceLookupThroughEngine()
+    {
+        QTemporaryFile file;
+        file.open();
+        QInstaller::blockingWrite(&file, QByteArray("Registered resource."));
+        file.close();
+
+        BinaryFormatEngineHandler *const handler = BinaryFormatEngineHandler::instance();
+        for (int i = 0; i < 1000; ++i) {
+            handler->registerResource(QString::fromLatin1("installer://Lookup/Resource%1")
+                .arg(i), file.fileName());
+        }
+
+        QFile resource(QLatin1String("installer://Lookup/Resource999/"));
+        QVERIFY(resource.exists());
+        QVERIFY(resource.open(QIODevice::ReadOnly));
+        QCOMPARE(resource.readAll(), QByteArray("Registered resource."));
+        resource.close();
+
+        QCOMPARE(QDir(QLatin1String("installer://Lookup")).entryList(QDir::Files).count(), 1000);
+
+        handler->clear();
+    }
+
+    void operationJournal()
+    {
+        QStringList files;
+        for (int i = 0; i < 10000; ++i)
+            files.append(QString::fromLatin1("/opt/installed/file%1").arg(i));
+
+        TestOperation op(QLatin1String("Extract"));
+        op.setArguments(QStringList() << QLatin1String("archive.7z") << QLatin1String("/opt"));
+        op.setValue(QLatin1String("files"), files);
+        op.setValue(QLatin1String("count"), 42);
+
+        QTemporaryFile file;
+        QInstaller::openForWrite(&file);
+        try {
+            QList<OperationBlob> operations;
+            operations.append(OperationBlob(op.name(), op.toBinary()));
+            operations.append(OperationBlob(op.name(), op.toBinary()));
+            BinaryContent::writeOperations(&file, operations);
+
+            file.seek(0);
+            QCOMPARE(QInstaller::retrieveInt64(&file), BinaryContent::MagicOperationJournal);
+
+            file.seek(0);
+            operations.clear();
+            BinaryContent::readOperations(&file, &operations);
+            QCOMPARE(operations.count(), 2);
+            QCOMPARE(file.pos(), file.size());
+
+            foreach (const OperationBlob &operation, operations) {
+                QCOMPARE(operation.name, op.name());
+                QVERIFY(operation.xml.isEmpty());
+
+                TestOperation restored(operation.name);
+                QVERIFY(restored.fromBinary(operation.data));
+                QCOMPARE(restored.arguments(), op.arguments());
+                QCOMPARE(restored.value(QLatin1String("files")).toStringList(), files);
+                QCOMPARE(restored.value(QLatin1String("count")).toInt(), 42);
+            }
+
+            // the legacy XML operation list still reads
+            file.resize(0);
+            file.seek(0);
+            BinaryContent::writeOperations(&file, m_operations);
+            file.seek(0);
+            operations.clear();
+            BinaryContent::readOperations(&file, &operations);
+            QCOMPARE(operations.count(), m_operations.count());
+            for (int i = 0; i < operations.count(); ++i) {
+                QCOMPARE(operations.at(i).name, m_operations.at(i).name);
+                QCOMPARE(operations.at(i).xml, m_operations.at(i).xml);
+                QVERIFY(operations.at(i).data.isEmpty());
+            }
+        } catch (const QInstaller::Error &error) {
+            QFAIL(qPrintable(error.message()));
+        }
+    }
+
     void cleanupTestCase()
     {
         m_manager.clear();
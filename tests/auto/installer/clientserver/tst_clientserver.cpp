@@ -145,6 +145,39 @@ private slots:
         }
     }
 
+    void queueReceivePackets()
+    {
+        QByteArray packets;
+        {
+            QBuffer device(&packets);
+            device.open(QBuffer::WriteOnly);
+
+            QInstaller::queuePacket(&device, "first", "hello");
+            QInstaller::queuePacket(&device, "second", QByteArray());
+            QInstaller::sendPacket(&device, "third", "world");
+        }
+
+        QBuffer device(&packets);
+        device.open(QBuffer::ReadOnly);
+
+        QByteArray cmd;
+        QByteArray data;
+        QCOMPARE(QInstaller::receivePacket(&device, &cmd, &data), true);
+        QCOMPARE(cmd, QByteArray("first"));
+        QCOMPARE(data, QByteArray("hello"));
+
+        QCOMPARE(QInstaller::receivePacket(&device, &cmd, &data), true);
+        QCOMPARE(cmd, QByteArray("second"));
+        QCOMPARE(data, QByteArray());
+
+        QCOMPARE(QInstaller::receivePacket(&device, &cmd, &data), true);
+        QCOMPARE(cmd, QByteArray("third"));
+        QCOMPARE(data, QByteArray("world"));
+
+        QCOMPARE(device.pos(), device.size());
+        QCOMPARE(QInstaller::receivePacket(&device, &cmd, &data), false);
+    }
+
     void localSocket()
     {
         //
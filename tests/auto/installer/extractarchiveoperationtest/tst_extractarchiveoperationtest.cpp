@@ -36,6 +36,7 @@
 #include "extractarchiveoperation.h"
 
 #include <QDir>
+#include <QFileInfo>
 #include <QObject>
 #include <QTest>
 
@@ -73,7 +74,15 @@ private slots:
 
         QVERIFY(op.testOperation());
         QVERIFY(op.performOperation());
+
+        const QStringList files = op.value(QLatin1String("files")).toStringList();
+        QVERIFY(!files.isEmpty());
+        foreach (const QString &file, files)
+            QVERIFY2(QFileInfo::exists(file), qPrintable(file));
+
         QVERIFY(op.undoOperation());
+        foreach (const QString &file, files)
+            QVERIFY2(!QFileInfo::exists(file), qPrintable(file));
     }
 
     void testExtractOperationInvalidFile()
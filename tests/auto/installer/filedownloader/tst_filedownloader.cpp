@@ -0,0 +1,259 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <kdupdaterfiledownloader.h>
+#include <kdupdaterfiledownloaderfactory.h>
+
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QScopedPointer>
+#include <QSettings>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+#include <QUrl>
+
+// Serves one file with a strong validator and honors range requests. Queued status codes are
+// sent instead of the file, one per request.
+class HttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    HttpServer(const QByteArray &data, const QByteArray &eTag)
+        : m_data(data)
+        , m_eTag(eTag)
+    {
+        connect(this, SIGNAL(newConnection()), this, SLOT(handleConnection()));
+    }
+
+    QList<int> statusQueue;
+    QList<QHash<QByteArray, QByteArray> > requests;
+
+private slots:
+    void handleConnection()
+    {
+        while (QTcpSocket *socket = nextPendingConnection()) {
+            connect(socket, SIGNAL(readyRead()), this, SLOT(handleRequest()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void handleRequest()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+        const QByteArray request = socket->peek(socket->bytesAvailable());
+        if (!request.contains("\r\n\r\n"))
+            return; // wait for the complete header
+        socket->readAll();
+
+        QHash<QByteArray, QByteArray> headers;
+        foreach (const QByteArray &line, request.split('\n').mid(1)) {
+            const int colon = line.indexOf(':');
+            if (colon > 0)
+                headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+        }
+        requests.append(headers);
+
+        int status = statusQueue.isEmpty() ? 200 : statusQueue.takeFirst();
+        QByteArray body = status == 200 ? m_data : QByteArray("error page");
+        QByteArray extraHeaders;
+        if (status == 200 && headers.contains("range") && headers.value("if-range") == m_eTag) {
+            const qint64 offset = headers.value("range").mid(6).split('-').first().toLongLong();
+            status = 206;
+            body = m_data.mid(offset);
+            extraHeaders = "Content-Range: bytes " + QByteArray::number(offset) + '-'
+                + QByteArray::number(m_data.size() - 1) + '/' + QByteArray::number(m_data.size())
+                + "\r\n";
+        }
+
+        socket->write("HTTP/1.1 " + QByteArray::number(status) + " Status\r\n"
+            + "ETag: " + m_eTag + "\r\n"
+            + "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+            + "Connection: close\r\n" + extraHeaders + "\r\n" + body);
+        socket->disconnectFromHost();
+    }
+
+private:
+    const QByteArray m_data;
+    const QByteArray m_eTag;
+};
+
+class tst_FileDownloader : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Writes the partial file and the state an interrupted download leaves behind.
+    void prepareInterruptedDownload(const QByteArray &partialData, const QByteArray &eTag)
+    {
+        QFile file(m_fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(partialData), qint64(partialData.size()));
+
+        QSettings state(m_fileName + QLatin1String(".resume"), QSettings::IniFormat);
+        state.setValue(QLatin1String("Url"), m_url.toString());
+        state.setValue(QLatin1String("ETag"), eTag);
+        state.setValue(QLatin1String("LastModified"), QByteArray());
+    }
+
+    QByteArray download(bool *completed)
+    {
+        QScopedPointer<KDUpdater::FileDownloader> downloader(KDUpdater::FileDownloaderFactory
+            ::instance().create(QLatin1String("http"), 0));
+        downloader->setUrl(m_url);
+        downloader->setDownloadedFileName(m_fileName);
+
+        QSignalSpy completedSpy(downloader.data(), SIGNAL(downloadCompleted()));
+        QSignalSpy abortedSpy(downloader.data(), SIGNAL(downloadAborted(QString)));
+
+        QEventLoop loop;
+        connect(downloader.data(), SIGNAL(downloadCompleted()), &loop, SLOT(quit()));
+        connect(downloader.data(), SIGNAL(downloadAborted(QString)), &loop, SLOT(quit()));
+        QTimer::singleShot(10000, &loop, SLOT(quit()));
+        downloader->download();
+        loop.exec();
+
+        *completed = completedSpy.count() == 1 && abortedSpy.isEmpty();
+        downloader.reset();
+
+        QFile file(m_fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return file.readAll();
+    }
+
+    QByteArray stateETag() const
+    {
+        const QSettings state(m_fileName + QLatin1String(".resume"), QSettings::IniFormat);
+        return state.value(QLatin1String("ETag")).toByteArray();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        for (int i = 0; i < 100000; ++i)
+            m_data.append(char(i % 251));
+    }
+
+    void init()
+    {
+        m_server.reset(new HttpServer(m_data, "\"v2\""));
+        QVERIFY(m_server->listen(QHostAddress::LocalHost));
+        m_url = QUrl(QString::fromLatin1("http://127.0.0.1:%1/file").arg(m_server->serverPort()));
+
+        m_dir.reset(new QTemporaryDir);
+        QVERIFY(m_dir->isValid());
+        m_fileName = m_dir->path() + QLatin1String("/file");
+    }
+
+    void cleanup()
+    {
+        m_server.reset();
+        m_dir.reset();
+    }
+
+    void testResume()
+    {
+        prepareInterruptedDownload(m_data.left(40000), "\"v2\"");
+
+        bool completed = false;
+        QCOMPARE(download(&completed), m_data);
+        QVERIFY(completed);
+
+        QCOMPARE(m_server->requests.count(), 1);
+        QCOMPARE(m_server->requests.first().value("range"), QByteArray("bytes=40000-"));
+        QVERIFY(!QFile::exists(m_fileName + QLatin1String(".resume")));
+    }
+
+    void testResumeChangedFile()
+    {
+        // the validator does not match anymore, so the server sends the whole file
+        prepareInterruptedDownload(QByteArray(40000, 'x'), "\"v1\"");
+
+        bool completed = false;
+        QCOMPARE(download(&completed), m_data);
+        QVERIFY(completed);
+        QCOMPARE(m_server->requests.count(), 1);
+    }
+
+    void testRestartAfterRangeNotSatisfiable()
+    {
+        prepareInterruptedDownload(m_data.left(40000), "\"v2\"");
+        m_server->statusQueue << 416;
+
+        bool completed = false;
+        QCOMPARE(download(&completed), m_data);
+        QVERIFY(completed);
+
+        // the partial file is dropped and downloaded again from the beginning
+        QCOMPARE(m_server->requests.count(), 2);
+        QVERIFY(m_server->requests.at(0).contains("range"));
+        QVERIFY(!m_server->requests.at(1).contains("range"));
+    }
+
+    void testErrorKeepsPartialData_data()
+    {
+        QTest::addColumn<int>("status");
+        QTest::newRow("not found") << 404;
+        QTest::newRow("server error") << 503;
+    }
+
+    void testErrorKeepsPartialData()
+    {
+        QFETCH(int, status);
+        prepareInterruptedDownload(m_data.left(40000), "\"v2\"");
+        m_server->statusQueue << status;
+
+        bool completed = true;
+        QCOMPARE(download(&completed), m_data.left(40000));
+        QVERIFY(!completed);
+        QCOMPARE(stateETag(), QByteArray("\"v2\""));
+    }
+
+private:
+    QByteArray m_data;
+    QUrl m_url;
+    QString m_fileName;
+    QScopedPointer<HttpServer> m_server;
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+QTEST_MAIN(tst_FileDownloader)
+
+#include "tst_filedownloader.moc"
@@ -17,4 +17,9 @@ SUBDIRS += \
     packagemanagercore \
     settingsoperation \
     task \
-    clientserver
+    updatesinfo \
+    localpackagehub \
+    clientserver \
+    filedownloader \
+    metadatajob \
+    repogen
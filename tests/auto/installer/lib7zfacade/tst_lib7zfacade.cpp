@@ -36,9 +36,14 @@
 #include "lib7z_facade.h"
 
 #include <QDir>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
+#include <QThread>
 
 class tst_lib7zfacade : public QObject
 {
@@ -105,6 +110,67 @@ private slots:
         }
     }
 
+    void testListArchiveVisitor()
+    {
+        class PathVisitor : public Lib7z::ArchiveVisitor
+        {
+        public:
+            bool visit(const Lib7z::ArchiveEntry &entry)
+            {
+                paths.append(entry.path());
+                return false;
+            }
+            QStringList paths;
+        };
+
+        QFile file(":///data/valid.7z");
+        QVERIFY(file.open(QIODevice::ReadOnly));
+
+        try {
+            PathVisitor visitor;
+            Lib7z::listArchive(&file, &visitor, Lib7z::ListPaths);
+            QCOMPARE(visitor.paths, QStringList() << m_file.path);
+
+            const Lib7z::ArchiveStatistics statistics = Lib7z::archiveStatistics(&file);
+            QCOMPARE(statistics.fileCount, quint64(1));
+            QCOMPARE(statistics.directoryCount, quint64(0));
+            QCOMPARE(statistics.uncompressedSize, m_file.uncompressedSize);
+            QCOMPARE(statistics.compressedSize, m_file.compressedSize);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        }
+    }
+
+    void testArchiveOnDisk()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString archive = dir.path() + QLatin1String("/archive.7z");
+        QVERIFY(QFile::copy(":///data/valid.7z", archive));
+
+        try {
+            // probed and listed through different devices, the archive is opened only once
+            QCOMPARE(Lib7z::isSupportedArchive(archive), true);
+            for (int i = 0; i < 2; ++i) {
+                QFile file(archive);
+                QVERIFY(file.open(QIODevice::ReadOnly));
+                QCOMPARE(Lib7z::listArchive(&file).count(), 1);
+            }
+
+            // the extraction closes the archive, so the file can be replaced afterwards
+            QFile file(archive);
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            Lib7z::extractArchive(&file, dir.path() + QLatin1String("/target"));
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        }
+
+        // a changed file is opened again
+        QVERIFY(QFile::remove(archive));
+        QVERIFY(QFile::copy(":///data/invalid.7z", archive));
+        QCOMPARE(Lib7z::isSupportedArchive(archive), false);
+    }
+
     void testCreateArchive()
     {
         QTemporaryFile target;
@@ -120,6 +186,58 @@ private slots:
         }
     }
 
+    void testCreateArchiveWithOptions()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString source = dir.path() + QLatin1String("/source.txt");
+        {
+            QFile file(source);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QVERIFY(file.write(QByteArray(1024, 'x')) == 1024);
+        }
+
+        Lib7z::CompressionOptions options;
+        options.method = QLatin1String("LZMA2");
+        options.level = 9;
+        options.threadCount = 2;
+        options.solidBlockSize = 0;
+        options.dictionarySize = 1 << 20;
+
+        // the archive is written starting at the current position of the device
+        const QByteArray prefix("prefix");
+        QFile target(dir.path() + QLatin1String("/target.7z"));
+        QVERIFY(target.open(QIODevice::ReadWrite));
+        QCOMPARE(target.write(prefix), qint64(prefix.size()));
+
+        try {
+            Lib7z::createArchive(&target, QStringList() << source, options);
+            QVERIFY(target.seek(0));
+            QCOMPARE(target.read(prefix.size()), prefix);
+
+            QFile archive(dir.path() + QLatin1String("/archive.7z"));
+            QVERIFY(archive.open(QIODevice::WriteOnly));
+            QVERIFY(archive.write(target.readAll()) > 0);
+            archive.close();
+
+            QVERIFY(archive.open(QIODevice::ReadOnly));
+            const Lib7z::ArchiveStatistics statistics = Lib7z::archiveStatistics(&archive);
+            QCOMPARE(statistics.fileCount, quint64(1));
+            QCOMPARE(statistics.uncompressedSize, quint64(1024));
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        }
+
+        options.method = QLatin1String("unknown");
+        QVERIFY(target.resize(0));
+        QVERIFY(target.seek(0));
+        try {
+            Lib7z::createArchive(&target, QStringList() << source, options);
+            QFAIL("Exception expected for an unknown compression method!");
+        } catch (const Lib7z::SevenZipException&) {
+        }
+    }
+
     void testExtractArchive()
     {
         QFile source(":///data/valid.7z");
@@ -135,6 +253,97 @@ private slots:
         }
     }
 
+    void testExtractArchiveThreaded()
+    {
+        class ThreadRecorder : public Lib7z::ExtractCallback
+        {
+        public:
+            bool prepareForFile(const QString &fileName)
+            {
+                QMutexLocker _(&mutex);
+                threads.insert(QThread::currentThread());
+                return Lib7z::ExtractCallback::prepareForFile(fileName);
+            }
+            QMutex mutex;
+            QSet<QThread*> threads;
+        };
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        // several files in their own solid blocks, so the archive can be split up
+        QHash<QString, QByteArray> contents;
+        const QString sourceDir = dir.path() + QLatin1String("/source");
+        QVERIFY(QDir().mkpath(sourceDir + QLatin1String("/sub")));
+        for (int i = 0; i < 6; ++i) {
+            const QString path = QLatin1String(i % 2 ? "source/sub/file" : "source/file")
+                + QString::number(i);
+            QByteArray data;
+            for (int j = 0; j < (i + 1) * 50000; ++j)
+                data.append(char((i * 31 + j * 7) % 251));
+            contents.insert(path, data);
+
+            QFile file(dir.path() + QLatin1Char('/') + path);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QCOMPARE(file.write(data), qint64(data.size()));
+        }
+
+        const QString subDir = sourceDir + QLatin1String("/sub");
+#ifdef Q_OS_UNIX
+        // the files need to be extracted into a directory without write permission
+        QVERIFY(QFile::setPermissions(subDir, QFile::ReadOwner | QFile::ExeOwner));
+#endif
+
+        Lib7z::CompressionOptions options;
+        options.solidBlockSize = 0;
+        const QString archivePath = dir.path() + QLatin1String("/archive.7z");
+        const QString targetDir = dir.path() + QLatin1String("/target");
+        ThreadRecorder recorder;
+        try {
+            {
+                QFile archive(archivePath);
+                QVERIFY(archive.open(QIODevice::WriteOnly));
+                Lib7z::createArchive(&archive, QStringList() << sourceDir, options);
+            }
+
+            // the archive needs to be a file on disk to be opened by more than one thread
+            QFile archive(archivePath);
+            QVERIFY(archive.open(QIODevice::ReadOnly));
+            Lib7z::extractArchive(&archive, targetDir, &recorder, 4);
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during extract archive!");
+        }
+
+        // the blocks were decoded by more than one thread
+        QVERIFY(recorder.threads.count() > 1);
+
+        QHash<QString, QByteArray>::const_iterator it;
+        for (it = contents.constBegin(); it != contents.constEnd(); ++it) {
+            QFile extracted(targetDir + QLatin1Char('/') + it.key());
+            QVERIFY2(extracted.open(QIODevice::ReadOnly), qPrintable(extracted.fileName()));
+            QCOMPARE(extracted.size(), qint64(it.value().size()));
+            QVERIFY2(extracted.readAll() == it.value(), qPrintable(extracted.fileName()));
+        }
+
+        // the directory attributes are applied after all files have been written, so the
+        // directory's modification time is restored like the one of a file
+        const QString extractedSubDir = targetDir + QLatin1String("/source/sub");
+        const QString file = QLatin1String("/file0");
+        QCOMPARE(QFileInfo(subDir).lastModified().secsTo(QFileInfo(extractedSubDir).lastModified()),
+            QFileInfo(sourceDir + file).lastModified().secsTo(QFileInfo(targetDir
+            + QLatin1String("/source") + file).lastModified()));
+#ifdef Q_OS_UNIX
+        const QFile::Permissions ownerPermissions = QFile::ReadOwner | QFile::WriteOwner
+            | QFile::ExeOwner;
+        QCOMPARE(QFileInfo(extractedSubDir).permissions() & ownerPermissions,
+            QFile::ReadOwner | QFile::ExeOwner);
+        QVERIFY(QFile::setPermissions(extractedSubDir, ownerPermissions));
+        QVERIFY(QFile::setPermissions(subDir, ownerPermissions));
+#endif
+    }
+
     void testExtractFileFromArchive()
     {
         QFile source(":///data/valid.7z");
@@ -0,0 +1,224 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+
+
+#include <localpackagehub.h>
+
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KDUpdater;
+
+class tst_LocalPackageHub : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/components.xml");
+
+        {
+            LocalPackageHub hub;
+            hub.setFileName(fileName);
+            hub.setApplicationName(QLatin1String("Application"));
+            hub.setApplicationVersion(QLatin1String("1.0.0"));
+            hub.addPackage(QLatin1String("A"), QLatin1String("1.0.0"), QLatin1String("Title A"),
+                QString(), QStringList() << QLatin1String("B") << QLatin1String("C"), true, false,
+                42, QLatin1String("B"));
+            hub.addPackage(QLatin1String("B"), QLatin1String("2.0.0"));
+            hub.writeToDisk();
+        }
+        QVERIFY(QFile::exists(fileName));
+        QVERIFY(!QFile::exists(fileName + QLatin1String(".journal")));
+
+        LocalPackageHub hub;
+        hub.setFileName(fileName);
+        QCOMPARE(hub.error(), LocalPackageHub::NoError);
+        QCOMPARE(hub.applicationName(), QString("Application"));
+        QCOMPARE(hub.packageNames(), QStringList() << QLatin1String("A") << QLatin1String("B"));
+
+        const LocalPackage package = hub.packageInfo(QLatin1String("A"));
+        QCOMPARE(package.title, QString("Title A"));
+        QCOMPARE(package.inheritVersionFrom, QString("B"));
+        QCOMPARE(package.dependencies, QStringList() << QLatin1String("B") << QLatin1String("C"));
+        QCOMPARE(package.forcedInstallation, true);
+        QCOMPARE(package.uncompressedSize, quint64(42));
+    }
+
+    void journal()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/components.xml");
+        const QString journalFileName = fileName + QLatin1String(".journal");
+
+        LocalPackageHub hub;
+        hub.setFileName(fileName);
+        hub.setApplicationName(QLatin1String("Application"));
+        hub.addPackage(QLatin1String("A"), QLatin1String("1.0.0"));
+        hub.writeToDisk();
+
+        hub.addPackage(QLatin1String("B"), QLatin1String("1.0.0"));
+        hub.removePackage(QLatin1String("A"));
+        hub.writeJournal();
+        QVERIFY(QFile::exists(journalFileName));
+
+        // another reader sees the changes without the file being rewritten
+        {
+            LocalPackageHub reader;
+            reader.setFileName(fileName);
+            QCOMPARE(reader.error(), LocalPackageHub::NoError);
+            QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("B"));
+            QCOMPARE(reader.applicationName(), QString("Application"));
+        }
+
+        // a record cut off by a crash is ignored
+        QFile file(journalFileName);
+        QVERIFY(file.open(QIODevice::Append));
+        file.write("\x12\x34\x00\x00\x00\xff", 6);
+        file.close();
+
+        hub.addPackage(QLatin1String("C"), QLatin1String("1.0.0"));
+        hub.writeJournal();
+        {
+            LocalPackageHub reader;
+            reader.setFileName(fileName);
+            QCOMPARE(reader.error(), LocalPackageHub::NoError);
+            QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("B")
+                << QLatin1String("C"));
+        }
+
+        hub.writeToDisk();
+        QVERIFY(!QFile::exists(journalFileName));
+
+        LocalPackageHub reader;
+        reader.setFileName(fileName);
+        QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("B") << QLatin1String("C"));
+    }
+
+    void journalWithoutFile()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/components.xml");
+
+        LocalPackageHub hub;
+        hub.setFileName(fileName);
+        QCOMPARE(hub.error(), LocalPackageHub::NotYetReadError);
+        hub.clearPackageInfos();
+        hub.addPackage(QLatin1String("A"), QLatin1String("1.0.0"));
+        hub.writeJournal();
+        QVERIFY(!QFile::exists(fileName));
+
+        LocalPackageHub reader;
+        reader.setFileName(fileName);
+        QCOMPARE(reader.error(), LocalPackageHub::NoError);
+        QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("A"));
+    }
+
+    void interruptedCompaction()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/components.xml");
+        const QString replacementFileName = fileName + QLatin1String(".new");
+
+        LocalPackageHub hub;
+        hub.setFileName(fileName);
+        hub.setApplicationName(QLatin1String("Application"));
+        hub.addPackage(QLatin1String("A"), QLatin1String("1.0.0"));
+        hub.writeToDisk();
+        QVERIFY(!QFile::exists(replacementFileName));
+
+        hub.addPackage(QLatin1String("B"), QLatin1String("1.0.0"));
+        hub.writeJournal();
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray content = file.readAll();
+        file.close();
+
+        // killed while writing the replacement, the old file and the journal are still there
+        QFile replacement(replacementFileName);
+        QVERIFY(replacement.open(QIODevice::WriteOnly));
+        replacement.write(content.left(content.size() / 2));
+        replacement.close();
+        {
+            LocalPackageHub reader;
+            reader.setFileName(fileName);
+            QCOMPARE(reader.error(), LocalPackageHub::NoError);
+            QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("A")
+                << QLatin1String("B"));
+        }
+
+        // killed after the old file was removed, the replacement is complete
+        QVERIFY(replacement.open(QIODevice::WriteOnly));
+        replacement.write(content);
+        replacement.close();
+        QVERIFY(QFile::remove(fileName));
+        {
+            LocalPackageHub reader;
+            reader.setFileName(fileName);
+            QCOMPARE(reader.error(), LocalPackageHub::NoError);
+            QCOMPARE(reader.applicationName(), QString("Application"));
+            QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("A")
+                << QLatin1String("B"));
+        }
+
+        // killed while the file was written for the first time, only the journal counts
+        QVERIFY(QFile::remove(replacementFileName));
+        LocalPackageHub firstHub;
+        firstHub.setFileName(fileName);
+        firstHub.clearPackageInfos();
+        firstHub.addPackage(QLatin1String("C"), QLatin1String("1.0.0"));
+        firstHub.writeJournal();
+
+        QVERIFY(replacement.open(QIODevice::WriteOnly));
+        replacement.write(content.left(content.size() / 2));
+        replacement.close();
+        {
+            LocalPackageHub reader;
+            reader.setFileName(fileName);
+            QCOMPARE(reader.error(), LocalPackageHub::NoError);
+            QCOMPARE(reader.packageNames(), QStringList() << QLatin1String("C"));
+        }
+
+        // the next write replaces the leftovers
+        firstHub.writeToDisk();
+        QVERIFY(QFile::exists(fileName));
+        QVERIFY(!QFile::exists(replacementFileName));
+        QVERIFY(!QFile::exists(fileName + QLatin1String(".journal")));
+    }
+};
+
+QTEST_MAIN(tst_LocalPackageHub)
+
+#include "tst_localpackagehub.moc"
@@ -0,0 +1,8 @@
+include(../../qttest.pri)
+
+QT += network qml
+
+SOURCES += tst_metadatajob.cpp
+
+RESOURCES += \
+    settings.qrc
@@ -0,0 +1,317 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <binarycontent.h>
+#include <component.h>
+#include <init.h>
+#include <lib7z_facade.h>
+#include <metadatajob.h>
+#include <packagemanagercore.h>
+#include <repository.h>
+#include <settings.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QHash>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+typedef QPair<QByteArray, int> Request;
+
+// Serves a set of files, using their SHA1 as ETag. Conditional requests for unchanged files are
+// answered with 304.
+class HttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    HttpServer()
+    {
+        connect(this, SIGNAL(newConnection()), this, SLOT(handleConnection()));
+    }
+
+    QHash<QByteArray, QByteArray> files;
+    QList<Request> requests;
+
+private slots:
+    void handleConnection()
+    {
+        while (QTcpSocket *socket = nextPendingConnection()) {
+            connect(socket, SIGNAL(readyRead()), this, SLOT(handleRequest()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void handleRequest()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+        const QByteArray request = socket->peek(socket->bytesAvailable());
+        if (!request.contains("\r\n\r\n"))
+            return; // wait for the complete header
+        socket->readAll();
+
+        const QList<QByteArray> lines = request.split('\n');
+        const QByteArray path = lines.first().split(' ').value(1).split('?').first();
+        QByteArray ifNoneMatch;
+        foreach (const QByteArray &line, lines.mid(1)) {
+            if (line.toLower().startsWith("if-none-match:"))
+                ifNoneMatch = line.mid(14).trimmed();
+        }
+
+        int status = 404;
+        QByteArray body;
+        QByteArray eTag;
+        if (files.contains(path)) {
+            body = files.value(path);
+            eTag = '"' + QCryptographicHash::hash(body, QCryptographicHash::Sha1).toHex() + '"';
+            status = (ifNoneMatch == eTag) ? 304 : 200;
+            if (status == 304)
+                body.clear();
+        }
+        requests.append(Request(path, status));
+
+        socket->write("HTTP/1.1 " + QByteArray::number(status) + " Status\r\n"
+            + (eTag.isEmpty() ? QByteArray() : "ETag: " + eTag + "\r\n")
+            + "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+            + "Connection: close\r\n\r\n" + body);
+        socket->disconnectFromHost();
+    }
+};
+
+class tst_MetadataJob : public QObject
+{
+    Q_OBJECT
+
+private:
+    QByteArray createMetaArchive(const QString &packageName)
+    {
+        QTemporaryDir dir;
+        const QString packageDir = dir.path() + QLatin1Char('/') + packageName;
+        if (!QDir().mkpath(packageDir))
+            return QByteArray();
+
+        QFile packageXml(packageDir + QLatin1String("/package.xml"));
+        if (!packageXml.open(QIODevice::WriteOnly))
+            return QByteArray();
+        packageXml.write("<Package/>");
+        packageXml.close();
+
+        QFile archive(dir.path() + QLatin1String("/meta.7z"));
+        if (!archive.open(QIODevice::ReadWrite))
+            return QByteArray();
+        try {
+            Lib7z::createArchive(&archive, QStringList() << packageDir);
+        } catch (const Lib7z::SevenZipException &) {
+            return QByteArray();
+        }
+        archive.close();
+
+        if (!archive.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return archive.readAll();
+    }
+
+    // Publishes a repository containing the given packages in version 1.0.0. The optional
+    // \a packageElements are added to every package.
+    void publishRepository(const QStringList &packageNames,
+        const QByteArray &packageElements = QByteArray())
+    {
+        m_server.files.clear();
+        QByteArray updatesXml = "<Updates><ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion><Checksum>true</Checksum>";
+        foreach (const QString &packageName, packageNames) {
+            const QByteArray archive = m_archives.value(packageName);
+            updatesXml += "<PackageUpdate><Name>" + packageName.toUtf8() + "</Name>"
+                "<Version>1.0.0</Version><ReleaseDate>2015-01-01</ReleaseDate><SHA1>"
+                + QCryptographicHash::hash(archive, QCryptographicHash::Sha1).toHex()
+                + "</SHA1>" + packageElements + "</PackageUpdate>";
+            m_server.files.insert("/repo/" + packageName.toUtf8() + "/1.0.0meta.7z", archive);
+        }
+        m_server.files.insert("/repo/Updates.xml", updatesXml + "</Updates>");
+        m_server.requests.clear();
+    }
+
+    void runJob(PackageManagerCore *core, MetadataJob *job)
+    {
+        core->settings().setDefaultRepositories(QSet<Repository>() << Repository(m_url, true));
+        job->setAutoDelete(false);
+        job->setPackageManagerCore(core);
+        job->start();
+        job->waitForFinished();
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QInstaller::init();
+        QStandardPaths::setTestModeEnabled(true);
+
+        m_cacheRoot = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + QLatin1String("/metadata");
+        QVERIFY(QDir(m_cacheRoot).removeRecursively());
+
+        QVERIFY(m_server.listen(QHostAddress::LocalHost));
+        m_url = QUrl(QString::fromLatin1("http://127.0.0.1:%1/repo").arg(m_server.serverPort()));
+
+        foreach (const QString &packageName, QStringList() << "A" << "B") {
+            m_archives.insert(packageName, createMetaArchive(packageName));
+            QVERIFY(!m_archives.value(packageName).isEmpty());
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        QDir(m_cacheRoot).removeRecursively();
+    }
+
+    void testNotModifiedReusesCache()
+    {
+        publishRepository(QStringList() << "A");
+        PackageManagerCore core(BinaryContent::MagicInstallerMarker, QList<OperationBlob>());
+
+        QString directory;
+        {
+            MetadataJob job;
+            runJob(&core, &job);
+            QCOMPARE(job.error(), int(KDJob::NoError));
+            QCOMPARE(job.metadata().count(), 1);
+
+            directory = job.metadata().first().directory;
+            QVERIFY(directory.startsWith(m_cacheRoot));
+            QVERIFY(QFileInfo(directory + QLatin1String("/A/package.xml")).exists());
+            QCOMPARE(m_server.requests, QList<Request>() << Request("/repo/Updates.xml", 200)
+                << Request("/repo/A/1.0.0meta.7z", 200));
+        }
+
+        m_server.requests.clear();
+        MetadataJob job;
+        runJob(&core, &job);
+        QCOMPARE(job.error(), int(KDJob::NoError));
+
+        // Updates.xml did not change, neither it nor the meta data is downloaded again
+        QCOMPARE(m_server.requests, QList<Request>() << Request("/repo/Updates.xml", 304));
+        QCOMPARE(job.metadata().count(), 1);
+        QCOMPARE(job.metadata().first().directory, directory);
+        QVERIFY(QFileInfo(directory + QLatin1String("/Updates.xml")).exists());
+        QVERIFY(QFileInfo(directory + QLatin1String("/A/package.xml")).exists());
+    }
+
+    void testPruneRemovedPackages()
+    {
+        publishRepository(QStringList() << "B");
+        PackageManagerCore core(BinaryContent::MagicInstallerMarker, QList<OperationBlob>());
+
+        MetadataJob job;
+        runJob(&core, &job);
+        QCOMPARE(job.error(), int(KDJob::NoError));
+        QCOMPARE(m_server.requests, QList<Request>() << Request("/repo/Updates.xml", 200)
+            << Request("/repo/B/1.0.0meta.7z", 200));
+
+        const QString directory = job.metadata().first().directory;
+        QVERIFY(QFileInfo(directory + QLatin1String("/B/package.xml")).exists());
+        QVERIFY(!QFileInfo(directory + QLatin1String("/A")).exists());
+
+        const QSettings cache(directory + QLatin1String("/cache.ini"), QSettings::IniFormat);
+        QVERIFY(!cache.contains(QLatin1String("Packages/A/SHA1")));
+        QVERIFY(cache.contains(QLatin1String("Packages/B/SHA1")));
+    }
+
+    void testCacheInUse()
+    {
+        publishRepository(QStringList() << "B");
+        PackageManagerCore core(BinaryContent::MagicInstallerMarker, QList<OperationBlob>());
+
+        // the first job keeps the cache locked while its meta data is in use
+        MetadataJob job;
+        runJob(&core, &job);
+        QCOMPARE(job.error(), int(KDJob::NoError));
+        QVERIFY(job.metadata().first().directory.startsWith(m_cacheRoot));
+
+        MetadataJob secondJob;
+        runJob(&core, &secondJob);
+        QCOMPARE(secondJob.error(), int(KDJob::NoError));
+        QCOMPARE(secondJob.metadata().count(), 1);
+
+        const QString directory = secondJob.metadata().first().directory;
+        QVERIFY(!directory.startsWith(m_cacheRoot));
+        QVERIFY(QFileInfo(directory + QLatin1String("/B/package.xml")).exists());
+    }
+
+    void testArchivesNotInCache()
+    {
+        publishRepository(QStringList() << "A", "<Default>true</Default>"
+            "<DownloadableArchives>data.7z</DownloadableArchives>");
+        const QByteArray data = "payload";
+        m_server.files.insert("/repo/A/1.0.0data.7z", data);
+        m_server.files.insert("/repo/A/1.0.0data.7z.sha1",
+            QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+
+        PackageManagerCore core(BinaryContent::MagicInstallerMarker, QList<OperationBlob>());
+        core.settings().setDefaultRepositories(QSet<Repository>() << Repository(m_url, true));
+        QVERIFY(core.fetchRemotePackagesTree());
+        QVERIFY(core.componentByName("A"));
+        QVERIFY(core.componentByName("A")->localTempPath().startsWith(m_cacheRoot));
+
+        QVERIFY(core.calculateComponentsToInstall());
+        QCOMPARE(core.downloadNeededArchives(1.0), 1);
+        QVERIFY(m_server.requests.contains(Request("/repo/A/1.0.0data.7z", 200)));
+
+        // the payload archives are downloaded to a temporary directory, the cache keeps the
+        // meta data only
+        const QStringList metaFiles = QStringList() << "Updates.xml" << "cache.ini"
+            << "package.xml";
+        QDirIterator it(m_cacheRoot, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            QVERIFY2(metaFiles.contains(it.fileName()), qPrintable(it.filePath()));
+        }
+    }
+
+private:
+    HttpServer m_server;
+    QUrl m_url;
+    QString m_cacheRoot;
+    QHash<QString, QByteArray> m_archives;
+};
+
+QTEST_MAIN(tst_MetadataJob)
+
+#include "tst_metadatajob.moc"
@@ -0,0 +1,8 @@
+include(../../qttest.pri)
+
+QT -= gui
+QT += xml
+
+DEFINES += REPOGEN_PATH=\\\"$$IFW_APP_PATH/repogen\\\"
+
+SOURCES += tst_repogen.cpp
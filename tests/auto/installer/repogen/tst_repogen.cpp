@@ -0,0 +1,255 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QDomDocument>
+#include <QProcess>
+#include <QRegExp>
+#include <QTemporaryDir>
+#include <QTest>
+
+#ifdef Q_OS_UNIX
+#include <utime.h>
+#endif
+
+static const qint64 scOldTime = 1000000000;
+
+// Runs repogen over the same packages into a full and an incremental repository and checks that
+// the incremental one matches the full one while only changed components get regenerated.
+class tst_Repogen : public QObject
+{
+    Q_OBJECT
+
+private:
+    void writeFile(const QString &fileName, const QByteArray &content)
+    {
+        QVERIFY(QDir().mkpath(QFileInfo(fileName).absolutePath()));
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(content), qint64(content.size()));
+    }
+
+    void createPackage(const QString &name, const QByteArray &data)
+    {
+        const QString packageDir = m_packagesDir + QLatin1Char('/') + name;
+        writeFile(packageDir + QLatin1String("/meta/package.xml"), "<?xml version=\"1.0\"?>"
+            "<Package><DisplayName>" + name.toUtf8() + "</DisplayName>"
+            "<Description>Component " + name.toUtf8() + "</Description>"
+            "<Version>1.0.0</Version><ReleaseDate>2015-01-01</ReleaseDate></Package>");
+        writeFile(packageDir + QLatin1String("/data/file.txt"), data);
+    }
+
+    int runRepogen(const QStringList &arguments, QByteArray *output = 0)
+    {
+        QProcess process;
+        process.setProcessChannelMode(QProcess::MergedChannels);
+        process.start(QLatin1String(REPOGEN_PATH), QStringList() << QLatin1String("-p")
+            << m_packagesDir << arguments);
+        if (!process.waitForFinished(120000))
+            return -1;
+        if (output)
+            *output = process.readAll();
+        return process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+    }
+
+    // The meta data archives are created from freshly copied files, so their checksums differ
+    // between runs. They are checked against the archives in the repository instead.
+    QByteArray updatesXmlWithoutChecksums(const QString &repositoryDir)
+    {
+        QFile file(repositoryDir + QLatin1String("/Updates.xml"));
+        if (!file.open(QIODevice::ReadOnly))
+            return QByteArray();
+        const QRegExp checksum(QLatin1String("<SHA1>[^<]*</SHA1>"));
+        return QString::fromUtf8(file.readAll()).replace(checksum, QLatin1String("<SHA1/>"))
+            .toUtf8();
+    }
+
+    void verifyMetaChecksums(const QString &repositoryDir)
+    {
+        QFile file(repositoryDir + QLatin1String("/Updates.xml"));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QDomDocument doc;
+        QVERIFY(doc.setContent(&file));
+
+        const QDomNodeList packages = doc.documentElement()
+            .elementsByTagName(QLatin1String("PackageUpdate"));
+        QVERIFY(packages.count() > 0);
+        for (int i = 0; i < packages.count(); ++i) {
+            const QDomElement package = packages.at(i).toElement();
+            const QString name = package.firstChildElement(QLatin1String("Name")).text();
+            const QString version = package.firstChildElement(QLatin1String("Version")).text();
+
+            QFile metaArchive(QString::fromLatin1("%1/%2/%3meta.7z").arg(repositoryDir, name,
+                version));
+            QVERIFY2(metaArchive.open(QIODevice::ReadOnly), qPrintable(metaArchive.fileName()));
+            QCOMPARE(package.firstChildElement(QLatin1String("SHA1")).text().toLatin1(),
+                QCryptographicHash::hash(metaArchive.readAll(), QCryptographicHash::Sha1).toHex());
+        }
+    }
+
+    // Sets the modification time of all files of a component to a fixed time in the past, so
+    // that a rewritten file can be told apart.
+    void resetModificationTimes(const QString &directory)
+    {
+#ifdef Q_OS_UNIX
+        QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            struct utimbuf times;
+            times.actime = times.modtime = scOldTime;
+            QCOMPARE(::utime(QFile::encodeName(it.next()).constData(), &times), 0);
+        }
+#else
+        Q_UNUSED(directory)
+#endif
+    }
+
+    bool isRewritten(const QString &directory)
+    {
+#ifdef Q_OS_UNIX
+        QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            if (QFileInfo(it.next()).lastModified().toTime_t() != scOldTime)
+                return true;
+        }
+        return false;
+#else
+        return QFileInfo(directory + QLatin1String("/.untouched")).exists() == false;
+#endif
+    }
+
+    void markUntouched(const QString &directory)
+    {
+#ifndef Q_OS_UNIX
+        writeFile(directory + QLatin1String("/.untouched"), QByteArray());
+#endif
+        resetModificationTimes(directory);
+    }
+
+    void compareWithFullRun(const QString &name)
+    {
+        const QString fullDir = m_dir.path() + QLatin1String("/full-") + name;
+        QCOMPARE(runRepogen(QStringList() << fullDir), 0);
+        QCOMPARE(updatesXmlWithoutChecksums(m_incrementalDir), updatesXmlWithoutChecksums(fullDir));
+        verifyMetaChecksums(m_incrementalDir);
+        verifyMetaChecksums(fullDir);
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_dir.isValid());
+        m_packagesDir = m_dir.path() + QLatin1String("/packages");
+        m_incrementalDir = m_dir.path() + QLatin1String("/incremental");
+
+        createPackage(QLatin1String("A"), "content of A");
+        createPackage(QLatin1String("B"), "content of B");
+        createPackage(QLatin1String("C"), "content of C");
+    }
+
+    void firstRun()
+    {
+        QCOMPARE(runRepogen(QStringList() << QLatin1String("--incremental") << m_incrementalDir),
+            0);
+        QVERIFY(QFileInfo(m_incrementalDir + QLatin1String("/.repogen-manifest")).exists());
+        compareWithFullRun(QLatin1String("first"));
+    }
+
+    void unchangedPackages()
+    {
+        foreach (const QString &name, QStringList() << "A" << "B" << "C")
+            markUntouched(m_incrementalDir + QLatin1Char('/') + name);
+
+        // the manifest written by the last run is read back, nothing needs to be regenerated
+        QByteArray output;
+        QCOMPARE(runRepogen(QStringList() << QLatin1String("--incremental") << m_incrementalDir,
+            &output), 0);
+        QVERIFY2(output.contains("Regenerating 0 of 3 components."), output.constData());
+        foreach (const QString &name, QStringList() << "A" << "B" << "C")
+            QVERIFY2(!isRewritten(m_incrementalDir + QLatin1Char('/') + name), qPrintable(name));
+        compareWithFullRun(QLatin1String("unchanged"));
+    }
+
+    void changedPackage()
+    {
+        foreach (const QString &name, QStringList() << "A" << "B" << "C")
+            markUntouched(m_incrementalDir + QLatin1Char('/') + name);
+        createPackage(QLatin1String("B"), "changed content of B");
+
+        QByteArray output;
+        QCOMPARE(runRepogen(QStringList() << QLatin1String("--incremental") << m_incrementalDir,
+            &output), 0);
+        QVERIFY2(output.contains("Regenerating 1 of 3 components."), output.constData());
+        QVERIFY(!isRewritten(m_incrementalDir + QLatin1String("/A")));
+        QVERIFY(isRewritten(m_incrementalDir + QLatin1String("/B")));
+        QVERIFY(!isRewritten(m_incrementalDir + QLatin1String("/C")));
+        compareWithFullRun(QLatin1String("changed"));
+    }
+
+    void removedPackage()
+    {
+        QVERIFY(QDir(m_packagesDir + QLatin1String("/C")).removeRecursively());
+
+        QCOMPARE(runRepogen(QStringList() << QLatin1String("--incremental") << m_incrementalDir),
+            0);
+        QVERIFY(!QFileInfo(m_incrementalDir + QLatin1String("/C")).exists());
+        QVERIFY(!updatesXmlWithoutChecksums(m_incrementalDir).contains("<Name>C</Name>"));
+        compareWithFullRun(QLatin1String("removed"));
+    }
+
+    void nonEmptyRepositoryDirectory()
+    {
+        const QString repositoryDir = m_dir.path() + QLatin1String("/other");
+        writeFile(repositoryDir + QLatin1String("/unrelated.txt"), "data");
+
+        // only a folder written by an earlier incremental run may be updated
+        QVERIFY(runRepogen(QStringList() << repositoryDir) != 0);
+        QVERIFY(runRepogen(QStringList() << QLatin1String("--incremental") << repositoryDir) != 0);
+        QVERIFY(!QFileInfo(repositoryDir + QLatin1String("/A")).exists());
+
+        QVERIFY(runRepogen(QStringList() << m_incrementalDir) != 0);
+        QCOMPARE(runRepogen(QStringList() << QLatin1String("--incremental") << m_incrementalDir),
+            0);
+    }
+
+private:
+    QTemporaryDir m_dir;
+    QString m_packagesDir;
+    QString m_incrementalDir;
+};
+
+QTEST_MAIN(tst_Repogen)
+
+#include "tst_repogen.moc"
@@ -74,6 +74,8 @@ void tst_Settings::loadTutorialConfig()
     QCOMPARE(settings.allowNonAsciiCharacters(), false);
     QCOMPARE(settings.createLocalRepository(), false);
     QCOMPARE(settings.installActionColumnVisible(), false);
+    QCOMPARE(settings.maxConcurrentDownloads(), 6);
+    QCOMPARE(settings.maxConcurrentDownloadsPerHost(), 4);
 
     QCOMPARE(settings.hasReplacementRepos(), false);
     QCOMPARE(settings.repositories(), QSet<Repository>());
@@ -92,6 +94,8 @@ void tst_Settings::loadTutorialConfig()
 void tst_Settings::loadFullConfig()
 {
     Settings settings = Settings::fromFileAndPrefix(":///data/full_config.xml", ":///data");
+    QCOMPARE(settings.maxConcurrentDownloads(), 8);
+    QCOMPARE(settings.maxConcurrentDownloadsPerHost(), 2);
 }
 
 void tst_Settings::loadEmptyConfig()
@@ -171,6 +171,28 @@ private slots:
                     << (QList<int>()
                         << InstallerCalculator::Dependent
                         << InstallerCalculator::Resolved);
+
+        core = new PackageManagerCore();
+        core->setPackageManager();
+        NamedComponent *componentC = new NamedComponent(core, QLatin1String("C"));
+        NamedComponent *componentD = new NamedComponent(core, QLatin1String("D"));
+        componentD->setValue(QLatin1String("AutoDependOn"), QLatin1String("C"));
+        NamedComponent *componentE = new NamedComponent(core, QLatin1String("E"));
+        componentE->setValue(QLatin1String("AutoDependOn"), QLatin1String("C, D"));
+        NamedComponent *componentF = new NamedComponent(core, QLatin1String("F"));
+        componentF->setValue(QLatin1String("AutoDependOn"), QLatin1String("G"));
+        core->appendRootComponent(componentE);
+        core->appendRootComponent(componentD);
+        core->appendRootComponent(componentC);
+        core->appendRootComponent(componentF);
+
+        QTest::newRow("Installer auto dependencies") << core
+                    << (QList<Component *>() << componentC)
+                    << (QList<Component *>() << componentC << componentD << componentE)
+                    << (QList<int>()
+                        << InstallerCalculator::Selected
+                        << InstallerCalculator::Automatic
+                        << InstallerCalculator::Automatic);
     }
 
     void resolveInstaller()
@@ -192,6 +214,38 @@ private slots:
         delete core;
     }
 
+    void componentByName()
+    {
+        PackageManagerCore core;
+        core.setPackageManager();
+        NamedComponent *componentA = new NamedComponent(&core, QLatin1String("A"), "1.0.0");
+        NamedComponent *componentAA = new NamedComponent(&core, QLatin1String("A.A"), "2.1.0");
+        componentA->appendComponent(componentAA);
+        core.appendRootComponent(componentA);
+
+        QCOMPARE(core.componentByName(QLatin1String("A")), componentA);
+        QCOMPARE(core.componentByName(QLatin1String("A.A")), componentAA);
+        QCOMPARE(core.componentByName(QLatin1String("A.A->=2.0")), componentAA);
+        QCOMPARE(core.componentByName(QLatin1String("A.A-<2.0")), static_cast<Component *>(0));
+        QCOMPARE(core.componentByName(QLatin1String("B")), static_cast<Component *>(0));
+
+        // the index follows components added after the first lookup
+        NamedComponent *componentB = new NamedComponent(&core, QLatin1String("B"));
+        core.appendRootComponent(componentB);
+        QCOMPARE(core.componentByName(QLatin1String("B-1.0.0")), componentB);
+
+        const QList<Component *> components
+            = core.components(PackageManagerCore::ComponentType::AllNoReplacements);
+        const QHash<QString, QList<Component *> > index
+            = PackageManagerCore::componentIndex(components);
+        QCOMPARE(index.count(), components.count());
+        foreach (Component *component, components) {
+            QCOMPARE(PackageManagerCore::componentByName(component->name(), index), component);
+            QCOMPARE(PackageManagerCore::componentByName(component->name(), components),
+                component);
+        }
+    }
+
     void resolveUninstaller_data()
     {
         QTest::addColumn<PackageManagerCore *>("core");
@@ -237,6 +291,48 @@ private slots:
                     << (QList<Component *>() << compA)
                     << (QList<Component *>() << compB)
                     << (QSet<Component *>() << compA << compB);
+
+        core = new PackageManagerCore();
+        core->setPackageManager();
+        compA = new NamedComponent(core, QLatin1String("A"), QLatin1String("1.0.0"));
+        compB = new NamedComponent(core, QLatin1String("B"));
+        compC = new NamedComponent(core, QLatin1String("C"));
+        compB->addDependency(QLatin1String("A->=2.0"));
+        compC->addDependency(QLatin1String("A-1.0.0"));
+        core->appendRootComponent(compA);
+        core->appendRootComponent(compB);
+        core->appendRootComponent(compC);
+        compA->setInstalled();
+        compB->setInstalled();
+        compC->setInstalled();
+
+        QTest::newRow("Versioned dependencies") << core
+                    << (QList<Component *>() << compA)
+                    << (QList<Component *>() << compA << compB << compC)
+                    << (QSet<Component *>() << compA << compC);
+
+        core = new PackageManagerCore();
+        core->setPackageManager();
+        NamedComponent *compD = new NamedComponent(core, QLatin1String("D"));
+        NamedComponent *compE = new NamedComponent(core, QLatin1String("E"));
+        NamedComponent *compF = new NamedComponent(core, QLatin1String("F"));
+        NamedComponent *compG = new NamedComponent(core, QLatin1String("G"));
+        compE->setValue(QLatin1String("AutoDependOn"), QLatin1String("D, X"));
+        compF->setValue(QLatin1String("Replaces"), QLatin1String("X"));
+        compG->setValue(QLatin1String("AutoDependOn"), QLatin1String("D, Y"));
+        core->appendRootComponent(compD);
+        core->appendRootComponent(compE);
+        core->appendRootComponent(compF);
+        core->appendRootComponent(compG);
+        compD->setInstalled();
+        compE->setInstalled();
+        compF->setInstalled();
+        compG->setInstalled();
+
+        QTest::newRow("Auto dependencies") << core
+                    << (QList<Component *>() << compD)
+                    << (QList<Component *>() << compD << compE << compF << compG)
+                    << (QSet<Component *>() << compD << compG);
     }
 
     void resolveUninstaller()
@@ -36,15 +36,65 @@
 #include <downloadfiletask.h>
 #include <fileio.h>
 
+#include <QEventLoop>
 #include <QFutureWatcher>
 #include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
 #include <QTest>
 #include <QTemporaryFile>
+#include <QTimer>
 
 using namespace QInstaller;
 
 static const qint64 scLargeSize = 4194304LL;
 
+// Answers every request with the same body after a short delay, so that downloads overlap, and
+// records the peak number of connections served at the same time.
+class HttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    HttpServer()
+        : peakConnections(0)
+        , m_openConnections(0)
+    {
+        connect(this, SIGNAL(newConnection()), this, SLOT(handleConnection()));
+    }
+
+    QByteArray body;
+    int peakConnections;
+
+private slots:
+    void handleConnection()
+    {
+        while (QTcpSocket *socket = nextPendingConnection()) {
+            peakConnections = qMax(peakConnections, ++m_openConnections);
+            connect(socket, SIGNAL(readyRead()), this, SLOT(handleRequest()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void handleRequest()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+        if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n"))
+            return; // wait for the complete header
+        socket->readAll();
+
+        QTimer::singleShot(50, socket, [this, socket]() {
+            --m_openConnections;
+            socket->write("HTTP/1.1 200 OK\r\nContent-Length: " + QByteArray::number(body.size())
+                + "\r\nConnection: close\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        });
+    }
+
+private:
+    int m_openConnections;
+};
+
 class tst_Task : public QObject
 {
     Q_OBJECT
@@ -117,6 +167,42 @@ private slots:
             QCOMPARE(result.checkSum().toHex(), QByteArray("85304f87b8d90554a63c6f6d1e9cc974fbef8d32"));
         }
     }
+
+    void downloadFilesQueued()
+    {
+        HttpServer server;
+        server.body = QByteArray(scLargeSize / 4, '1');
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+
+        QList<FileTaskItem> items;
+        for (int i = 0; i < 5; ++i) {
+            items.append(FileTaskItem(QString::fromLatin1("http://127.0.0.1:%1/file%2")
+                .arg(server.serverPort()).arg(i)));
+        }
+
+        DownloadFileTask fileTask(items);
+        fileTask.setMaxConcurrentDownloads(2);
+        QCOMPARE(fileTask.maxConcurrentDownloads(), 2);
+
+        // the server lives in this thread, keep its events going while the task runs
+        QEventLoop loop;
+        QFutureWatcher<FileTaskResult> watcher;
+        connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+        watcher.setFuture(QtConcurrent::run(&DownloadFileTask::doTask, &fileTask));
+        if (!watcher.isFinished())
+            loop.exec();
+
+        QVERIFY(server.peakConnections > 0);
+        QVERIFY(server.peakConnections <= fileTask.maxConcurrentDownloads());
+
+        QCOMPARE(watcher.future().resultCount(), items.count());
+        foreach (const FileTaskResult &result, watcher.future().results()) {
+            QVERIFY(QFile(result.target()).exists());
+            QCOMPARE(QFile(result.target()).size(), scLargeSize / 4);
+            QCOMPARE(result.checkSum().toHex(), QByteArray("cfd58e1a75412012542791cdbb9f6c4242bc0908"));
+            QFile::remove(result.target());
+        }
+    }
 };
 
 QTEST_MAIN(tst_Task)
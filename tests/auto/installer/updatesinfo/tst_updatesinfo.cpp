@@ -0,0 +1,200 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+
+#include <kdupdaterupdatesinfo_p.h>
+
+#include <QTemporaryDir>
+#include <QTest>
+
+#ifdef Q_OS_UNIX
+#include <utime.h>
+#endif
+
+using namespace KDUpdater;
+
+class tst_UpdatesInfo : public QObject
+{
+    Q_OBJECT
+
+private:
+    void writeFile(const QString &fileName, const QByteArray &content)
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QCOMPARE(file.write(content), qint64(content.size()));
+    }
+
+    void resetModificationTime(const QString &fileName)
+    {
+#ifdef Q_OS_UNIX
+        struct utimbuf times;
+        times.actime = times.modtime = 1000000000;
+        QCOMPARE(::utime(QFile::encodeName(fileName).constData(), &times), 0);
+#else
+        Q_UNUSED(fileName)
+#endif
+    }
+
+private slots:
+    void init()
+    {
+        UpdatesInfo::clearCache();
+    }
+
+    void parse()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/Updates.xml");
+        writeFile(fileName, "<Updates>"
+            "<ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion>"
+            "<Checksum>False</Checksum>"
+            "<PackageUpdate><Name>A</Name><Version>1.0.0</Version>"
+            "<ReleaseDate>2015-01-01</ReleaseDate><SHA1>abc</SHA1></PackageUpdate>"
+            "<RepositoryUpdate>"
+            "<Repository action=\"add\" url=\"http://example.com\" displayname=\"Example\"/>"
+            "</RepositoryUpdate>"
+            "</Updates>");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QCOMPARE(info.error(), UpdatesInfo::NoError);
+        QCOMPARE(info.applicationName(), QString("{AnyApplication}"));
+        QCOMPARE(info.checksum(), QString("False"));
+
+        QCOMPARE(info.updateInfoCount(), 1);
+        QCOMPARE(info.updateInfo(0).data.value("Name").toString(), QString("A"));
+        QCOMPARE(info.updateInfo(0).data.value("SHA1").toString(), QString("abc"));
+
+        const QList<RepositoryUpdateInfo> repositories = info.repositoryUpdates();
+        QCOMPARE(repositories.count(), 1);
+        QCOMPARE(repositories.first().attributes.value("action"), QString("add"));
+        QCOMPARE(repositories.first().attributes.value("url"), QString("http://example.com"));
+        QCOMPARE(repositories.first().lineNumber, qint64(1));
+    }
+
+    void sharedParse()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/Updates.xml");
+        writeFile(fileName, "<Updates><ApplicationName>A</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion></Updates>");
+
+        UpdatesInfo first;
+        first.setFileName(fileName);
+        QCOMPARE(first.error(), UpdatesInfo::NoError);
+
+        // a second reader shares the already parsed data
+        UpdatesInfo second;
+        second.setFileName(fileName);
+        QCOMPARE(second.error(), UpdatesInfo::NoError);
+        QCOMPARE(second.applicationName(), QString("A"));
+
+        // a changed file is parsed again
+        writeFile(fileName, "<Updates><ApplicationName>Changed</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion></Updates>");
+        UpdatesInfo third;
+        third.setFileName(fileName);
+        QCOMPARE(third.applicationName(), QString("Changed"));
+        QCOMPARE(first.applicationName(), QString("A"));
+    }
+
+    void changedContentSameTimestamp()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/Updates.xml");
+        writeFile(fileName, "<Updates><ApplicationName>A</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion></Updates>");
+        resetModificationTime(fileName);
+
+        UpdatesInfo first;
+        first.setFileName(fileName);
+        QCOMPARE(first.applicationName(), QString("A"));
+
+        // same size, and on Unix the same modification time as well
+        writeFile(fileName, "<Updates><ApplicationName>B</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion></Updates>");
+        resetModificationTime(fileName);
+
+        UpdatesInfo second;
+        second.setFileName(fileName);
+        QCOMPARE(second.applicationName(), QString("B"));
+    }
+
+    void checksumElement()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/Updates.xml");
+        writeFile(fileName, "<Updates><ApplicationName>A</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion><Checksum/></Updates>");
+
+        // an empty element disables the checksum test, so it must not look like a missing one
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QCOMPARE(info.error(), UpdatesInfo::NoError);
+        QVERIFY(!info.checksum().isNull());
+        QVERIFY(info.checksum().isEmpty());
+
+        writeFile(fileName, "<Updates><ApplicationName>A</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion></Updates>");
+        info.setFileName(dir.path() + QLatin1String("/Other.xml"));
+        info.setFileName(fileName);
+        QCOMPARE(info.error(), UpdatesInfo::NoError);
+        QVERIFY(info.checksum().isNull());
+    }
+
+    void invalidXml()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1String("/Updates.xml");
+        writeFile(fileName, "<Updates><ApplicationName>A</ApplicationName>");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QCOMPARE(info.error(), UpdatesInfo::InvalidXmlError);
+
+        info.setFileName(dir.path() + QLatin1String("/Missing.xml"));
+        QCOMPARE(info.error(), UpdatesInfo::CouldNotReadUpdateInfoFileError);
+    }
+};
+
+QTEST_MAIN(tst_UpdatesInfo)
+
+#include "tst_updatesinfo.moc"
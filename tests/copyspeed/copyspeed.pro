@@ -0,0 +1,13 @@
+TEMPLATE = app
+INCLUDEPATH += . ..
+TARGET = copyspeed
+
+include(../../installerfw.pri)
+
+QT -= gui
+
+CONFIG += console
+
+SOURCES += main.cpp
+
+macx:include(../../no_app_bundle.pri)
@@ -0,0 +1,168 @@
+/**************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** As a special exception, The Qt Company gives you certain additional
+** rights. These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <errors.h>
+#include <fileio.h>
+#include <fileutils.h>
+#include <remoteclient.h>
+#include <remotefileengine.h>
+#include <remoteserver.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QUuid>
+
+// Compares the copy methods of QInstaller::blockingCopy(). Sizes are given in MiB, the files are
+// created inside the temporary directory (set TMPDIR to benchmark another disk).
+// Example: copyspeed 100 1024 10240
+//
+// With --remote the target files are additionally written through the remote file engine, the
+// way an installer writes files with elevated rights. The server runs inside this process.
+// Example: copyspeed --remote 1024
+
+static void createSourceFile(QFileDevice *file, qint64 size)
+{
+    QByteArray block(4 * 1024 * 1024, Qt::Uninitialized);
+    for (int i = 0; i < block.size(); ++i)
+        block[i] = char(qrand());
+
+    while (size > 0) {
+        const qint64 length = qMin<qint64>(size, block.size());
+        QInstaller::blockingWrite(file, block.constData(), length);
+        size -= length;
+    }
+    file->flush();
+}
+
+static void benchmark(QFileDevice *source, qint64 size, QInstaller::CopyMethod method,
+    const char *name)
+{
+    QTemporaryFile target;
+    if (!target.open()) {
+        qDebug() << "Could not create target file:" << target.errorString();
+        return;
+    }
+
+    source->seek(0);
+    QElapsedTimer timer;
+    timer.start();
+    QInstaller::blockingCopy(source, &target, size, method);
+    target.flush();
+    const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+
+    qDebug().noquote() << QString::fromLatin1("%1: %2 ms, %3/sec").arg(QLatin1String(name))
+        .arg(elapsed).arg(QInstaller::humanReadableSize(size * 1000 / elapsed));
+}
+
+static void benchmarkRemote(QFileDevice *source, qint64 size)
+{
+    QFile target(QDir::temp().filePath(QLatin1String("copyspeed-")
+        + QUuid::createUuid().toString()));
+    {
+        QInstaller::RemoteFileEngineHandler handler;
+        QInstaller::openForWrite(&target);
+
+        source->seek(0);
+        QElapsedTimer timer;
+        timer.start();
+        QInstaller::blockingCopy(source, &target, size);
+        target.close();
+        const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+
+        qDebug().noquote() << QString::fromLatin1("Remote: %1 ms, %2/sec").arg(elapsed)
+            .arg(QInstaller::humanReadableSize(size * 1000 / elapsed));
+    }
+    target.remove();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QStringList sizes = a.arguments().mid(1);
+    const bool remote = sizes.removeAll(QLatin1String("--remote")) > 0;
+    if (sizes.isEmpty())
+        sizes << QLatin1String("100");
+
+    QInstaller::RemoteServer server;
+    if (remote) {
+        const QString socketName = QUuid::createUuid().toString();
+        const QString key = QUuid::createUuid().toString();
+        server.init(socketName, key, QInstaller::Protocol::Mode::Production);
+        server.start();
+        QInstaller::RemoteClient::instance().init(socketName, key,
+            QInstaller::Protocol::Mode::Debug, QInstaller::Protocol::StartAs::User);
+        QInstaller::RemoteClient::instance().setActive(true);
+    }
+
+    try {
+        foreach (const QString &sizeString, sizes) {
+            bool ok = false;
+            const qint64 size = sizeString.toLongLong(&ok) * 1024 * 1024;
+            if (!ok || size <= 0) {
+                qDebug() << "Invalid size:" << sizeString;
+                return EXIT_FAILURE;
+            }
+
+            QTemporaryFile source;
+            if (!source.open()) {
+                qDebug() << "Could not create source file:" << source.errorString();
+                return EXIT_FAILURE;
+            }
+            createSourceFile(&source, size);
+
+            qDebug().noquote() << QString::fromLatin1("Copying %1:")
+                .arg(QInstaller::humanReadableSize(size));
+            benchmark(&source, size, QInstaller::BufferedCopy, "Buffered");
+            benchmark(&source, size, QInstaller::DoubleBufferedCopy, "Double buffered");
+            benchmark(&source, size, QInstaller::KernelCopy, "Kernel");
+            benchmark(&source, size, QInstaller::AutoCopy, "Auto");
+            if (remote)
+                benchmarkRemote(&source, size);
+        }
+    } catch (const QInstaller::Error &error) {
+        qDebug() << error.message();
+        return EXIT_FAILURE;
+    }
+
+    if (remote) {
+        QInstaller::RemoteClient::instance().setActive(false);
+        QInstaller::RemoteClient::instance().shutdown();
+    }
+
+    return EXIT_SUCCESS;
+}
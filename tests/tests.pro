@@ -3,5 +3,6 @@ TEMPLATE = subdirs
 
 SUBDIRS = \
         auto \
+        copyspeed \
         downloadspeed \
         environmentvariable
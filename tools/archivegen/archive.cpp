@@ -50,7 +50,10 @@ using namespace QInstaller;
 static void printUsage()
 {
     std::cout << "Usage: " << QFileInfo(QCoreApplication::applicationFilePath()).fileName()
-        << " directory.7z [files | directories]" << std::endl;
+        << " [options] directory.7z [files | directories]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    QInstallerTools::printCompressionOptions();
 }
 
 int main(int argc, char *argv[])
@@ -58,15 +61,29 @@ int main(int argc, char *argv[])
     try {
         QCoreApplication app(argc, argv);
 
-        if (app.arguments().count() < 3) {
+        QStringList args = app.arguments().mid(1);
+        Lib7z::CompressionOptions options;
+        while (!args.isEmpty() && QInstallerTools::isCompressionOption(args.first())) {
+            const QString option = args.takeFirst();
+            QString error;
+            if (args.isEmpty() || !QInstallerTools::parseCompressionOption(option, args.takeFirst(),
+                &options, &error)) {
+                    std::cerr << (error.isEmpty() ? QString::fromLatin1("Error: %1 parameter missing "
+                        "argument.").arg(option) : error) << std::endl << std::endl;
+                    printUsage();
+                    return EXIT_FAILURE;
+            }
+        }
+
+        if (args.count() < 2) {
             printUsage();
             return EXIT_FAILURE;
         }
 
         QInstaller::init();
         QInstaller::setVerbose(true);
-        const QStringList sourceDirectories = app.arguments().mid(2);
-        QInstallerTools::compressPaths(sourceDirectories, app.arguments().at(1));
+        const QStringList sourceDirectories = args.mid(1);
+        QInstallerTools::compressPaths(sourceDirectories, args.first(), options);
         return EXIT_SUCCESS;
     } catch (const Lib7z::SevenZipException &e) {
         std::cerr << "caught 7zip exception: " << e.message() << std::endl;
@@ -562,6 +562,7 @@ int main(int argc, char **argv)
     QStringList filteredPackages;
     QInstallerTools::FilterType ftype = QInstallerTools::Exclude;
     bool compileResource = false;
+    Lib7z::CompressionOptions compressionOptions;
 
     const QStringList args = app.arguments().mid(1);
     for (QStringList::const_iterator it = args.begin(); it != args.end(); ++it) {
@@ -649,6 +650,16 @@ int main(int argc, char **argv)
                 continue;
         } else if (*it == QLatin1String("-rcc") || *it == QLatin1String("--compile-resource")) {
             compileResource = true;
+        } else if (QInstallerTools::isCompressionOption(*it)) {
+            const QString option = *it;
+            ++it;
+            if (it == args.end()) {
+                return printErrorAndUsageAndExit(QString::fromLatin1("Error: %1 parameter missing "
+                    "argument.").arg(option));
+            }
+            QString error;
+            if (!QInstallerTools::parseCompressionOption(option, *it, &compressionOptions, &error))
+                return printErrorAndUsageAndExit(error);
         } else {
             if (it->startsWith(QLatin1String("-"))) {
                 return printErrorAndUsageAndExit(QString::fromLatin1("Error: Unknown option \"%1\" used. Maybe you "
@@ -709,7 +720,8 @@ int main(int argc, char **argv)
         // 2; copy the packages data and setup the packages vector with the files we copied,
         //    must happen before copying meta data because files will be compressed if
         //    needed and meta data generation relies on this
-        QInstallerTools::copyComponentData(packagesDirectories, tmpRepoDir, &packages);
+        QInstallerTools::copyComponentData(packagesDirectories, tmpRepoDir, &packages,
+            compressionOptions);
 
         // 3; copy the meta data of the available packages, generate Updates.xml
         QInstallerTools::copyMetaData(tmpMetaDir, tmpRepoDir, packages, settings
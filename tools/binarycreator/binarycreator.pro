@@ -5,7 +5,7 @@ INCLUDEPATH += . .. rcc ../common
 include(../../installerfw.pri)
 
 QT -= gui
-QT += qml xml
+QT += concurrent qml xml
 
 !minQtVersion(5,4,0): QTPLUGIN += qtaccessiblewidgets
 
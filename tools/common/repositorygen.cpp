@@ -45,11 +45,17 @@
 
 #include <kdupdater.h>
 
+#include <QtConcurrentRun>
+
+#include <QtCore/QDataStream>
 #include <QtCore/QDirIterator>
+#include <QtCore/QSaveFile>
 
 #include <QtXml/QDomDocument>
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 using namespace QInstallerTools;
 
@@ -64,6 +70,98 @@ void QInstallerTools::printRepositoryGenOptions()
 
     std::cout << "  --ignore-translations     Do not use any translation" << std::endl;
     std::cout << "  --ignore-invalid-packages Ignore all invalid packages instead of aborting." << std::endl;
+
+    printCompressionOptions();
+}
+
+void QInstallerTools::printCompressionOptions()
+{
+    std::cout << "  --compression-method name Compress using the given method: LZMA, LZMA2, PPMd," << std::endl;
+    std::cout << "                            BZip2, Deflate or Copy. Defaults to LZMA." << std::endl;
+    std::cout << "  --compression-level 0-9   The compression level, from 0 (store) to 9 (ultra)." << std::endl;
+    std::cout << "                            Defaults to 5." << std::endl;
+    std::cout << "  --compression-threads n   The number of threads used to compress." << std::endl;
+    std::cout << "                            Defaults to the number of CPU cores." << std::endl;
+    std::cout << "  --solid-block-size size   The maximum size of a solid block, e.g. 64m." << std::endl;
+    std::cout << "                            Use 0 to create non-solid archives." << std::endl;
+    std::cout << "  --dictionary-size size    The dictionary size of the method, e.g. 16m." << std::endl;
+}
+
+static bool parseSize(const QString &value, quint64 *size)
+{
+    QString number = value.trimmed().toLower();
+    int shift = 0;
+    if (number.endsWith(QLatin1Char('k')))
+        shift = 10;
+    else if (number.endsWith(QLatin1Char('m')))
+        shift = 20;
+    else if (number.endsWith(QLatin1Char('g')))
+        shift = 30;
+    if (shift > 0 || number.endsWith(QLatin1Char('b')))
+        number.chop(1);
+
+    bool ok = false;
+    const quint64 result = number.toULongLong(&ok);
+    if (!ok || (result << shift) >> shift != result)
+        return false;
+    *size = result << shift;
+    return true;
+}
+
+bool QInstallerTools::isCompressionOption(const QString &option)
+{
+    return option == QLatin1String("--compression-method")
+        || option == QLatin1String("--compression-level")
+        || option == QLatin1String("--compression-threads")
+        || option == QLatin1String("--solid-block-size")
+        || option == QLatin1String("--dictionary-size");
+}
+
+bool QInstallerTools::parseCompressionOption(const QString &option, const QString &value,
+    Lib7z::CompressionOptions *options, QString *errorMessage)
+{
+    bool ok = false;
+    if (option == QLatin1String("--compression-method")) {
+        static const QStringList methods = QStringList() << QLatin1String("LZMA")
+            << QLatin1String("LZMA2") << QLatin1String("PPMd") << QLatin1String("BZip2")
+            << QLatin1String("Deflate") << QLatin1String("Copy");
+        foreach (const QString &method, methods) {
+            if (method.compare(value, Qt::CaseInsensitive) == 0) {
+                options->method = method;
+                return true;
+            }
+        }
+    } else if (option == QLatin1String("--compression-level")) {
+        const int level = value.toInt(&ok);
+        if (ok && level >= 0 && level <= 9) {
+            options->level = level;
+            return true;
+        }
+    } else if (option == QLatin1String("--compression-threads")) {
+        const int threadCount = value.toInt(&ok);
+        if (ok && threadCount > 0) {
+            options->threadCount = threadCount;
+            return true;
+        }
+    } else if (option == QLatin1String("--solid-block-size")) {
+        quint64 size = 0;
+        if (parseSize(value, &size) && size <= quint64(std::numeric_limits<qint64>::max())) {
+            options->solidBlockSize = qint64(size);
+            return true;
+        }
+    } else if (option == QLatin1String("--dictionary-size")) {
+        quint64 size = 0;
+        if (parseSize(value, &size) && size > 0 && size <= std::numeric_limits<quint32>::max()) {
+            options->dictionarySize = size;
+            return true;
+        }
+    }
+
+    if (errorMessage) {
+        *errorMessage = QString::fromLatin1("Error: Invalid value \"%1\" for option %2.")
+            .arg(value, option);
+    }
+    return false;
 }
 
 QString QInstallerTools::makePathAbsolute(const QString &path)
@@ -93,11 +191,12 @@ void QInstallerTools::copyWithException(const QString &source, const QString &ta
     qDebug() << "done.\n";
 }
 
-void QInstallerTools::compressPaths(const QStringList &paths, const QString &archivePath)
+void QInstallerTools::compressPaths(const QStringList &paths, const QString &archivePath,
+    const Lib7z::CompressionOptions &options)
 {
     QFile archive(archivePath);
     QInstaller::openForWrite(&archive);
-    Lib7z::createArchive(&archive, paths);
+    Lib7z::createArchive(&archive, paths, options);
 }
 
 static QStringList copyFilesFromNode(const QString &parentNode, const QString &childNode, const QString &attr,
@@ -243,6 +342,9 @@ void QInstallerTools::copyMetaData(const QString &_targetDir, const QString &met
             : QDir(QString::fromLatin1("%1/%2").arg(metaDataDir, info.name)).entryInfoList(filters);
         qDebug() << QString::fromLatin1("calculate size of directory: %1").arg(dataDir.absolutePath());
         foreach (const QFileInfo &fi, entries) {
+            // the meta archive kept by an incremental repogen run is not part of the data
+            if (fi.fileName() == info.version + QLatin1String("meta.7z"))
+                continue;
             try {
                 if (fi.isDir()) {
                     QDirIterator recursDirIt(fi.filePath(), QDirIterator::Subdirectories);
@@ -253,15 +355,11 @@ void QInstallerTools::copyMetaData(const QString &_targetDir, const QString &met
                         compressedComponentSize += size;
                     }
                 } else if (Lib7z::isSupportedArchive(fi.filePath())) {
-                    // if it's an archive already, list its files and sum the uncompressed sizes
+                    // if it's an archive already, sum the uncompressed sizes of its files
                     QFile archive(fi.filePath());
                     compressedComponentSize += archive.size();
                     QInstaller::openForRead(&archive);
-
-                    QVector<Lib7z::File>::const_iterator fileIt;
-                    const QVector<Lib7z::File> files = Lib7z::listArchive(&archive);
-                    for (fileIt = files.begin(); fileIt != files.end(); ++fileIt)
-                        componentSize += fileIt->uncompressedSize;
+                    componentSize += Lib7z::archiveStatistics(&archive).uncompressedSize;
                 } else {
                     // otherwise just add its size
                     const quint64 size = QInstaller::fileSize(fi);
@@ -506,8 +604,72 @@ static void writeSHA1ToNodeWithName(QDomDocument &doc, QDomNodeList &list, const
     }
 }
 
-void QInstallerTools::compressMetaDirectories(const QString &repoDir, const QString &baseDir,
-    const QHash<QString, QString> &versionMapping)
+template <typename Task>
+static QString runAndCatch(void (*function)(const Task &), const Task &task)
+{
+    try {
+        function(task);
+    } catch (const QInstaller::Error &error) {
+        return error.message();
+    } catch (const Lib7z::SevenZipException &error) {
+        return error.message();
+    } catch (...) {
+        return QString::fromLatin1("Unknown exception caught.");
+    }
+    return QString();
+}
+
+/*
+    Runs \a function for all \a tasks on the global thread pool and waits until all of them are
+    done. If tasks failed, the error of the first failed one in \a tasks is thrown, no matter in
+    which order they finished.
+*/
+template <typename Task>
+static void runConcurrently(const QVector<Task> &tasks, void (*function)(const Task &))
+{
+    QList<QFuture<QString> > futures;
+    foreach (const Task &task, tasks)
+        futures.append(QtConcurrent::run(&runAndCatch<Task>, function, task));
+
+    QString error;
+    foreach (const QFuture<QString> &future, futures) {
+        const QString result = future.result();
+        if (error.isEmpty())
+            error = result;
+    }
+    if (!error.isEmpty())
+        throw QInstaller::Error(error);
+}
+
+struct MetaDirectoryTask
+{
+    QString path;
+    QString absPath;
+    QString archivePath;
+    QString finalPath;
+    QByteArray *sha1Sum;
+};
+
+static void compressMetaDirectory(const MetaDirectoryTask &task)
+{
+    compressPaths(QStringList() << task.absPath, task.archivePath);
+
+    // remove the files that got compressed
+    QInstaller::removeFiles(task.absPath, true);
+
+    QFile tmp(task.archivePath);
+    QInstaller::openForRead(&tmp);
+    *task.sha1Sum = QInstaller::calculateHash(&tmp, QCryptographicHash::Sha1);
+    tmp.close();
+    if (!tmp.rename(task.finalPath)) {
+        throw QInstaller::Error(QString::fromLatin1("Could not move '%1' to '%2'").arg(task.archivePath,
+            task.finalPath));
+    }
+}
+
+QHash<QString, QByteArray> QInstallerTools::compressMetaDirectories(const QString &repoDir,
+    const QString &baseDir, const QHash<QString, QString> &versionMapping,
+    const QHash<QString, QByteArray> &existingSha1Sums)
 {
     QDomDocument doc;
     QDomElement root;
@@ -522,7 +684,10 @@ void QInstallerTools::compressMetaDirectories(const QString &repoDir, const QStr
 
     QDir dir(repoDir);
     const QStringList sub = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    QDomNodeList elements =  doc.elementsByTagName(QLatin1String("PackageUpdate"));
+    QStringList paths;
+    QHash<QString, QByteArray> sha1Sums;
+    QVector<MetaDirectoryTask> tasks;
+    QVector<QByteArray> taskSha1Sums;
     foreach (const QString &i, sub) {
         QDir sd(dir);
         sd.cd(i);
@@ -530,109 +695,359 @@ void QInstallerTools::compressMetaDirectories(const QString &repoDir, const QStr
         const QString versionPrefix = versionMapping[path];
         if (path.isNull())
             continue;
+        paths.append(path);
         const QString absPath = sd.absolutePath();
+        if (existingSha1Sums.contains(path)) {
+            // the meta archive in the repository is up to date, drop the freshly copied files
+            QInstaller::removeFiles(absPath, true);
+            sha1Sums.insert(path, existingSha1Sums.value(path));
+            continue;
+        }
+
         const QString fn = QLatin1String(versionPrefix.toLatin1() + "meta.7z");
-        const QString tmpTarget = repoDir + QLatin1String("/") +fn;
-        compressPaths(QStringList() << absPath, tmpTarget);
+        MetaDirectoryTask task;
+        task.path = path;
+        task.absPath = absPath;
+        task.archivePath = QString::fromLatin1("%1/%2.%3").arg(repoDir, path, fn);
+        task.finalPath = absPath + QLatin1String("/") + fn;
+        tasks.append(task);
+    }
 
-        // remove the files that got compressed
-        QInstaller::removeFiles(absPath, true);
+    taskSha1Sums.resize(tasks.count());
+    for (int i = 0; i < tasks.count(); ++i)
+        tasks[i].sha1Sum = &taskSha1Sums[i];
+    runConcurrently(tasks, &compressMetaDirectory);
+    for (int i = 0; i < tasks.count(); ++i)
+        sha1Sums.insert(tasks.at(i).path, taskSha1Sums.at(i));
 
-        QFile tmp(tmpTarget);
-        tmp.open(QFile::ReadOnly);
-        const QByteArray sha1Sum = QInstaller::calculateHash(&tmp, QCryptographicHash::Sha1);
-        writeSHA1ToNodeWithName(doc, elements, sha1Sum, path);
-        const QString finalTarget = absPath + QLatin1String("/") + fn;
-        if (!tmp.rename(finalTarget)) {
-            throw QInstaller::Error(QString::fromLatin1("Could not move '%1' to '%2'").arg(tmpTarget,
-                finalTarget));
-        }
-    }
+    QDomNodeList elements =  doc.elementsByTagName(QLatin1String("PackageUpdate"));
+    foreach (const QString &path, paths)
+        writeSHA1ToNodeWithName(doc, elements, sha1Sums.value(path), path);
 
     QInstaller::openForWrite(&existingUpdatesXml);
     QInstaller::blockingWrite(&existingUpdatesXml, doc.toByteArray());
     existingUpdatesXml.close();
+    return sha1Sums;
 }
 
-void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QString &repoDir,
-    PackageInfoVector *const infos)
+struct ComponentDataTask
 {
-    for (int i = 0; i < infos->count(); ++i) {
-        const PackageInfo info = infos->at(i);
-        const QString name = info.name;
-        qDebug() << "Copying component data for" << name;
-
-        const QString namedRepoDir = QString::fromLatin1("%1/%2").arg(repoDir, name);
-        if (!QDir().mkpath(namedRepoDir)) {
-            throw QInstaller::Error(QString::fromLatin1("Could not create repository folder for component '%1'")
-                .arg(name));
-        }
-
-        QStringList compressedFiles;
-        QStringList filesToCompress;
-        foreach (const QString &packageDir, packageDirs) {
-            const QDir dataDir(QString::fromLatin1("%1/%2/data").arg(packageDir, name));
-            foreach (const QString &entry, dataDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Files)) {
-                QFileInfo fileInfo(dataDir.absoluteFilePath(entry));
-                if (fileInfo.isFile() && !fileInfo.isSymLink()) {
-                    const QString absoluteEntryFilePath = dataDir.absoluteFilePath(entry);
-                    if (Lib7z::isSupportedArchive(absoluteEntryFilePath)) {
-                        QFile tmp(absoluteEntryFilePath);
-                        QString target = QString::fromLatin1("%1/%3%2").arg(namedRepoDir, entry, info.version);
-                        qDebug() << QString::fromLatin1("Copying archive from '%1' to '%2'").arg(tmp.fileName(),
-                            target);
-                        if (!tmp.copy(target)) {
-                            throw QInstaller::Error(QString::fromLatin1("Could not copy '%1' to '%2': %3")
-                                .arg(tmp.fileName(), target, tmp.errorString()));
-                        }
-                        compressedFiles.append(target);
-                    } else {
-                        filesToCompress.append(absoluteEntryFilePath);
+    QStringList packageDirs;
+    QString repoDir;
+    PackageInfo *info;
+    Lib7z::CompressionOptions options;
+};
+
+static void copyComponentDataOfPackage(const ComponentDataTask &task)
+{
+    const PackageInfo info = *task.info;
+    const QString name = info.name;
+    qDebug() << "Copying component data for" << name;
+
+    const QString namedRepoDir = QString::fromLatin1("%1/%2").arg(task.repoDir, name);
+    if (!QDir().mkpath(namedRepoDir)) {
+        throw QInstaller::Error(QString::fromLatin1("Could not create repository folder for component '%1'")
+            .arg(name));
+    }
+
+    QStringList compressedFiles;
+    QStringList filesToCompress;
+    foreach (const QString &packageDir, task.packageDirs) {
+        const QDir dataDir(QString::fromLatin1("%1/%2/data").arg(packageDir, name));
+        foreach (const QString &entry, dataDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Files)) {
+            QFileInfo fileInfo(dataDir.absoluteFilePath(entry));
+            if (fileInfo.isFile() && !fileInfo.isSymLink()) {
+                const QString absoluteEntryFilePath = dataDir.absoluteFilePath(entry);
+                if (Lib7z::isSupportedArchive(absoluteEntryFilePath)) {
+                    QFile tmp(absoluteEntryFilePath);
+                    QString target = QString::fromLatin1("%1/%3%2").arg(namedRepoDir, entry, info.version);
+                    qDebug() << QString::fromLatin1("Copying archive from '%1' to '%2'").arg(tmp.fileName(),
+                        target);
+                    if (!tmp.copy(target)) {
+                        throw QInstaller::Error(QString::fromLatin1("Could not copy '%1' to '%2': %3")
+                            .arg(tmp.fileName(), target, tmp.errorString()));
                     }
-                } else if (fileInfo.isDir()) {
-                    qDebug() << "Compressing data directory" << entry;
-                    QString target = QString::fromLatin1("%1/%3%2.7z").arg(namedRepoDir, entry, info.version);
-                    QInstallerTools::compressPaths(QStringList() << dataDir.absoluteFilePath(entry), target);
                     compressedFiles.append(target);
-                } else if (fileInfo.isSymLink()) {
-                    filesToCompress.append(dataDir.absoluteFilePath(entry));
+                } else {
+                    filesToCompress.append(absoluteEntryFilePath);
                 }
+            } else if (fileInfo.isDir()) {
+                qDebug() << "Compressing data directory" << entry;
+                QString target = QString::fromLatin1("%1/%3%2.7z").arg(namedRepoDir, entry, info.version);
+                QInstallerTools::compressPaths(QStringList() << dataDir.absoluteFilePath(entry), target,
+                    task.options);
+                compressedFiles.append(target);
+            } else if (fileInfo.isSymLink()) {
+                filesToCompress.append(dataDir.absoluteFilePath(entry));
             }
         }
+    }
+
+    if (!filesToCompress.isEmpty()) {
+        qDebug() << "Compressing files found in data directory:" << filesToCompress;
+        QString target = QString::fromLatin1("%1/%3%2").arg(namedRepoDir, QLatin1String("content.7z"),
+            info.version);
+        QInstallerTools::compressPaths(filesToCompress, target, task.options);
+        compressedFiles.append(target);
+    }
 
-        if (!filesToCompress.isEmpty()) {
-            qDebug() << "Compressing files found in data directory:" << filesToCompress;
-            QString target = QString::fromLatin1("%1/%3%2").arg(namedRepoDir, QLatin1String("content.7z"),
-                info.version);
-            QInstallerTools::compressPaths(filesToCompress, target);
-            compressedFiles.append(target);
+    foreach (const QString &target, compressedFiles) {
+        task.info->copiedFiles.append(target);
+
+        QFile archiveFile(target);
+        QFile archiveHashFile(archiveFile.fileName() + QLatin1String(".sha1"));
+
+        qDebug() << "Hash is stored in" << archiveHashFile.fileName();
+        qDebug() << "Creating hash of archive" << archiveFile.fileName();
+
+        try {
+            QInstaller::openForRead(&archiveFile);
+            const QByteArray hashOfArchiveData = QInstaller::calculateHash(&archiveFile,
+                QCryptographicHash::Sha1).toHex();
+            archiveFile.close();
+
+            QInstaller::openForWrite(&archiveHashFile);
+            archiveHashFile.write(hashOfArchiveData);
+            qDebug() << "Generated sha1 hash:" << hashOfArchiveData;
+            task.info->copiedFiles.append(archiveHashFile.fileName());
+            archiveHashFile.close();
+        } catch (const QInstaller::Error &/*e*/) {
+            archiveFile.close();
+            archiveHashFile.close();
+            throw;
         }
+    }
+}
 
-        foreach (const QString &target, compressedFiles) {
-            (*infos)[i].copiedFiles.append(target);
+void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QString &repoDir,
+    PackageInfoVector *const infos, const Lib7z::CompressionOptions &options)
+{
+    QVector<ComponentDataTask> tasks;
+    for (int i = 0; i < infos->count(); ++i) {
+        ComponentDataTask task;
+        task.packageDirs = packageDirs;
+        task.repoDir = repoDir;
+        task.info = &(*infos)[i];
+        task.options = options;
+        tasks.append(task);
+    }
+    runConcurrently(tasks, &copyComponentDataOfPackage);
+}
 
-            QFile archiveFile(target);
-            QFile archiveHashFile(archiveFile.fileName() + QLatin1String(".sha1"));
+static const quint32 scManifestMagic = 0x49465752; // "IFWR"
+static const quint16 scManifestVersion = 1;
+
+/*
+    The manifest remembers, for each component of the repository, the hash of its package
+    directories and the files that got generated from them. An incremental repogen run only
+    regenerates the components whose hash changed. Files whose size and modification time did not
+    change are not read again, their hash is taken from the manifest.
+*/
+RepositoryManifest::RepositoryManifest(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
 
-            qDebug() << "Hash is stored in" << archiveHashFile.fileName();
-            qDebug() << "Creating hash of archive" << archiveFile.fileName();
+void RepositoryManifest::read()
+{
+    m_entries.clear();
+    m_files.clear();
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_4);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != scManifestMagic || version != scManifestVersion) {
+        qDebug() << "Ignoring manifest" << m_fileName << "with an unknown format.";
+        return;
+    }
 
-            try {
-                QInstaller::openForRead(&archiveFile);
-                const QByteArray hashOfArchiveData = QInstaller::calculateHash(&archiveFile,
-                    QCryptographicHash::Sha1).toHex();
-                archiveFile.close();
-
-                QInstaller::openForWrite(&archiveHashFile);
-                archiveHashFile.write(hashOfArchiveData);
-                qDebug() << "Generated sha1 hash:" << hashOfArchiveData;
-                (*infos)[i].copiedFiles.append(archiveHashFile.fileName());
-                archiveHashFile.close();
-            } catch (const QInstaller::Error &/*e*/) {
-                archiveFile.close();
-                archiveHashFile.close();
-                throw;
-            }
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        Entry entry;
+        stream >> name >> entry.version >> entry.inputHash >> entry.copiedFiles >> entry.metaSha1Sum;
+        m_entries.insert(name, entry);
+    }
+
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        FileState state;
+        stream >> path >> state.size >> state.lastModified >> state.sha1Sum;
+        m_files.insert(path, state);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "Ignoring corrupt manifest" << m_fileName;
+        m_entries.clear();
+        m_files.clear();
+    }
+}
+
+void RepositoryManifest::write() const
+{
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw QInstaller::Error(QString::fromLatin1("Could not open manifest '%1' for writing: %2")
+            .arg(m_fileName, file.errorString()));
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_4);
+    stream << scManifestMagic << scManifestVersion;
+
+    stream << quint32(m_entries.count());
+    for (QHash<QString, Entry>::const_iterator it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        stream << it.key() << it->version << it->inputHash << it->copiedFiles << it->metaSha1Sum;
+
+    // only the files of the last run are kept, the others are not part of any package anymore
+    stream << quint32(m_hashedFiles.count());
+    for (QHash<QString, FileState>::const_iterator it = m_hashedFiles.constBegin();
+        it != m_hashedFiles.constEnd(); ++it) {
+            stream << it.key() << it->size << it->lastModified << it->sha1Sum;
+    }
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        throw QInstaller::Error(QString::fromLatin1("Could not write manifest '%1': %2")
+            .arg(m_fileName, file.errorString()));
+    }
+}
+
+QHash<QString, QByteArray> RepositoryManifest::hashInputs(const PackageInfoVector &packages,
+    const QStringList &packageDirs, const QByteArray &settings)
+{
+    QVector<HashTask> tasks;
+    QVector<QByteArray> inputHashes(packages.count());
+    for (int i = 0; i < packages.count(); ++i) {
+        const PackageInfo &info = packages.at(i);
+        HashTask task;
+        task.manifest = this;
+        task.directories.append(QString::fromLatin1("%1/meta").arg(info.directory));
+        foreach (const QString &packageDir, packageDirs)
+            task.directories.append(QString::fromLatin1("%1/%2/data").arg(packageDir, info.name));
+        task.settings = settings;
+        task.inputHash = &inputHashes[i];
+        tasks.append(task);
+    }
+    runConcurrently(tasks, &RepositoryManifest::hashPackage);
+
+    QHash<QString, QByteArray> result;
+    for (int i = 0; i < packages.count(); ++i)
+        result.insert(packages.at(i).name, inputHashes.at(i));
+    return result;
+}
+
+void RepositoryManifest::hashPackage(const HashTask &task)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(task.settings);
+
+    foreach (const QString &directory, task.directories) {
+        hash.addData(directory.toUtf8());
+        hash.addData(QFileInfo(directory).isDir() ? "\n" : "-\n");
+
+        QStringList paths;
+        QDirIterator it(directory, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+            QDirIterator::Subdirectories);
+        while (it.hasNext())
+            paths.append(it.next());
+        std::sort(paths.begin(), paths.end());
+
+        const QDir dir(directory);
+        foreach (const QString &path, paths) {
+            const QFileInfo fileInfo(path);
+            hash.addData(dir.relativeFilePath(path).toUtf8());
+            hash.addData(QByteArray::number(int(fileInfo.permissions())));
+            if (fileInfo.isSymLink())
+                hash.addData(fileInfo.symLinkTarget().toUtf8());
+            else if (fileInfo.isFile())
+                hash.addData(task.manifest->fileSha1Sum(fileInfo));
+            hash.addData("\n");
+        }
+    }
+    *task.inputHash = hash.result();
+}
+
+QByteArray RepositoryManifest::fileSha1Sum(const QFileInfo &fileInfo)
+{
+    const QString path = fileInfo.absoluteFilePath();
+    FileState state;
+    state.size = fileInfo.size();
+    state.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker _(&m_mutex);
+        const FileState known = m_files.value(path);
+        if (!known.sha1Sum.isEmpty() && known.size == state.size
+            && known.lastModified == state.lastModified) {
+                m_hashedFiles.insert(path, known);
+                return known.sha1Sum;
         }
     }
+
+    state.sha1Sum = QInstaller::calculateHash(path, QCryptographicHash::Sha1);
+    QMutexLocker _(&m_mutex);
+    m_hashedFiles.insert(path, state);
+    return state.sha1Sum;
+}
+
+bool RepositoryManifest::isUpToDate(const PackageInfo &info, const QByteArray &inputHash,
+    const QString &repoDir) const
+{
+    const QHash<QString, Entry>::const_iterator it = m_entries.constFind(info.name);
+    if (it == m_entries.constEnd() || it->version != info.version || it->inputHash != inputHash
+        || it->metaSha1Sum.isEmpty()) {
+            return false;
+    }
+
+    const QDir dir(QString::fromLatin1("%1/%2").arg(repoDir, info.name));
+    if (!dir.exists(info.version + QLatin1String("meta.7z")))
+        return false;
+    foreach (const QString &file, it->copiedFiles) {
+        if (!dir.exists(file))
+            return false;
+    }
+    return true;
+}
+
+QStringList RepositoryManifest::packageNames() const
+{
+    return m_entries.keys();
+}
+
+QStringList RepositoryManifest::copiedFiles(const QString &name, const QString &repoDir) const
+{
+    QStringList files;
+    foreach (const QString &file, m_entries.value(name).copiedFiles)
+        files.append(QString::fromLatin1("%1/%2/%3").arg(repoDir, name, file));
+    return files;
+}
+
+QByteArray RepositoryManifest::metaSha1Sum(const QString &name) const
+{
+    return m_entries.value(name).metaSha1Sum;
+}
+
+void RepositoryManifest::insert(const PackageInfo &info, const QByteArray &inputHash,
+    const QByteArray &metaSha1Sum)
+{
+    Entry entry;
+    entry.version = info.version;
+    entry.inputHash = inputHash;
+    foreach (const QString &file, info.copiedFiles)
+        entry.copiedFiles.append(QFileInfo(file).fileName());
+    entry.metaSha1Sum = metaSha1Sum;
+    m_entries.insert(info.name, entry);
+}
+
+void RepositoryManifest::remove(const QString &name)
+{
+    m_entries.remove(name);
 }
@@ -35,7 +35,11 @@
 #ifndef QINSTALLER_REPOSITORYGEN_H
 #define QINSTALLER_REPOSITORYGEN_H
 
+#include <lib7z_facade.h>
+
+#include <QFileInfo>
 #include <QHash>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 #include <QVector>
@@ -59,6 +63,10 @@ enum FilterType {
 };
 
 void printRepositoryGenOptions();
+void printCompressionOptions();
+bool isCompressionOption(const QString &option);
+bool parseCompressionOption(const QString &option, const QString &value,
+    Lib7z::CompressionOptions *options, QString *errorMessage = 0);
 QString makePathAbsolute(const QString &path);
 void copyWithException(const QString &source, const QString &target, const QString &kind = QString());
 
@@ -66,14 +74,71 @@ PackageInfoVector createListOfPackages(const QStringList &packagesDirectories, Q
     FilterType ftype);
 QHash<QString, QString> buildPathToVersionMapping(const PackageInfoVector &info);
 
-void compressPaths(const QStringList &paths, const QString &archivePath);
-void compressMetaDirectories(const QString &repoDir, const QString &baseDir,
-    const QHash<QString, QString> &versionMapping);
+void compressPaths(const QStringList &paths, const QString &archivePath,
+    const Lib7z::CompressionOptions &options = Lib7z::CompressionOptions());
+QHash<QString, QByteArray> compressMetaDirectories(const QString &repoDir, const QString &baseDir,
+    const QHash<QString, QString> &versionMapping,
+    const QHash<QString, QByteArray> &existingSha1Sums = QHash<QString, QByteArray>());
 
 void copyMetaData(const QString &outDir, const QString &dataDir, const PackageInfoVector &packages,
     const QString &appName, const QString& appVersion);
-void copyComponentData(const QStringList &packageDir, const QString &repoDir, PackageInfoVector *const infos);
+void copyComponentData(const QStringList &packageDir, const QString &repoDir, PackageInfoVector *const infos,
+    const Lib7z::CompressionOptions &options = Lib7z::CompressionOptions());
+
+class RepositoryManifest
+{
+    Q_DISABLE_COPY(RepositoryManifest)
+
+public:
+    explicit RepositoryManifest(const QString &fileName);
+
+    void read();
+    void write() const;
+
+    QHash<QString, QByteArray> hashInputs(const PackageInfoVector &packages, const QStringList &packageDirs,
+        const QByteArray &settings);
+    bool isUpToDate(const PackageInfo &info, const QByteArray &inputHash, const QString &repoDir) const;
+
+    QStringList packageNames() const;
+    QStringList copiedFiles(const QString &name, const QString &repoDir) const;
+    QByteArray metaSha1Sum(const QString &name) const;
 
+    void insert(const PackageInfo &info, const QByteArray &inputHash, const QByteArray &metaSha1Sum);
+    void remove(const QString &name);
+
+private:
+    struct Entry
+    {
+        QString version;
+        QByteArray inputHash;
+        QStringList copiedFiles;
+        QByteArray metaSha1Sum;
+    };
+
+    struct FileState
+    {
+        qint64 size;
+        qint64 lastModified;
+        QByteArray sha1Sum;
+    };
+
+    struct HashTask
+    {
+        RepositoryManifest *manifest;
+        QStringList directories;
+        QByteArray settings;
+        QByteArray *inputHash;
+    };
+
+    static void hashPackage(const HashTask &task);
+    QByteArray fileSha1Sum(const QFileInfo &fileInfo);
+
+    QString m_fileName;
+    QHash<QString, Entry> m_entries;
+    QHash<QString, FileState> m_files;
+    QHash<QString, FileState> m_hashedFiles;
+    QMutex m_mutex;
+};
 
 } // namespace QInstallerTools
 
@@ -47,6 +47,21 @@
 
 #include <iostream>
 
+namespace {
+// Remembers the path of the first item of an archive and stops the listing.
+class FirstEntryVisitor : public Lib7z::ArchiveVisitor
+{
+public:
+    bool visit(const Lib7z::ArchiveEntry &entry)
+    {
+        path = entry.path();
+        return false;
+    }
+
+    QString path;
+};
+}
+
 BinaryReplace::BinaryReplace(const QInstaller::BinaryLayout &layout)
     : m_binaryLayout(layout)
 {}
@@ -76,10 +91,10 @@ int BinaryReplace::replace(const QString &source, const QString &target)
             QFile archive(newInstallerBasePath);
             if (archive.open(QIODevice::ReadOnly)) {
                 try {
+                    FirstEntryVisitor firstEntry;
+                    Lib7z::listArchive(&archive, &firstEntry, Lib7z::ListPaths);
                     Lib7z::extractArchive(&archive, QDir::tempPath());
-                    const QVector<Lib7z::File> files = Lib7z::listArchive(&archive);
-                    newInstallerBasePath = QDir::tempPath() + QLatin1Char('/') + files.value(0)
-                        .path;
+                    newInstallerBasePath = QDir::tempPath() + QLatin1Char('/') + firstEntry.path;
                     result = EXIT_SUCCESS;
                 } catch (const Lib7z::SevenZipException& e) {
                     std::cerr << qPrintable(QString::fromLatin1("Error while extracting '%1': %2.")
@@ -45,6 +45,7 @@
 #include <QtCore/QDir>
 #include <QtCore/QDirIterator>
 #include <QtCore/QFileInfo>
+#include <QtCore/QThreadPool>
 #include <QTemporaryDir>
 
 #include <iostream>
@@ -55,6 +56,8 @@
 using namespace Lib7z;
 using namespace QInstaller;
 
+static const QString scManifestFileName = QLatin1String(".repogen-manifest");
+
 static void printUsage()
 {
     const QString appName = QFileInfo(QCoreApplication::applicationFilePath()).fileName();
@@ -73,6 +76,14 @@ static void printUsage()
     std::cout << "                            --include or --exclude) in the repository with all new components"
         << std::endl;
 
+    std::cout << "  --incremental             Only regenerate the components whose package" << std::endl;
+    std::cout << "                            directories changed since the last incremental run." << std::endl;
+    std::cout << "                            Uses the manifest file '" << qPrintable(scManifestFileName)
+        << "' in the repository." << std::endl;
+
+    std::cout << "  -j|--jobs n               Process up to n components at the same time." << std::endl;
+    std::cout << "                            Defaults to the number of CPU cores." << std::endl;
+
     std::cout << "  -v|--verbose              Verbose output" << std::endl;
 
     std::cout << std::endl;
@@ -105,6 +116,8 @@ int main(int argc, char** argv)
         QInstallerTools::FilterType filterType = QInstallerTools::Exclude;
         bool remove = false;
         bool updateExistingRepositoryWithNewComponents = false;
+        bool incremental = false;
+        Lib7z::CompressionOptions compressionOptions;
 
         //TODO: use a for loop without removing values from args like it is in binarycreator.cpp
         //for (QStringList::const_iterator it = args.begin(); it != args.end(); ++it) {
@@ -149,6 +162,18 @@ int main(int argc, char** argv)
             } else if (args.first() == QLatin1String("--update-new-components")) {
                 args.removeFirst();
                 updateExistingRepositoryWithNewComponents = true;
+            } else if (args.first() == QLatin1String("--incremental")) {
+                args.removeFirst();
+                incremental = true;
+            } else if (args.first() == QLatin1String("-j") || args.first() == QLatin1String("--jobs")) {
+                args.removeFirst();
+                bool ok = false;
+                const int jobs = args.isEmpty() ? 0 : args.takeFirst().toInt(&ok);
+                if (!ok || jobs < 1) {
+                    return printErrorAndUsageAndExit(QCoreApplication::translate("QInstaller",
+                        "Error: Jobs parameter missing or invalid"));
+                }
+                QThreadPool::globalInstance()->setMaxThreadCount(jobs);
             } else if (args.first() == QLatin1String("-p") || args.first() == QLatin1String("--packages")) {
                 args.removeFirst();
                 if (args.isEmpty()) {
@@ -169,6 +194,18 @@ int main(int argc, char** argv)
             } else if (args.first() == QLatin1String("-r") || args.first() == QLatin1String("--remove")) {
                 remove = true;
                 args.removeFirst();
+            } else if (QInstallerTools::isCompressionOption(args.first())) {
+                const QString option = args.takeFirst();
+                if (args.isEmpty()) {
+                    return printErrorAndUsageAndExit(QCoreApplication::translate("QInstaller",
+                        "Error: %1 parameter missing argument").arg(option));
+                }
+
+                QString error;
+                if (!QInstallerTools::parseCompressionOption(option, args.takeFirst(),
+                    &compressionOptions, &error)) {
+                        return printErrorAndUsageAndExit(error);
+                }
             } else {
                 printUsage();
                 return 1;
@@ -185,13 +222,21 @@ int main(int argc, char** argv)
             throw QInstaller::Error(QCoreApplication::translate("QInstaller",
                 "Argument -r|--remove and --update|--update-new-components are mutually exclusive!"));
         }
+        if (incremental && (remove || update)) {
+            throw QInstaller::Error(QCoreApplication::translate("QInstaller",
+                "Argument --incremental and -r|--remove|--update|--update-new-components are mutually "
+                "exclusive!"));
+        }
 
         const QString repositoryDir = QInstallerTools::makePathAbsolute(args.first());
         if (remove)
             QInstaller::removeDirectory(repositoryDir);
 
-        if (!update && QFile::exists(repositoryDir) && !QDir(repositoryDir).entryList(
-            QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
+        // an incremental run may only go into a folder created by an earlier incremental run
+        const bool incrementalUpdate = incremental
+            && QFile::exists(repositoryDir + QLatin1Char('/') + scManifestFileName);
+        if (!update && !incrementalUpdate && QFile::exists(repositoryDir) && !QDir(repositoryDir)
+            .entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
 
             throw QInstaller::Error(QCoreApplication::translate("QInstaller",
                 "Repository target folder %1 already exists!").arg(repositoryDir));
@@ -249,7 +294,52 @@ int main(int argc, char** argv)
 
         QHash<QString, QString> pathToVersionMapping = QInstallerTools::buildPathToVersionMapping(packages);
 
-        foreach (const QInstallerTools::PackageInfo &package, packages) {
+        // in incremental mode only the components with changed inputs get regenerated, the others
+        // keep their archives and the hash of their meta data archive from the last run
+        QInstallerTools::RepositoryManifest manifest(repositoryDir + QLatin1Char('/') + scManifestFileName);
+        QHash<QString, QByteArray> inputHashes;
+        QHash<QString, QByteArray> keptMetaSha1Sums;
+        QInstallerTools::PackageInfoVector changedPackages = packages;
+        if (incremental) {
+            manifest.read();
+            const QByteArray settings = (QStringList() << QLatin1String(QUOTE(IFW_REPOSITORY_FORMAT_VERSION))
+                << compressionOptions.method << QString::number(compressionOptions.level)
+                << QString::number(compressionOptions.threadCount)
+                << QString::number(compressionOptions.solidBlockSize)
+                << QString::number(compressionOptions.dictionarySize)
+                << (app.arguments().contains(QLatin1String("--ignore-translations"))
+                    ? QLatin1String("ignore-translations") : QString()))
+                .join(QLatin1Char(',')).toUtf8();
+            inputHashes = manifest.hashInputs(packages, packagesDirectories, settings);
+
+            changedPackages.clear();
+            for (int i = 0; i < packages.count(); ++i) {
+                const QInstallerTools::PackageInfo &info = packages.at(i);
+                if (manifest.isUpToDate(info, inputHashes.value(info.name), repositoryDir)) {
+                    packages[i].copiedFiles = manifest.copiedFiles(info.name, repositoryDir);
+                    keptMetaSha1Sums.insert(info.name, manifest.metaSha1Sum(info.name));
+                } else {
+                    changedPackages.append(info);
+                }
+            }
+            std::cout << QString::fromLatin1("Regenerating %1 of %2 components.").arg(changedPackages
+                .count()).arg(packages.count()) << std::endl;
+
+            // remove the components generated by an earlier run that are not available anymore
+            foreach (const QString &name, manifest.packageNames()) {
+                if (pathToVersionMapping.contains(name))
+                    continue;
+                const QFileInfo fi(repositoryDir, name);
+                if (fi.exists())
+                    removeDirectory(fi.absoluteFilePath());
+                manifest.remove(name);
+            }
+
+            // Updates.xml is created from scratch, so that it matches the one of a full run
+            QFile::remove(repositoryDir + QLatin1String("/Updates.xml"));
+        }
+
+        foreach (const QInstallerTools::PackageInfo &package, changedPackages) {
             const QFileInfo fi(repositoryDir, package.name);
             if (fi.exists())
                 removeDirectory(fi.absoluteFilePath());
@@ -258,10 +348,20 @@ int main(int argc, char** argv)
         QTemporaryDir tmp;
         tmp.setAutoRemove(false);
         tmpMetaDir = tmp.path();
-        QInstallerTools::copyComponentData(packagesDirectories, repositoryDir, &packages);
+        QInstallerTools::copyComponentData(packagesDirectories, repositoryDir, &changedPackages,
+            compressionOptions);
+        QHash<QString, QStringList> changedFiles;
+        foreach (const QInstallerTools::PackageInfo &info, changedPackages)
+            changedFiles.insert(info.name, info.copiedFiles);
+        for (int i = 0; i < packages.count(); ++i) {
+            if (changedFiles.contains(packages.at(i).name))
+                packages[i].copiedFiles = changedFiles.value(packages.at(i).name);
+        }
+
         QInstallerTools::copyMetaData(tmpMetaDir, repositoryDir, packages, QLatin1String("{AnyApplication}"),
             QLatin1String(QUOTE(IFW_REPOSITORY_FORMAT_VERSION)));
-        QInstallerTools::compressMetaDirectories(tmpMetaDir, tmpMetaDir, pathToVersionMapping);
+        const QHash<QString, QByteArray> metaSha1Sums = QInstallerTools::compressMetaDirectories(tmpMetaDir,
+            tmpMetaDir, pathToVersionMapping, keptMetaSha1Sums);
 
         QDirIterator it(repositoryDir, QStringList(QLatin1String("Updates*.xml")), QDir::Files | QDir::CaseSensitive);
         while (it.hasNext()) {
@@ -269,6 +369,12 @@ int main(int argc, char** argv)
             QFile::remove(it.fileInfo().absoluteFilePath());
         }
         QInstaller::moveDirectoryContents(tmpMetaDir, repositoryDir);
+
+        if (incremental) {
+            foreach (const QInstallerTools::PackageInfo &info, changedPackages)
+                manifest.insert(info, inputHashes.value(info.name), metaSha1Sums.value(info.name));
+            manifest.write();
+        }
         exitCode = EXIT_SUCCESS;
     } catch (const Lib7z::SevenZipException &e) {
         std::cerr << "Caught 7zip exception: " << e.message() << std::endl;